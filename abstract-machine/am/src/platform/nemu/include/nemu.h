@@ -34,10 +34,23 @@
 #define DISK_ADDR       (DEVICE_BASE + 0x0000300)
 #define FB_ADDR         (MMIO_BASE   + 0x1000000)
 #define AUDIO_SBUF_ADDR (MMIO_BASE   + 0x1200000)
+#define CLINT_ADDR      (MMIO_BASE   + 0x2000000)
+#define MTIMECMP_ADDR   (CLINT_ADDR  + 0x0004000)
+#define MTIME_ADDR      (CLINT_ADDR  + 0x000bff8)
+#define PLIC_ADDR       (MMIO_BASE   + 0xc000000)
+#define PLIC_IRQ_KBD    1
 
 extern char _pmem_start;
 #define PMEM_SIZE (128 * 1024 * 1024)
 #define PMEM_END  ((uintptr_t)&_pmem_start + PMEM_SIZE)
+#if defined(__riscv)
+// every hart other than hart 0 has its stack at the end of pmem, see start.S
+# define MAX_CPU        8
+# define CPU_STACK_SIZE 0x8000
+# define HEAP_END       (PMEM_END - (MAX_CPU - 1) * CPU_STACK_SIZE)
+#else
+# define HEAP_END       PMEM_END
+#endif
 #define NEMU_PADDR_SPACE \
   RANGE(&_pmem_start, PMEM_END), \
   RANGE(FB_ADDR, FB_ADDR + 0x200000), \
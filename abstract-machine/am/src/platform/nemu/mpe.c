@@ -1,7 +1,45 @@
 #include <am.h>
+#include <nemu.h>
 #include <stdatomic.h>
 #include <klib-macros.h>
 
+#if defined(__riscv)
+static void (* volatile user_entry)() = NULL;
+
+bool mpe_init(void (*entry)()) {
+  user_entry = entry;
+  entry();
+  panic("MPE entry returns");
+}
+
+// the other harts start here with their own stacks, see start.S
+void __am_othercpu_entry(int hartid) {
+  while (user_entry == NULL) ; // wait for mpe_init() on hart 0
+  user_entry();
+  panic("MPE entry returns");
+}
+
+int cpu_count() {
+  static int ncpu = 0;
+  if (ncpu == 0) {
+    // the msip registers of the harts which do not exist are hardwired to 0
+    volatile uint32_t *msip = (uint32_t *)CLINT_ADDR;
+    for (ncpu = 1; ncpu < MAX_CPU; ncpu ++) {
+      msip[ncpu] = 1;
+      bool exist = msip[ncpu];
+      msip[ncpu] = 0;
+      if (!exist) break;
+    }
+  }
+  return ncpu;
+}
+
+int cpu_current() {
+  int hartid;
+  asm volatile ("csrr %0, mhartid" : "=r"(hartid));
+  return hartid;
+}
+#else
 bool mpe_init(void (*entry)()) {
   entry();
   panic("MPE entry returns");
@@ -14,6 +52,7 @@ int cpu_count() {
 int cpu_current() {
   return 0;
 }
+#endif
 
 int atomic_xchg(int *addr, int newval) {
   return atomic_exchange(addr, newval);
@@ -1,9 +1,43 @@
 #include <am.h>
+#include <nemu.h>
 #include <riscv/riscv.h>
 #include <klib.h>
 
+#define MSTATUS_MIE (1 << 3)
+#define MIE_MTIE    (1 << 7)
+#define MIE_MEIE    (1 << 11)
+#define TIMER_INTERVAL 100000 // ticks of mtime between two timer interrupts
+
 static Context* (*user_handler)(Event, Context*) = NULL;
 
+static uint64_t mtime() {
+  uint32_t hi, lo;
+  do {
+    hi = inl(MTIME_ADDR + 4);
+    lo = inl(MTIME_ADDR);
+  } while (hi != inl(MTIME_ADDR + 4));
+  return ((uint64_t)hi << 32) | lo;
+}
+
+// the timer interrupt of this hart is pending until mtimecmp is written again
+static void timer_rearm() {
+  uint64_t next = mtime() + TIMER_INTERVAL;
+  uintptr_t cmp = MTIMECMP_ADDR + 8 * cpu_current();
+  outl(cmp + 4, -1); // no interrupt between the writes of the two halves
+  outl(cmp, (uint32_t)next);
+  outl(cmp + 4, next >> 32);
+}
+
+// registers of the PLIC context of this hart
+#define PLIC_ENABLE   (PLIC_ADDR + 0x2000 + 0x80 * cpu_current())
+#define PLIC_CONTEXT  (PLIC_ADDR + 0x200000 + 0x1000 * cpu_current())
+
+static void plic_init() {
+  outl(PLIC_ADDR + 4 * PLIC_IRQ_KBD, 1); // priority
+  outl(PLIC_ENABLE, 1 << PLIC_IRQ_KBD);
+  outl(PLIC_CONTEXT, 0); // threshold
+}
+
 Context *__am_irq_handle(Context *c)
 {
 
@@ -11,13 +45,15 @@ Context *__am_irq_handle(Context *c)
   {
     // printf("the exception cause id is %d\n", c->mcause);
     Event ev = {0};
+    uint32_t irq = 0;
 
     switch (c->mcause)
     {
     case -1:
       ev.event = EVENT_YIELD;
       break;
-    case 0x80000007: ev.event = EVENT_IRQ_TIMER; break;//EVENT_IRQ_TIMER0x80000007
+    case 0x80000007: ev.event = EVENT_IRQ_TIMER; timer_rearm(); break;//EVENT_IRQ_TIMER0x80000007
+    case 0x8000000b: ev.event = EVENT_IRQ_IODEV; irq = inl(PLIC_CONTEXT + 4); break; // claim
     case 0 ... 19:
       ev.event = EVENT_SYSCALL;
       break;
@@ -28,6 +64,7 @@ Context *__am_irq_handle(Context *c)
     }
 
     c = user_handler(ev, c);
+    if (irq != 0) outl(PLIC_CONTEXT + 4, irq); // complete
 
     assert(c != NULL);
   }
@@ -66,9 +103,19 @@ void yield() {
 }
 
 bool ienabled() {
-  return false;
+  uintptr_t mstatus;
+  asm volatile("csrr %0, mstatus" : "=r"(mstatus));
+  return (mstatus & MSTATUS_MIE) != 0;
 }
 
 void iset(bool enable) {
+  if (enable) {
+    timer_rearm();
+    plic_init();
+    asm volatile("csrs mie, %0" : : "r"(MIE_MTIE | MIE_MEIE));
+    asm volatile("csrs mstatus, %0" : : "r"(MSTATUS_MIE));
+  } else {
+    asm volatile("csrc mstatus, %0" : : "r"(MSTATUS_MIE));
+  }
 }
 
@@ -6,6 +6,19 @@
 
 size_t strlen(const char *s) {
     const char *ptr = s;
+#ifdef __riscv_zbb
+    // orc.b turns every non-zero byte into 0xff, so a word without
+    // '\0' becomes all ones; aligned words never cross a page
+    while ((uintptr_t)ptr % sizeof(uintptr_t) != 0) {
+      if (*ptr == '\0') return ptr - s;
+      ptr++;
+    }
+    uintptr_t w;
+    for (;; ptr += sizeof(uintptr_t)) {
+      asm ("orc.b %0, %1" : "=r"(w) : "r"(*(const uintptr_t *)ptr));
+      if (w != (uintptr_t)-1) break;
+    }
+#endif
     while(*ptr != '\0') {
     	ptr++;
     }
@@ -67,10 +80,24 @@ int strncmp(const char *s1, const char *s2, size_t n) {
   return 0;
 }
 
+// with the vector extension, a group of 8 vector registers is moved per iteration
+#ifdef __riscv_vector
+#define VCLOBBER "v8", "v9", "v10", "v11", "v12", "v13", "v14", "v15"
+#endif
+
 void *memset(void *s, int c, size_t n) {
   unsigned char *p = (unsigned char *)s;
+#ifdef __riscv_vector
+  for (size_t vl; n > 0; n -= vl, p += vl) {
+    asm volatile ("vsetvli %0, %1, e8, m8, ta, ma\n\t"
+                  "vmv.v.x v8, %2\n\t"
+                  "vse8.v v8, (%3)"
+                  : "=&r"(vl) : "r"(n), "r"(c), "r"(p) : "memory", VCLOBBER);
+  }
+#else
   while(n--)
     *p++ = (unsigned char)c;
+#endif
   return s;
 }
 
@@ -97,9 +124,18 @@ void *memmove(void *dst, const void *src, size_t n) {
 void *memcpy(void *out, const void *in, size_t n) {
   char *dst = out;
   const char *src = in;
+#ifdef __riscv_vector
+  for (size_t vl; n > 0; n -= vl, dst += vl, src += vl) {
+    asm volatile ("vsetvli %0, %1, e8, m8, ta, ma\n\t"
+                  "vle8.v v8, (%2)\n\t"
+                  "vse8.v v8, (%3)"
+                  : "=&r"(vl) : "r"(n), "r"(src), "r"(dst) : "memory", VCLOBBER);
+  }
+#else
   while(n--) {
     *dst++ = *src++;
   }
+#endif
   return out;
 }
 
@@ -1,7 +1,12 @@
 include $(AM_HOME)/scripts/isa/riscv.mk
 include $(AM_HOME)/scripts/platform/nemu.mk
 CFLAGS  += -DISA_H=\"riscv/riscv.h\"
-COMMON_CFLAGS += -march=rv32im_zicsr -mabi=ilp32  # overwrite
+# the extensions are opt-in for NEMU built with them: `make RVC=1' for CONFIG_RVC,
+# `make RVB=1' for CONFIG_RVB (Zba, Zbb and Zbs) and `make RVV=1' for CONFIG_RVV
+RV_C  := $(if $(RVC),c)
+RV_ZB := $(if $(RVB),_zba_zbb_zbs)
+RV_V  := $(if $(RVV),_zve32x)
+COMMON_CFLAGS += -march=rv32ima$(RV_C)_zicsr$(RV_ZB)$(RV_V) -mabi=ilp32  # overwrite
 LDFLAGS       += -melf32lriscv                     # overwrite
 
 AM_SRCS += riscv/nemu/start.S \
@@ -1,7 +1,11 @@
 include $(AM_HOME)/scripts/isa/riscv.mk
 include $(AM_HOME)/scripts/platform/nemu.mk
 CFLAGS  += -DISA_H=\"riscv/riscv.h\"
-COMMON_CFLAGS += -march=rv32em_zicsr -mabi=ilp32e  # overwrite
+# the extensions are opt-in for NEMU built with them: `make RVC=1' for CONFIG_RVC
+# and `make RVB=1' for CONFIG_RVB (Zba, Zbb and Zbs)
+RV_C  := $(if $(RVC),c)
+RV_ZB := $(if $(RVB),_zba_zbb_zbs)
+COMMON_CFLAGS += -march=rv32ema$(RV_C)_zicsr$(RV_ZB) -mabi=ilp32e  # overwrite
 LDFLAGS       += -melf32lriscv                     # overwrite
 
 AM_SRCS += riscv/nemu/start.S \
@@ -7,6 +7,36 @@
 static inline uint32_t translate_color(SDL_Color *color){
   return (color->a << 24) | (color->r << 16) | (color->g << 8) | color->b;
 }
+
+// copy or fill a row of pixels, a group of 8 vector registers at a time with the vector extension
+static inline void row_copy(void *dst, const void *src, size_t n) {
+#ifdef __riscv_vector
+  for (size_t vl; n > 0; n -= vl, dst = (uint8_t *)dst + vl, src = (const uint8_t *)src + vl) {
+    asm volatile ("vsetvli %0, %1, e8, m8, ta, ma\n\t"
+                  "vle8.v v8, (%2)\n\t"
+                  "vse8.v v8, (%3)"
+                  : "=&r"(vl) : "r"(n), "r"(src), "r"(dst)
+                  : "memory", "v8", "v9", "v10", "v11", "v12", "v13", "v14", "v15");
+  }
+#else
+  memcpy(dst, src, n);
+#endif
+}
+
+static inline void row_fill32(uint32_t *dst, uint32_t color, size_t n) {
+#ifdef __riscv_vector
+  for (size_t vl; n > 0; n -= vl, dst += vl) {
+    asm volatile ("vsetvli %0, %1, e32, m8, ta, ma\n\t"
+                  "vmv.v.x v8, %2\n\t"
+                  "vse32.v v8, (%3)"
+                  : "=&r"(vl) : "r"(n), "r"(color), "r"(dst)
+                  : "memory", "v8", "v9", "v10", "v11", "v12", "v13", "v14", "v15");
+  }
+#else
+  for (size_t i = 0; i < n; i ++) dst[i] = color;
+#endif
+}
+
 void SDL_BlitSurface(SDL_Surface *src, SDL_Rect *srcrect, SDL_Surface *dst, SDL_Rect *dstrect) {
   assert(dst && src);
   assert(dst->format->BitsPerPixel == src->format->BitsPerPixel);
@@ -29,21 +59,10 @@ void SDL_BlitSurface(SDL_Surface *src, SDL_Rect *srcrect, SDL_Surface *dst, SDL_
   // 定义获得像素地址的宏
 #define PIXEL_POS(surface, x, y) ((uint8_t*)(surface)->pixels + (y) * (surface)->pitch + (x) * ((surface)->format->BytesPerPixel))
 
-  // 按照像素深度进行循环，复制对应的像素数据
+  // 逐行复制像素数据
   int bpp = src->format->BytesPerPixel;
   for (int i = 0; i < rect_h; ++i) {
-    for (int j = 0; j < rect_w; ++j) {
-      // 计算源与目标的像素位置
-      uint8_t* src_pixel_pos = PIXEL_POS(src, src_x + j, src_y + i);
-      uint8_t* dst_pixel_pos = PIXEL_POS(dst, dst_x + j, dst_y + i);
-
-      // 根据像素位数进行像素数据复制
-      if (bpp == 4) {
-        *(uint32_t*)dst_pixel_pos = *(uint32_t*)src_pixel_pos;
-      } else if (bpp == 1) {
-        *dst_pixel_pos = *src_pixel_pos;
-      }
-    }
+    row_copy(PIXEL_POS(dst, dst_x, dst_y + i), PIXEL_POS(src, src_x, src_y + i), rect_w * bpp);
   }
 
 #undef PIXEL_POS
@@ -72,10 +91,7 @@ void SDL_FillRect(SDL_Surface *dst, SDL_Rect *dstrect, uint32_t color) {
     // 判断格式并做填充
     if (dst->format->BytesPerPixel == 4) {
       // 32位即每个像素4字节
-      uint32_t* row_pixel = (uint32_t*) (pixel + i * dst->pitch);
-      for (int j = 0; j < w; ++j) {
-        row_pixel[j] = color;
-      }
+      row_fill32((uint32_t*) (pixel + i * dst->pitch), color, w);
     } else if (dst->format->BytesPerPixel == 1) {
       // 8位即每个像素1字节（此部分为假设代码）
       // 实际上此处应该依赖于调色板来选择颜色，但是在本例中我们做简化处理
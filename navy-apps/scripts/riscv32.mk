@@ -1,3 +1,4 @@
 include $(NAVY_HOME)/scripts/riscv/common.mk
-CFLAGS  += -march=rv32g -mabi=ilp32  #overwrite
+# the vector extension is opt-in with `make RVV=1'
+CFLAGS  += -march=rv32g$(if $(RVV),_zve32x) -mabi=ilp32  #overwrite
 LDFLAGS += -melf32lriscv
@@ -0,0 +1,39 @@
+/***************************************************************************************
+* Copyright (c) 2014-2022 Zihao Yu, Nanjing University
+*
+* NEMU is licensed under Mulan PSL v2.
+* You can use this software according to the terms and conditions of the Mulan PSL v2.
+* You may obtain a copy of Mulan PSL v2 at:
+*          http://license.coscl.org.cn/MulanPSL2
+*
+* THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+* EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+* MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+*
+* See the Mulan PSL v2 for more details.
+***************************************************************************************/
+
+#ifndef __CPU_BPRED_H__
+#define __CPU_BPRED_H__
+
+#include <common.h>
+
+// attributes of an unconditional jump, decided by the ISA decoder
+#define BP_PUSH     0x1 // push the link address onto the RAS (call)
+#define BP_POP      0x2 // predict the target with the RAS (return)
+#define BP_INDIRECT 0x4 // the target comes from a register
+
+// return whether the branch or jump is mispredicted
+#ifdef CONFIG_BPRED
+bool bpred_branch(vaddr_t pc, bool taken);
+bool bpred_jump(vaddr_t pc, vaddr_t target, vaddr_t link, int attr);
+void bpred_report();
+void bpred_reset();
+#else
+static inline bool bpred_branch(vaddr_t pc, bool taken) { return false; }
+static inline bool bpred_jump(vaddr_t pc, vaddr_t target, vaddr_t link, int attr) { return false; }
+static inline void bpred_report() {}
+static inline void bpred_reset() {}
+#endif
+
+#endif
@@ -13,7 +13,19 @@
 * See the Mulan PSL v2 for more details.
 ***************************************************************************************/
 
-#include <isa.h>
+#ifndef __CPU_BREAKPOINT_H__
+#define __CPU_BREAKPOINT_H__
 
-void dev_raise_intr() {
-}
+#include <common.h>
+
+#ifdef CONFIG_BREAKPOINT
+extern int nr_bp;
+void bp_check(vaddr_t pc);
+// called after every instruction with the address of the next one,
+// costs a single predictable branch when no breakpoints are set
+static inline void bp_step(vaddr_t pc) { if (unlikely(nr_bp > 0)) bp_check(pc); }
+#else
+static inline void bp_step(vaddr_t pc) {}
+#endif
+
+#endif
@@ -24,15 +24,28 @@ void difftest_skip_ref();
 void difftest_skip_dut(int nr_ref, int nr_dut);
 void difftest_set_patch(void (*fn)(void *arg), void *arg);
 void difftest_step(vaddr_t pc, vaddr_t npc);
+void difftest_take_intr(word_t NO);
 void difftest_detach();
 void difftest_attach();
+void difftest_flush();
+#if CONFIG_DIFFTEST_BATCH > 1
+void difftest_log_store(paddr_t addr, int len);
+void difftest_isolate();
+#else
+static inline void difftest_log_store(paddr_t addr, int len) {}
+static inline void difftest_isolate() {}
+#endif
 #else
 static inline void difftest_skip_ref() {}
 static inline void difftest_skip_dut(int nr_ref, int nr_dut) {}
 static inline void difftest_set_patch(void (*fn)(void *arg), void *arg) {}
 static inline void difftest_step(vaddr_t pc, vaddr_t npc) {}
+static inline void difftest_take_intr(word_t NO) {}
 static inline void difftest_detach() {}
 static inline void difftest_attach() {}
+static inline void difftest_flush() {}
+static inline void difftest_log_store(paddr_t addr, int len) {}
+static inline void difftest_isolate() {}
 #endif
 
 extern void (*ref_difftest_memcpy)(paddr_t addr, void *buf, size_t n, bool direction);
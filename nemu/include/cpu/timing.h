@@ -0,0 +1,38 @@
+/***************************************************************************************
+* Copyright (c) 2014-2022 Zihao Yu, Nanjing University
+*
+* NEMU is licensed under Mulan PSL v2.
+* You can use this software according to the terms and conditions of the Mulan PSL v2.
+* You may obtain a copy of Mulan PSL v2 at:
+*          http://license.coscl.org.cn/MulanPSL2
+*
+* THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+* EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+* MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+*
+* See the Mulan PSL v2 for more details.
+***************************************************************************************/
+
+#ifndef __CPU_TIMING_H__
+#define __CPU_TIMING_H__
+
+#include <common.h>
+
+// instruction classes with different latencies, decided by the ISA decoder
+enum { TM_ALU, TM_MUL, TM_DIV, TM_LOAD, TM_STORE, TM_BRANCH, TM_JUMP, TM_SYSTEM, NR_TM_CLASS };
+
+#ifdef CONFIG_TIMING
+// `rd', `rs1' and `rs2' are 0 if the instruction does not use them
+void timing_inst(vaddr_t pc, int cls, int rd, int rs1, int rs2);
+void timing_mem(paddr_t addr, bool is_write);
+void timing_redirect(bool redirect);
+uint64_t timing_cycles();
+void timing_report();
+// the pipeline and the caches are back to the power-on state, and the statistics are cleared
+void timing_reset();
+#else
+static inline void timing_mem(paddr_t addr, bool is_write) {}
+static inline void timing_redirect(bool redirect) {}
+#endif
+
+#endif
@@ -0,0 +1,37 @@
+/***************************************************************************************
+* Copyright (c) 2014-2022 Zihao Yu, Nanjing University
+*
+* NEMU is licensed under Mulan PSL v2.
+* You can use this software according to the terms and conditions of the Mulan PSL v2.
+* You may obtain a copy of Mulan PSL v2 at:
+*          http://license.coscl.org.cn/MulanPSL2
+*
+* THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+* EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+* MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+*
+* See the Mulan PSL v2 for more details.
+***************************************************************************************/
+
+#ifndef __CPU_WATCHPOINT_H__
+#define __CPU_WATCHPOINT_H__
+
+#include <common.h>
+
+/* Hooks for watchpoints. They cost a single predictable branch
+ * when no watchpoints are set.
+ */
+#ifdef CONFIG_WATCHPOINT
+extern bool wp_active;
+void wp_check_store(paddr_t addr, int len);
+void wp_check(vaddr_t pc);
+// called for every store to pmem
+static inline void wp_store(paddr_t addr, int len) { if (unlikely(wp_active)) wp_check_store(addr, len); }
+// called after every instruction, `pc' is the address of the instruction
+static inline void wp_step(vaddr_t pc) { if (unlikely(wp_active)) wp_check(pc); }
+#else
+static inline void wp_store(paddr_t addr, int len) {}
+static inline void wp_step(vaddr_t pc) {}
+#endif
+
+#endif
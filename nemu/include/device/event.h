@@ -0,0 +1,40 @@
+/***************************************************************************************
+* Copyright (c) 2014-2022 Zihao Yu, Nanjing University
+*
+* NEMU is licensed under Mulan PSL v2.
+* You can use this software according to the terms and conditions of the Mulan PSL v2.
+* You may obtain a copy of Mulan PSL v2 at:
+*          http://license.coscl.org.cn/MulanPSL2
+*
+* THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+* EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+* MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+*
+* See the Mulan PSL v2 for more details.
+***************************************************************************************/
+
+#ifndef __DEVICE_EVENT_H__
+#define __DEVICE_EVENT_H__
+
+#include <common.h>
+
+/* Timed callbacks of the devices. Time is measured by the instructions
+ * retired by hart 0, which runs the callbacks that are due between two
+ * of its instructions. An event is known by its handler, which has at
+ * most one occurrence pending, scheduling it again replaces the old one.
+ */
+
+#define NR_EVENT 16 // events pending at the same time
+
+#define TIMER_HZ 60 // the render thread pumps the events of the window at this rate of host time
+
+typedef void (*event_handler_t)();
+
+// run `handler' when hart 0 has retired `when' instructions, cancel it if `when' is UINT64_MAX
+void event_schedule(event_handler_t handler, uint64_t when);
+// the time `handler' is pending for, UINT64_MAX if it is not pending
+uint64_t event_when(event_handler_t handler);
+// instructions retired by hart 0, the time of the events
+uint64_t event_now();
+
+#endif
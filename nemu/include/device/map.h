@@ -20,6 +20,8 @@
 
 // 定义I/O操作的回调函数的类型
 typedef void(*io_callback_t)(uint32_t, int, bool);
+// 定义设备在 NEMU 之外实现时的回调函数类型，设备自己保存寄存器，读操作时返回读到的数据，见 libnemu.h
+typedef uint64_t(*io_ext_callback_t)(void *opaque, uint64_t offset, int len, bool is_write, uint64_t data);
 
 // 定义一个函数，用于申请大小为size的新空间
 uint8_t* new_space(int size);
@@ -31,6 +33,8 @@ typedef struct {
   paddr_t high;             // 映射的结束地址
   void *space;              // 映射的地址空间
   io_callback_t callback;   // I/O操作时的回调函数
+  io_ext_callback_t ext_callback; // 外部设备的回调函数，非空时代替 space 和 callback
+  void *opaque;             // 传给外部设备回调函数的参数
 } IOMap;
 
 // 检查指定地址是否在映射范围内的内联函数
@@ -59,6 +63,9 @@ void add_pio_map(const char *name, ioaddr_t addr,
 // 添加MMIO映射的函数
 void add_mmio_map(const char *name, paddr_t addr,
         void *space, uint32_t len, io_callback_t callback);
+// 添加由外部设备处理的MMIO映射的函数
+void add_mmio_map_ext(const char *name, paddr_t addr,
+        uint32_t len, io_ext_callback_t callback, void *opaque);
 
 // 基于地址和数据长度从特定的I/O映射中读取的函数
 word_t map_read(paddr_t addr, int len, IOMap *map);
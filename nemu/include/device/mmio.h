@@ -16,9 +16,18 @@
 #ifndef __DEVICE_MMIO_H__
 #define __DEVICE_MMIO_H__
 
-#include <common.h>
+#include <machine.h>
 
 word_t mmio_read(paddr_t addr, int len);
 void mmio_write(paddr_t addr, int len, word_t data);
 
+#ifdef SMP_PARALLEL
+// the devices are not thread-safe, harts running in parallel access them one at a time
+void device_lock();
+void device_unlock();
+#else
+static inline void device_lock() {}
+static inline void device_unlock() {}
+#endif
+
 #endif
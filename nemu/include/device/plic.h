@@ -13,12 +13,18 @@
 * See the Mulan PSL v2 for more details.
 ***************************************************************************************/
 
-#ifndef __DEVICE_ALARM_H__
-#define __DEVICE_ALARM_H__
+#ifndef __DEVICE_PLIC_H__
+#define __DEVICE_PLIC_H__
 
-#define TIMER_HZ 60
+#include <common.h>
 
-typedef void (*alarm_handler_t) ();
-void add_alarm_handle(alarm_handler_t h);
+// interrupt sources of the PLIC, 0 means no interrupt
+enum { IRQ_KEYBOARD = 1 };
+
+#ifdef CONFIG_HAS_PLIC
+void plic_raise_irq(int irq);
+#else
+static inline void plic_raise_irq(int irq) {}
+#endif
 
 #endif
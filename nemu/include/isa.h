@@ -29,9 +29,10 @@ extern unsigned char isa_logo[]; // 声明一个外部的无符号字符数组
 void init_isa(); // 声明一个函数，用于初始化 ISA
 
 // reg
-extern CPU_state cpu; // 声明一个外部的 CPU 状态结构体变量，用于存放 CPU 的寄存器和程序计数器等信息
+// `cpu' is a part of the current machine, see machine.h // CPU 的寄存器和程序计数器等信息属于当前模拟的机器
 void isa_reg_display(); // 声明一个函数，用于显示 CPU 的寄存器的值
 word_t isa_reg_str2val(const char *name, bool *success); // 声明一个函数，用于根据寄存器的名字，返回寄存器的值，如果成功，把 success 设为 true，否则设为 false
+int isa_reg_str2idx(const char *name); // 根据寄存器的名字返回其在 cpu.gpr 中的下标，找不到时返回 -1
 
 // exec
 struct Decode; // 声明一个结构体类型，用于存放指令的解码信息
@@ -50,10 +51,15 @@ paddr_t isa_mmu_translate(vaddr_t vaddr, int len, int type); // 声明一个函
 vaddr_t isa_raise_intr(word_t NO, vaddr_t epc); // 声明一个函数，用于处理中断或异常，返回异常处理程序的入口地址
 #define INTR_EMPTY ((word_t)-1) // 定义一个宏，用于表示没有中断或异常发生
 word_t isa_query_intr(); // 声明一个函数，用于查询是否有中断或异常发生，返回中断或异常的编号，如果没有，返回 INTR_EMPTY
+#ifndef isa_intr_pending // ISA 可以提供一个快速的检查，为假时不必调用 isa_query_intr()
+#define isa_intr_pending() true
+#endif
 
 // difftest
 bool isa_difftest_checkregs(CPU_state *ref_r, vaddr_t pc); // 声明一个函数，用于进行差分测试，比较当前 CPU 状态和参考 CPU 状态是否一致，返回 true 或 false
 void isa_difftest_attach(); // 声明一个函数，用于进行差分测试，把当前 CPU 状态和参考 CPU 状态连接起来
 
+#include <machine.h> // `cpu' 在这里定义为当前机器的 CPU 状态
+
 #endif // 结束条件编译，与 #ifndef 对应
 
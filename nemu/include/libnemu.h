@@ -0,0 +1,98 @@
+/***************************************************************************************
+* Copyright (c) 2014-2022 Zihao Yu, Nanjing University
+*
+* NEMU is licensed under Mulan PSL v2.
+* You can use this software according to the terms and conditions of the Mulan PSL v2.
+* You may obtain a copy of Mulan PSL v2 at:
+*          http://license.coscl.org.cn/MulanPSL2
+*
+* THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+* EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+* MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+*
+* See the Mulan PSL v2 for more details.
+***************************************************************************************/
+
+#ifndef __LIBNEMU_H__
+#define __LIBNEMU_H__
+
+/* The embedding API of NEMU, exported by the shared object built with
+ * CONFIG_TARGET_SHARE and CONFIG_LIBNEMU. This header does not depend on
+ * the configuration, so it can be used by programs outside NEMU.
+ *
+ * A machine can be used by one thread at a time, while different machines
+ * can run on different threads at the same time. Physical addresses and
+ * register values are passed as uint64_t regardless of the guest ISA.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct Machine nemu_t;
+typedef struct nemu_snapshot nemu_snapshot_t;
+
+// the reason why nemu_run() returns
+enum {
+  NEMU_EVENT_BUDGET, // the given number of instructions are executed
+  NEMU_EVENT_STOP,   // nemu_stop() is called, e.g. by an MMIO callback
+  NEMU_EVENT_END,    // the guest hits the trap, see nemu_exit_code()
+  NEMU_EVENT_ABORT,  // the guest executes an invalid instruction
+};
+
+// index of the PC in nemu_reg_read() and nemu_reg_write()
+#define NEMU_REG_PC (-1)
+
+// called when the guest accesses an MMIO region, `offset' is relative to
+// the beginning of the region, `data' is only valid for writes, and the
+// return value is only used for reads
+typedef uint64_t (*nemu_mmio_callback_t)(void *opaque, uint64_t offset, int len,
+    bool is_write, uint64_t data);
+
+// create a machine which is reset with the built-in image loaded
+nemu_t* nemu_create();
+void nemu_destroy(nemu_t *m);
+
+// load a raw binary to the reset vector, or the PT_LOAD segments of an
+// ELF file to their physical addresses and set the PC to its entry,
+// return the number of bytes loaded or -1 on failure
+long nemu_load_image(nemu_t *m, const char *file);
+long nemu_load_elf(nemu_t *m, const char *file);
+
+// execute at most `n' instructions on each hart, return one of NEMU_EVENT_*
+int nemu_run(nemu_t *m, uint64_t n);
+void nemu_stop(nemu_t *m);
+int nemu_exit_code(nemu_t *m);
+uint64_t nemu_inst_count(nemu_t *m);
+
+// `idx' is the index of a general purpose register of hart 0 or NEMU_REG_PC,
+// nemu_reg_index() returns -2 if `name' is not a register
+int nemu_reg_index(const char *name);
+uint64_t nemu_reg_read(nemu_t *m, int idx);
+void nemu_reg_write(nemu_t *m, int idx, uint64_t val);
+
+// access the physical memory, return -1 if it is outside the memory
+int nemu_mem_read(nemu_t *m, uint64_t paddr, void *buf, size_t len);
+int nemu_mem_write(nemu_t *m, uint64_t paddr, const void *buf, size_t len);
+
+// let `callback' handle the accesses to [paddr, paddr + len), return -1
+// if there are too many regions, overlapping regions are fatal
+int nemu_add_mmio(nemu_t *m, const char *name, uint64_t paddr, uint32_t len,
+    nemu_mmio_callback_t callback, void *opaque);
+
+// save the registers, memory and device states of a machine, which can
+// be restored to the same machine or another one any times, the images
+// of the disks are not saved
+nemu_snapshot_t* nemu_snapshot(nemu_t *m);
+void nemu_restore(nemu_t *m, const nemu_snapshot_t *s);
+void nemu_snapshot_free(nemu_snapshot_t *s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
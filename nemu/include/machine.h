@@ -0,0 +1,184 @@
+/***************************************************************************************
+* Copyright (c) 2014-2022 Zihao Yu, Nanjing University
+*
+* NEMU is licensed under Mulan PSL v2.
+* You can use this software according to the terms and conditions of the Mulan PSL v2.
+* You may obtain a copy of Mulan PSL v2 at:
+*          http://license.coscl.org.cn/MulanPSL2
+*
+* THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+* EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+* MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+*
+* See the Mulan PSL v2 for more details.
+***************************************************************************************/
+
+#ifndef __MACHINE_H__
+#define __MACHINE_H__
+
+#include <isa.h>
+#include <device/map.h>
+#include <device/event.h>
+#include <memory/memhash.h>
+
+/* Everything about a simulated machine lives in a `Machine', so that
+ * one process can host many independent machines. The machine being
+ * simulated by the current host thread is pointed to by `machine', and
+ * the hart of it being simulated by `hart'.
+ * Debugging and performance models (watchpoints, breakpoints, difftest,
+ * branch prediction and timing) are still shared by the whole process.
+ */
+
+#ifdef CONFIG_NR_HART
+#define NR_HART CONFIG_NR_HART
+#else
+#define NR_HART 1
+#endif
+
+#if NR_HART > 1 && CONFIG_SMP_QUANTUM == 0
+#define SMP_PARALLEL 1 // every hart is simulated by its own host thread
+#endif
+
+#if defined(SMP_PARALLEL) && (defined(CONFIG_WATCHPOINT) || defined(CONFIG_BREAKPOINT) || defined(CONFIG_MEMHASH) || \
+    defined(CONFIG_BPRED) || defined(CONFIG_TIMING))
+#error "watchpoints, breakpoints, memhash and the performance models are not supported when the harts run in parallel"
+#endif
+
+#define NR_MAP 16
+#define PMEM_DIRTY_SHIFT 12 // granularity of the dirty bitmap of pmem
+#define NR_PMEM_DIRTY (((CONFIG_MSIZE >> PMEM_DIRTY_SHIFT) + 63) / 64)
+#define KEY_QUEUE_LEN 1024
+#define VGA_MAX_H 600 // scanlines of the largest screen
+
+// states of the devices in src/device/
+typedef struct {
+  struct {
+    uint64_t next; // the time of the first event, UINT64_MAX if there is none
+    struct {
+      uint64_t when;
+      event_handler_t handler;
+    } heap[NR_EVENT]; // a min-heap by `when'
+    int nr;
+  } event;
+  uint8_t *serial_base;
+  uint32_t *rtc_port_base;
+  void *vmem;
+  uint32_t *vgactl_port_base;
+  struct {
+    uint64_t rows[(VGA_MAX_H + 63) / 64]; // scanlines written since the last update of the screen
+    uint32_t x_lo, x_hi; // columns [x_lo, x_hi) written in these scanlines
+  } vga_dirty;
+  uint32_t *i8042_data_port_base;
+  int key_queue[KEY_QUEUE_LEN];
+  int key_f, key_r;
+  uint8_t *sbuf;
+  uint32_t sbuf_head; // offset of the next byte to play in sbuf
+  uint32_t *audio_base;
+  struct {
+    uint32_t *base;
+    uint64_t skew; // mtime minus the ticks counted from hart 0
+  } clint;
+  struct {
+    uint32_t priority[32];
+    uint32_t pending, claimed; // bit i for source i
+    uint32_t enable[NR_HART], threshold[NR_HART];
+  } plic;
+  struct {
+    FILE *fp;
+    uint32_t *base;
+    uint32_t blkcnt;
+    long blk_addr;
+    uint32_t addr;
+    bool write_cmd;
+    bool read_ext_csd;
+  } sdcard;
+} DeviceState;
+
+// a hardware thread, the harts of a machine share its memory and devices
+typedef struct {
+  CPU_state state; // accessed as `cpu' for the current hart
+  uint64_t nr_inst; // instructions retired by this hart
+  uint64_t deadline; // execute() checks for events, interrupts and stops when nr_inst reaches it
+} Hart;
+
+typedef struct Machine {
+  Hart harts[NR_HART];
+  NEMUState state;
+  uint64_t timer; // unit: us
+  bool print_step; // cpu_exec() of a few instructions prints every one of them
+
+  uint8_t *pmem;
+  uint8_t *pmem_alloc; // freed together with the machine
+  uint8_t pmem_fill; // every byte of pmem at power-on
+  uint64_t pmem_dirty[NR_PMEM_DIRTY]; // pages written since the last machine_reset()
+#ifdef CONFIG_MEMHASH
+  struct {
+    uint64_t page[MEMHASH_NR_PAGE];
+    uint64_t total;
+    bool valid; // the hashes are recomputed from pmem if not
+  } memhash;
+#endif
+
+  IOMap mmio_maps[NR_MAP];
+  int nr_mmio_map;
+  IOMap pio_maps[NR_MAP];
+  int nr_pio_map;
+  uint8_t *io_space;
+  uint8_t *p_space;
+  DeviceState dev;
+} Machine;
+
+#ifdef CONFIG_TARGET_AM
+#define MACHINE_TLS
+#else
+// initial-exec keeps the access cheap even when NEMU is a shared object
+#define MACHINE_TLS __thread __attribute__((tls_model("initial-exec")))
+#endif
+
+// the machine created by init_monitor(), every thread starts with it
+extern Machine default_machine;
+extern MACHINE_TLS Machine *machine;
+extern MACHINE_TLS Hart *hart;
+
+#define cpu (hart->state)
+#define nemu_state (machine->state)
+#define g_nr_guest_inst (hart->nr_inst)
+
+static inline bool machine_is_default() { return machine == &default_machine; }
+static inline int hart_id() { return hart - machine->harts; }
+
+// instructions retired by all harts of `m'
+static inline uint64_t machine_inst_count(Machine *m) {
+  uint64_t n = 0;
+  for (int i = 0; i < NR_HART; i ++) n += m->harts[i].nr_inst;
+  return n;
+}
+
+/* Make `h' check for events, interrupts and stops after its current
+ * instruction. Anything that may need the attention of a running hart
+ * calls it: a new earlier event, a change of pending or enabled
+ * interrupts, and a stop of the machine. It may be called by other threads.
+ */
+static inline void hart_kick(Hart *h) {
+  __atomic_store_n(&h->deadline, 0, __ATOMIC_SEQ_CST);
+}
+
+static inline void machine_kick(Machine *m) {
+  for (int i = 0; i < NR_HART; i ++) hart_kick(&m->harts[i]);
+}
+
+// create a machine with its own memory and devices, loaded with the built-in image
+Machine* machine_new();
+void machine_free(Machine *m);
+// reset the CPU, the dirty pages of pmem and the devices of the current machine
+void machine_reset();
+
+// let the current thread simulate hart 0 of `m', return the machine simulated before
+static inline Machine* machine_switch(Machine *m) {
+  Machine *old = machine;
+  machine = m;
+  hart = &m->harts[0];
+  return old;
+}
+
+#endif
@@ -0,0 +1,37 @@
+/***************************************************************************************
+* Copyright (c) 2014-2022 Zihao Yu, Nanjing University
+*
+* NEMU is licensed under Mulan PSL v2.
+* You can use this software according to the terms and conditions of the Mulan PSL v2.
+* You may obtain a copy of Mulan PSL v2 at:
+*          http://license.coscl.org.cn/MulanPSL2
+*
+* THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+* EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+* MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+*
+* See the Mulan PSL v2 for more details.
+***************************************************************************************/
+
+#ifndef __MEMORY_MEMHASH_H__
+#define __MEMORY_MEMHASH_H__
+
+#include <common.h>
+
+#define MEMHASH_PAGE_SHIFT 12
+#define MEMHASH_PAGE_SIZE (1 << MEMHASH_PAGE_SHIFT)
+#define MEMHASH_NR_PAGE (CONFIG_MSIZE >> MEMHASH_PAGE_SHIFT)
+
+#ifdef CONFIG_MEMHASH
+// called before `data' is written to pmem
+void memhash_store(paddr_t addr, int len, word_t data);
+// called after pmem is modified without paddr_write()
+void memhash_invalidate();
+// return the hash of the `page'-th page of pmem, or of the whole pmem if `page' is -1
+uint64_t memhash(int page);
+#else
+static inline void memhash_store(paddr_t addr, int len, word_t data) {}
+static inline void memhash_invalidate() {}
+#endif
+
+#endif
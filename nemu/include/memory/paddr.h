@@ -26,6 +26,12 @@
 uint8_t* guest_to_host(paddr_t paddr);
 /* convert the host virtual address in NEMU to guest physical address in the guest program */
 paddr_t host_to_guest(uint8_t *haddr);
+/* use `buf' of CONFIG_MSIZE bytes as the physical memory, e.g. the memory of DUT in difftest */
+void pmem_share(uint8_t *buf);
+/* mark [addr, addr + len) as written by means other than paddr_write() */
+void pmem_set_dirty(paddr_t addr, size_t len);
+/* restore the pages written since the last reset to the initial contents */
+void pmem_reset();
 
 static inline bool in_pmem(paddr_t addr) {
   return addr - CONFIG_MBASE < CONFIG_MSIZE;
@@ -33,5 +39,17 @@ static inline bool in_pmem(paddr_t addr) {
 
 word_t paddr_read(paddr_t addr, int len);
 void paddr_write(paddr_t addr, int len, word_t data);
+/* copy `len' bytes between [addr, addr + len) and `buf' at once, return false
+ * without accessing anything if the range is not entirely in pmem */
+bool paddr_read_block(paddr_t addr, void *buf, int len);
+bool paddr_write_block(paddr_t addr, const void *buf, int len);
+
+// operations of paddr_amo(), `min' and `max' compare signed values
+enum { AMO_SWAP, AMO_ADD, AMO_AND, AMO_OR, AMO_XOR, AMO_MIN, AMO_MAX, AMO_MINU, AMO_MAXU };
+/* atomically replace the data at `addr' with the result of `op' on it and `src',
+ * return the old data, only aligned accesses of 4 bytes are supported */
+word_t paddr_amo(paddr_t addr, int len, int op, word_t src);
+/* atomically write `desired' to `addr' if the data there is `expected', return whether it is written */
+bool paddr_cmpxchg(paddr_t addr, int len, word_t expected, word_t desired);
 
 #endif
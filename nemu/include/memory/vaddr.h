@@ -16,11 +16,15 @@
 #ifndef __MEMORY_VADDR_H__
 #define __MEMORY_VADDR_H__
 
-#include <common.h>
+#include <memory/paddr.h>
 
 word_t vaddr_ifetch(vaddr_t addr, int len);
 word_t vaddr_read(vaddr_t addr, int len);
 void vaddr_write(vaddr_t addr, int len, word_t data);
+word_t vaddr_amo(vaddr_t addr, int len, int op, word_t src);
+bool vaddr_cmpxchg(vaddr_t addr, int len, word_t expected, word_t desired);
+bool vaddr_read_block(vaddr_t addr, void *buf, int len);
+bool vaddr_write_block(vaddr_t addr, const void *buf, int len);
 
 #define PAGE_SHIFT        12
 #define PAGE_SIZE         (1ul << PAGE_SHIFT)
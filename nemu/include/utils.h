@@ -28,7 +28,7 @@ typedef struct {
   uint32_t halt_ret;
 } NEMUState;
 
-extern NEMUState nemu_state;
+// `nemu_state' is a part of the current machine, see machine.h
 
 // ----------- timer -----------
 
@@ -0,0 +1,328 @@
+/***************************************************************************************
+* Copyright (c) 2014-2022 Zihao Yu, Nanjing University
+*
+* NEMU is licensed under Mulan PSL v2.
+* You can use this software according to the terms and conditions of the Mulan PSL v2.
+* You may obtain a copy of Mulan PSL v2 at:
+*          http://license.coscl.org.cn/MulanPSL2
+*
+* THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+* EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+* MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+*
+* See the Mulan PSL v2 for more details.
+***************************************************************************************/
+
+#include <cpu/bpred.h>
+
+#ifdef CONFIG_BPRED
+
+#define TABLE_SIZE (1u << CONFIG_BPRED_TABLE_BITS)
+#define TABLE_MASK (TABLE_SIZE - 1)
+#define RAS_SIZE CONFIG_BPRED_RAS_SIZE
+
+// RISC-V instructions are at least 2-byte aligned
+#define PC_IDX(pc) ((uint32_t)((pc) >> 1))
+
+static uint64_t ghist = 0; // global history of conditional branches, newest in bit 0
+
+static inline int8_t sat_update(int8_t ctr, bool inc, int8_t min, int8_t max) {
+  if (inc) return (ctr < max ? ctr + 1 : ctr);
+  return (ctr > min ? ctr - 1 : ctr);
+}
+
+// --- direction predictors ---
+
+typedef struct {
+  const char *name;
+  bool (*predict)(vaddr_t pc);
+  void (*update)(vaddr_t pc, bool taken);
+} DirPredictor;
+
+// 2-bit saturating counters, shared by bimodal, gshare and the TAGE base table
+static int8_t pht[TABLE_SIZE] = {};
+
+#ifdef CONFIG_BPRED_BIMODAL
+static bool bimodal_predict(vaddr_t pc) {
+  return pht[PC_IDX(pc) & TABLE_MASK] >= 2;
+}
+
+static void bimodal_update(vaddr_t pc, bool taken) {
+  int8_t *c = &pht[PC_IDX(pc) & TABLE_MASK];
+  *c = sat_update(*c, taken, 0, 3);
+}
+
+static const DirPredictor dir = { "bimodal", bimodal_predict, bimodal_update };
+#endif
+
+#ifdef CONFIG_BPRED_GSHARE
+#define GSHARE_HIST_MASK BITMASK(CONFIG_BPRED_HIST_BITS)
+
+static inline uint32_t gshare_idx(vaddr_t pc) {
+  return (PC_IDX(pc) ^ (uint32_t)(ghist & GSHARE_HIST_MASK)) & TABLE_MASK;
+}
+
+static bool gshare_predict(vaddr_t pc) {
+  return pht[gshare_idx(pc)] >= 2;
+}
+
+static void gshare_update(vaddr_t pc, bool taken) {
+  int8_t *c = &pht[gshare_idx(pc)];
+  *c = sat_update(*c, taken, 0, 3);
+}
+
+static const DirPredictor dir = { "gshare", gshare_predict, gshare_update };
+#endif
+
+#ifdef CONFIG_BPRED_TAGE
+/* A small TAGE: a bimodal base predictor plus tagged tables indexed
+ * with geometrically increasing lengths of the global history.
+ * The longest hitting table provides the prediction.
+ */
+#define NR_TAGE 4
+#define TAGE_TAG_BITS 9
+#define TAGE_U_RESET_PERIOD (256 * 1024)
+
+typedef struct {
+  uint16_t tag;
+  int8_t ctr; // 3-bit signed, taken if >= 0
+  uint8_t u;  // 2-bit usefulness
+} TageEntry;
+
+static TageEntry tage[NR_TAGE][TABLE_SIZE] = {};
+static const int tage_hist_len[NR_TAGE] = { 5, 12, 27, 60 };
+
+static struct {
+  uint32_t idx[NR_TAGE];
+  uint16_t tag[NR_TAGE];
+  int provider, alt; // -1 means the base predictor
+  bool pred, alt_pred;
+} ctx;
+static uint64_t tage_nr_update = 0;
+
+static inline uint32_t fold_hist(int len, int bits) {
+  uint64_t h = (len >= 64 ? ghist : ghist & BITMASK(len));
+  uint32_t r = 0;
+  for (; h != 0; h >>= bits) r ^= h & BITMASK(bits);
+  return r;
+}
+
+static inline bool base_predict(vaddr_t pc) {
+  return pht[PC_IDX(pc) & TABLE_MASK] >= 2;
+}
+
+static bool tage_predict(vaddr_t pc) {
+  uint32_t p = PC_IDX(pc);
+  ctx.provider = ctx.alt = -1;
+  for (int t = 0; t < NR_TAGE; t ++) {
+    int len = tage_hist_len[t];
+    ctx.idx[t] = (p ^ (p >> CONFIG_BPRED_TABLE_BITS) ^ fold_hist(len, CONFIG_BPRED_TABLE_BITS)) & TABLE_MASK;
+    ctx.tag[t] = (p ^ fold_hist(len, TAGE_TAG_BITS) ^ (fold_hist(len, TAGE_TAG_BITS - 1) << 1)) &
+      BITMASK(TAGE_TAG_BITS);
+  }
+  for (int t = NR_TAGE - 1; t >= 0; t --) {
+    if (tage[t][ctx.idx[t]].tag == ctx.tag[t]) {
+      if (ctx.provider == -1) ctx.provider = t;
+      else { ctx.alt = t; break; }
+    }
+  }
+  ctx.alt_pred = (ctx.alt == -1 ? base_predict(pc) : tage[ctx.alt][ctx.idx[ctx.alt]].ctr >= 0);
+  ctx.pred = (ctx.provider == -1 ? base_predict(pc) : tage[ctx.provider][ctx.idx[ctx.provider]].ctr >= 0);
+  return ctx.pred;
+}
+
+static void tage_update(vaddr_t pc, bool taken) {
+  if (ctx.provider == -1) {
+    int8_t *c = &pht[PC_IDX(pc) & TABLE_MASK];
+    *c = sat_update(*c, taken, 0, 3);
+  } else {
+    TageEntry *e = &tage[ctx.provider][ctx.idx[ctx.provider]];
+    e->ctr = sat_update(e->ctr, taken, -4, 3);
+    if (ctx.pred != ctx.alt_pred) {
+      e->u = sat_update(e->u, ctx.pred == taken, 0, 3);
+    }
+  }
+
+  if (ctx.pred != taken) {
+    // allocate an entry in a table with longer history
+    bool allocated = false;
+    for (int t = ctx.provider + 1; t < NR_TAGE; t ++) {
+      TageEntry *e = &tage[t][ctx.idx[t]];
+      if (e->u == 0) {
+        *e = (TageEntry) { .tag = ctx.tag[t], .ctr = (taken ? 0 : -1), .u = 0 };
+        allocated = true;
+        break;
+      }
+    }
+    if (!allocated) {
+      for (int t = ctx.provider + 1; t < NR_TAGE; t ++) {
+        TageEntry *e = &tage[t][ctx.idx[t]];
+        e->u = sat_update(e->u, false, 0, 3);
+      }
+    }
+  }
+
+  if (++ tage_nr_update % TAGE_U_RESET_PERIOD == 0) {
+    for (int t = 0; t < NR_TAGE; t ++) {
+      for (int i = 0; i < TABLE_SIZE; i ++) tage[t][i].u >>= 1;
+    }
+  }
+}
+
+static const DirPredictor dir = { "TAGE-lite", tage_predict, tage_update };
+#endif
+
+// --- target predictors ---
+
+static vaddr_t ras[RAS_SIZE] = {};
+static int ras_top = 0, ras_nr = 0;
+static vaddr_t btb[TABLE_SIZE] = {};
+
+static void ras_push(vaddr_t addr) {
+  // overwrite the oldest entry on overflow, as hardware does
+  ras_top = (ras_top + 1) % RAS_SIZE;
+  ras[ras_top] = addr;
+  if (ras_nr < RAS_SIZE) ras_nr ++;
+}
+
+static vaddr_t ras_pop() {
+  if (ras_nr == 0) return 0;
+  vaddr_t addr = ras[ras_top];
+  ras_top = (ras_top + RAS_SIZE - 1) % RAS_SIZE;
+  ras_nr --;
+  return addr;
+}
+
+// --- statistics ---
+
+enum { BP_KIND_BRANCH, BP_KIND_JUMP, BP_KIND_CALL, BP_KIND_RET, BP_KIND_INDIRECT, NR_BP_KIND };
+static const char *kind_name[NR_BP_KIND] = { "branch", "jump", "call", "return", "indirect" };
+
+typedef struct {
+  vaddr_t pc;
+  int kind;
+  uint64_t cnt, miss;
+} BPStat;
+
+static BPStat *stat_tbl = NULL;
+static uint32_t stat_cap = 0, stat_nr = 0;
+static uint64_t total_cnt[NR_BP_KIND] = {}, total_miss[NR_BP_KIND] = {};
+
+static inline uint32_t stat_hash(vaddr_t pc) {
+  return (PC_IDX(pc) * 2654435761u);
+}
+
+static BPStat* stat_find(BPStat *tbl, uint32_t cap, vaddr_t pc) {
+  uint32_t i = stat_hash(pc) & (cap - 1);
+  while (tbl[i].cnt != 0 && tbl[i].pc != pc) i = (i + 1) & (cap - 1);
+  return &tbl[i];
+}
+
+static void stat_grow() {
+  uint32_t cap = (stat_cap == 0 ? 1024 : stat_cap * 2);
+  BPStat *tbl = calloc(cap, sizeof(BPStat));
+  assert(tbl);
+  for (uint32_t i = 0; i < stat_cap; i ++) {
+    if (stat_tbl[i].cnt != 0) *stat_find(tbl, cap, stat_tbl[i].pc) = stat_tbl[i];
+  }
+  free(stat_tbl);
+  stat_tbl = tbl;
+  stat_cap = cap;
+}
+
+static bool record(vaddr_t pc, int kind, bool miss) {
+  if (stat_nr * 2 >= stat_cap) stat_grow();
+  BPStat *s = stat_find(stat_tbl, stat_cap, pc);
+  if (s->cnt == 0) { s->pc = pc; s->kind = kind; stat_nr ++; }
+  s->cnt ++;
+  s->miss += miss;
+  total_cnt[kind] ++;
+  total_miss[kind] += miss;
+  return miss;
+}
+
+// --- interface ---
+
+bool bpred_branch(vaddr_t pc, bool taken) {
+  bool pred = dir.predict(pc);
+  dir.update(pc, taken);
+  ghist = (ghist << 1) | taken;
+  return record(pc, BP_KIND_BRANCH, pred != taken);
+}
+
+bool bpred_jump(vaddr_t pc, vaddr_t target, vaddr_t link, int attr) {
+  vaddr_t pred = target; // direct jumps are resolved at decode
+  int kind = BP_KIND_JUMP;
+  if (attr & BP_POP) {
+    pred = ras_pop();
+    kind = BP_KIND_RET;
+  } else if (attr & BP_INDIRECT) {
+    vaddr_t *e = &btb[PC_IDX(pc) & TABLE_MASK];
+    pred = *e;
+    *e = target;
+    kind = (attr & BP_PUSH ? BP_KIND_CALL : BP_KIND_INDIRECT);
+  } else if (attr & BP_PUSH) {
+    kind = BP_KIND_CALL;
+  }
+  if (attr & BP_PUSH) ras_push(link);
+  return record(pc, kind, pred != target);
+}
+
+// the predictors are back to the power-on state, and the statistics are cleared
+void bpred_reset() {
+  ghist = 0;
+  memset(pht, 0, sizeof(pht));
+#ifdef CONFIG_BPRED_TAGE
+  memset(tage, 0, sizeof(tage));
+  tage_nr_update = 0;
+#endif
+  memset(ras, 0, sizeof(ras));
+  ras_top = ras_nr = 0;
+  memset(btb, 0, sizeof(btb));
+  if (stat_tbl != NULL) memset(stat_tbl, 0, sizeof(BPStat) * stat_cap);
+  stat_nr = 0;
+  memset(total_cnt, 0, sizeof(total_cnt));
+  memset(total_miss, 0, sizeof(total_miss));
+}
+
+static int cmp_miss(const void *a, const void *b) {
+  const BPStat *x = a, *y = b;
+  if (x->miss != y->miss) return (x->miss < y->miss ? 1 : -1);
+  return (x->pc > y->pc) - (x->pc < y->pc);
+}
+
+static double rate(uint64_t miss, uint64_t cnt) {
+  return (cnt == 0 ? 0.0 : 100.0 * miss / cnt);
+}
+
+void bpred_report() {
+  uint64_t cnt = 0, miss = 0;
+  Log("branch predictor = %s, RAS entries = %d", dir.name, RAS_SIZE);
+  for (int k = 0; k < NR_BP_KIND; k ++) {
+    if (total_cnt[k] == 0) continue;
+    Log("%-8s: %'" PRIu64 " executed, %'" PRIu64 " mispredicted (%.2f%%)",
+        kind_name[k], total_cnt[k], total_miss[k], rate(total_miss[k], total_cnt[k]));
+    cnt += total_cnt[k];
+    miss += total_miss[k];
+  }
+  Log("overall : %'" PRIu64 " executed, %'" PRIu64 " mispredicted (%.2f%%)",
+      cnt, miss, rate(miss, cnt));
+
+  if (stat_nr == 0) return;
+  BPStat *sorted = malloc(sizeof(BPStat) * stat_nr);
+  assert(sorted);
+  int n = 0;
+  for (uint32_t i = 0; i < stat_cap; i ++) {
+    if (stat_tbl[i].cnt != 0) sorted[n ++] = stat_tbl[i];
+  }
+  qsort(sorted, n, sizeof(BPStat), cmp_miss);
+  if (n > CONFIG_BPRED_REPORT_TOP) n = CONFIG_BPRED_REPORT_TOP;
+  for (int i = 0; i < n && sorted[i].miss > 0; i ++) {
+    Log("  pc = " FMT_WORD " %-8s: %'" PRIu64 " executed, %'" PRIu64 " mispredicted (%.2f%%)",
+        sorted[i].pc, kind_name[sorted[i].kind], sorted[i].cnt, sorted[i].miss,
+        rate(sorted[i].miss, sorted[i].cnt));
+  }
+  free(sorted);
+}
+
+#endif
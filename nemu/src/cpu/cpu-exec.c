@@ -16,7 +16,14 @@
 #include <cpu/cpu.h>
 #include <cpu/decode.h>
 #include <cpu/difftest.h>
+#include <cpu/bpred.h>
+#include <cpu/timing.h>
+#include <cpu/watchpoint.h>
+#include <cpu/breakpoint.h>
 #include <locale.h>
+#ifdef SMP_PARALLEL
+#include <pthread.h>
+#endif
 
 /* The assembly code of instructions executed is only output to the screen
  * when the number of instructions executed is less than this value.
@@ -25,12 +32,12 @@
  */
 #define MAX_INST_TO_PRINT 2147483647
 
-CPU_state cpu = {}; // 定义一个结构体变量，用于存放 CPU 的状态，例如寄存器的值
-uint64_t g_nr_guest_inst = 0; // 定义一个全局变量，用于统计执行的指令数
-static uint64_t g_timer = 0; // unit: us // 定义一个静态变量，用于记录模拟器的运行时间，单位是微秒
-static bool g_print_step = false; // 定义一个静态变量，用于控制是否打印每条指令的信息
+// `cpu' 和执行的指令数 `g_nr_guest_inst' 都属于当前模拟的 hart，见 machine.h
+#define g_timer (machine->timer) // unit: us // 模拟器的运行时间，单位是微秒，每台机器各自统计
+#define g_print_step (machine->print_step) // 是否打印每条指令的信息，每台机器各自决定
 
-void device_update(); // 声明一个函数，用于更新设备的状态，例如键盘、鼠标、屏幕等
+void event_run(); // 运行已经到期的设备事件
+void clint_skip_idle(); // 把 mtime 直接推进到下一个 mtimecmp
 
 static void trace_and_difftest(Decode *_this, vaddr_t dnpc) { // 定义一个静态函数，用于跟踪和对比测试指令，参数是一个解码结构体和动态的下一条指令的地址
 #ifdef CONFIG_ITRACE_COND // 如果定义了 CONFIG_ITRACE_COND 这个宏，表示开启了指令跟踪的条件
@@ -71,25 +78,133 @@ static void exec_once(Decode *s, vaddr_t pc) { // 定义一个静态函数，用
 #endif
 }
 
+// 在两条指令之间响应已经挂起并且打开的中断，差分测试时让 REF 也进入同一个中断
+static inline void check_intr() {
+  if (likely(!isa_intr_pending())) return;
+  word_t intr = isa_query_intr();
+  if (intr == INTR_EMPTY) return;
+  cpu.pc = isa_raise_intr(intr, cpu.pc);
+  difftest_take_intr(intr);
+}
+
+/* 当前 hart 执行 wfi 并且没有可以唤醒它的中断时调用。只有一个 hart 时，
+ * 在下一次时钟中断之前什么都不会发生，于是跳过这段空闲的时间；否则其他
+ * hart 还在运行，wfi 就当作 nop，之后会再次执行到它。
+ */
+void cpu_idle() {
+#ifdef CONFIG_HAS_CLINT
+  if (NR_HART == 1) clint_skip_idle();
+#endif
+}
+
+// 有监视点或者断点时，每条指令之后都要检查它们
+static inline bool debug_active() {
+  return MUXDEF(CONFIG_WATCHPOINT, wp_active, false) || MUXDEF(CONFIG_BREAKPOINT, nr_bp > 0, false);
+}
+
+/* 指令数到达 hart->deadline 时才进行的检查，返回是否继续执行。先把 deadline
+ * 置为最大值，检查之后再换成新的 deadline，这期间其他线程调用 hart_kick()
+ * 把它置为 0 时保持为 0，下一条指令之后会再次检查。
+ */
+static bool check_deadline(Decode *s) {
+  __atomic_store_n(&hart->deadline, UINT64_MAX, __ATOMIC_SEQ_CST);
+#ifdef CONFIG_DEVICE
+  if (hart_id() == 0 && g_nr_guest_inst >= machine->dev.event.next) event_run(); // 设备只在事件到期时由 hart 0 处理，时钟中断、屏幕和输入都是事件
+#endif
+  check_intr(); // 中断的入口作为下一条指令，断点和监视点都在它之后检查
+  bool debug = debug_active();
+  if (debug) {
+    wp_step(s->pc); // 检查监视点，值发生变化时把模拟器的状态设置为停止
+    bp_step(cpu.pc); // 检查下一条指令处是否有断点，命中时把模拟器的状态设置为停止
+  }
+  if (nemu_state.state != NEMU_RUNNING) return false;
+
+  uint64_t deadline = UINT64_MAX;
+#ifdef CONFIG_DEVICE
+  if (hart_id() == 0) deadline = machine->dev.event.next;
+#endif
+  if (debug) deadline = g_nr_guest_inst + 1;
+  uint64_t expected = UINT64_MAX;
+  __atomic_compare_exchange_n(&hart->deadline, &expected, deadline, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+  return true;
+}
+
 static void execute(uint64_t n) { // 定义一个静态函数，用于执行 n 条指令，参数是一个无符号的 64 位整数
   Decode s; // 定义一个解码结构体变量，用于存放指令的解码信息
   for (;n > 0; n --) { // 用一个循环，从 n 到 0，每次减 1
     exec_once(&s, cpu.pc); // 调用 exec_once 函数，执行一条指令，传递解码结构体的指针和 CPU 状态中的 pc 变量
     g_nr_guest_inst ++; // 把全局变量 g_nr_guest_inst 加 1，表示执行的指令数增加
     trace_and_difftest(&s, cpu.pc); // 调用 trace_and_difftest 函数，跟踪和对比测试指令，传递解码结构体的指针和 CPU 状态中的 pc 变量
-    if (nemu_state.state != NEMU_RUNNING) break; // 如果模拟器的状态不是运行中，就跳出循环
-    IFDEF(CONFIG_DEVICE, device_update()); // 如果开启了设备模拟，就调用 device_update 函数，更新设备的状态
+    // 设备事件、中断、监视点、断点和停止都只在指令数到达 deadline 时检查
+    if (unlikely(g_nr_guest_inst >= __atomic_load_n(&hart->deadline, __ATOMIC_RELAXED)) && !check_deadline(&s)) break;
   }
+  difftest_flush(); // 批量差分测试时，比较本批次中尚未比较的指令
 }
 
+#if NR_HART > 1
+#ifndef SMP_PARALLEL
+// 各个 hart 在当前线程上轮流执行，每次最多执行 CONFIG_SMP_QUANTUM 条指令，每个 hart 最多执行 n 条指令
+static void execute_harts(uint64_t n) {
+  while (n > 0 && nemu_state.state == NEMU_RUNNING) {
+    uint64_t q = (n < CONFIG_SMP_QUANTUM ? n : CONFIG_SMP_QUANTUM);
+    for (int i = 0; i < NR_HART && nemu_state.state == NEMU_RUNNING; i ++) {
+      hart = &machine->harts[i];
+      execute(q);
+    }
+    n -= q;
+  }
+  hart = &machine->harts[0]; // 调试器等总是看到 hart 0
+}
+#else
+typedef struct {
+  Machine *m;
+  int id;
+  uint64_t n;
+} HartArg;
+
+static void *hart_thread(void *arg) {
+  HartArg *a = arg;
+  machine = a->m;
+  hart = &a->m->harts[a->id];
+  execute(a->n);
+  return NULL;
+}
+
+// 每个 hart 由一个宿主线程模拟，并行执行，直到各自执行了 n 条指令或者模拟器停止
+static void execute_harts(uint64_t n) {
+  pthread_t tid[NR_HART];
+  HartArg arg[NR_HART];
+  for (int i = 1; i < NR_HART; i ++) {
+    arg[i] = (HartArg){ .m = machine, .id = i, .n = n };
+    int ret = pthread_create(&tid[i], NULL, hart_thread, &arg[i]);
+    assert(ret == 0);
+  }
+  execute(n); // hart 0 在当前线程上执行，并负责更新设备
+  for (int i = 1; i < NR_HART; i ++) {
+    pthread_join(tid[i], NULL);
+  }
+}
+#endif
+#endif
+
 
 static void statistic() { // 定义一个静态函数，用于打印模拟器的运行统计信息
-  IFNDEF(CONFIG_TARGET_AM, setlocale(LC_NUMERIC, "")); // 如果没有定义 CONFIG_TARGET_AM 这个宏，表示不是在 AM 平台上运行，就设置本地化的数字格式，例如千位分隔符
+#ifndef CONFIG_TARGET_AM
+  // 只在当前线程使用本地化的数字格式，例如千位分隔符，其他线程上的机器和 JSON 报告不受影响
+  locale_t loc = newlocale(LC_NUMERIC_MASK, "", (locale_t)0);
+  locale_t old = (loc ? uselocale(loc) : (locale_t)0);
+#endif
 #define NUMBERIC_FMT MUXDEF(CONFIG_TARGET_AM, "%", "%'") PRIu64 // 定义一个宏，用于格式化无符号的 64 位整数，根据不同的平台，选择是否使用千位分隔符
   Log("host time spent = " NUMBERIC_FMT " us", g_timer); // 把全局变量 g_timer，表示模拟器的运行时间，以微秒为单位，格式化输出到日志中
-  Log("total guest instructions = " NUMBERIC_FMT, g_nr_guest_inst); // 把全局变量 g_nr_guest_inst，表示执行的指令数，格式化输出到日志中
-  if (g_timer > 0) Log("simulation frequency = " NUMBERIC_FMT " inst/s", g_nr_guest_inst * 1000000 / g_timer); // 如果模拟器的运行时间大于 0，就计算并输出模拟器的执行频率，等于指令数乘以 1000000 除以运行时间，以每秒为单位
+  uint64_t nr_inst = machine_inst_count(machine); // 所有 hart 执行的指令数之和
+  Log("total guest instructions = " NUMBERIC_FMT, nr_inst); // 把执行的指令数格式化输出到日志中
+  if (g_timer > 0) Log("simulation frequency = " NUMBERIC_FMT " inst/s", nr_inst * 1000000 / g_timer); // 如果模拟器的运行时间大于 0，就计算并输出模拟器的执行频率，等于指令数乘以 1000000 除以运行时间，以每秒为单位
   else Log("Finish running in less than 1 us and can not calculate the simulation frequency"); // 如果模拟器的运行时间小于等于 0，就输出无法计算执行频率的信息
+  IFDEF(CONFIG_BPRED, bpred_report()); // 如果开启了分支预测模型，就输出各 PC 和总体的预测失败率
+  IFDEF(CONFIG_TIMING, timing_report()); // 如果开启了时序模型，就输出估算的周期数和 IPC
+#ifndef CONFIG_TARGET_AM
+  if (loc) { uselocale(old); freelocale(loc); }
+#endif
 }
 
 void assert_fail_msg() { // 定义一个函数，用于处理断言失败的情况
@@ -106,10 +221,15 @@ void cpu_exec(uint64_t n) { // 定义一个函数，用于模拟 CPU 的工作
       return; // 返回函数
     default: nemu_state.state = NEMU_RUNNING; // 如果模拟器的状态是其他情况，就把模拟器的状态设置为运行中
   }
+  machine_kick(machine); // 监视点和断点可能已经改变，第一条指令之后重新计算 deadline
 
   uint64_t timer_start = get_time(); // 定义一个局部变量，用于存放模拟器开始执行的时间，调用 get_time 函数获取当前的时间
 
+#if NR_HART > 1
+  execute_harts(n); // 多个 hart 时，每个 hart 各执行 n 条指令
+#else
   execute(n); // 调用 execute 函数，执行 n 条指令
+#endif
 
   uint64_t timer_end = get_time(); // 定义一个局部变量，用于存放模拟器结束执行的时间，调用 get_time 函数获取当前的时间
   g_timer += timer_end - timer_start; // 把全局变量 g_timer，表示模拟器的运行时间，增加结束时间减去开始时间的差值
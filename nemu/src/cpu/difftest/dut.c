@@ -17,7 +17,9 @@
 
 #include <isa.h>
 #include <cpu/cpu.h>
+#include <memory/host.h>
 #include <memory/paddr.h>
+#include <memory/memhash.h>
 #include <utils.h>
 #include <difftest-def.h>
 
@@ -31,6 +33,278 @@ void (*ref_difftest_raise_intr)(uint64_t NO) = NULL;
 static bool is_skip_ref = false;
 static int skip_dut_nr_inst = 0;
 
+static void checkregs(CPU_state *ref, vaddr_t pc);
+
+#if CONFIG_DIFFTEST_MEMHASH_INTERVAL > 0
+/* Compare the memory hashes of DUT and REF every once in a while. When they
+ * are different, find the first different page by the page hashes, then the
+ * first different word by copying the page from REF.
+ */
+static uint64_t (*ref_difftest_memhash)(int page) = NULL;
+static uint64_t nr_inst_unchecked = 0;
+
+static void checkmem() {
+  if (memhash(-1) == ref_difftest_memhash(-1)) return;
+  for (int i = 0; i < MEMHASH_NR_PAGE; i ++) {
+    if (memhash(i) == ref_difftest_memhash(i)) continue;
+    paddr_t base = CONFIG_MBASE + ((paddr_t)i << MEMHASH_PAGE_SHIFT);
+    static uint32_t ref_page[MEMHASH_PAGE_SIZE / 4];
+    uint32_t *dut_page = (uint32_t *)guest_to_host(base);
+    ref_difftest_memcpy(base, ref_page, MEMHASH_PAGE_SIZE, DIFFTEST_TO_DUT);
+    for (int j = 0; j < MEMHASH_PAGE_SIZE / 4; j ++) {
+      if (ref_page[j] != dut_page[j]) {
+        Log("memory is different at " FMT_PADDR " before pc = " FMT_WORD
+            ", right = 0x%08x, wrong = 0x%08x", base + j * 4, cpu.pc, ref_page[j], dut_page[j]);
+        break;
+      }
+    }
+    nemu_state.state = NEMU_ABORT;
+    nemu_state.halt_pc = cpu.pc;
+    machine_kick(machine);
+    return;
+  }
+}
+
+static void checkpoint(int nr_inst) {
+  nr_inst_unchecked += nr_inst;
+  if (nr_inst_unchecked >= CONFIG_DIFFTEST_MEMHASH_INTERVAL && nemu_state.state != NEMU_ABORT) {
+    nr_inst_unchecked = 0;
+    checkmem();
+  }
+}
+#else
+static void checkpoint(int nr_inst) { }
+#endif
+
+#if CONFIG_DIFFTEST_BATCH > 1
+/* Let REF run a batch of instructions at once and compare the states only
+ * at the end of the batch. The registers of DUT after every instruction and
+ * the old data of every store are recorded, so that REF can be rolled back
+ * to the beginning of the batch and the first mismatching instruction can be
+ * found by bisection. Only the registers and the memory can be rolled back,
+ * so an instruction writing other states, e.g. the CSRs, is checked alone
+ * between two batches, see difftest_isolate().
+ */
+#define BATCH CONFIG_DIFFTEST_BATCH
+#define NR_UNDO (BATCH * 4)
+
+typedef struct {
+  vaddr_t pc;
+  uint8_t regs[DIFFTEST_REG_SIZE]; // registers after executing the instruction at `pc'
+} Trace;
+
+typedef struct {
+  paddr_t addr;
+  int len;
+  int idx; // index of the instruction in the batch
+  word_t old;
+} Undo;
+
+static Trace trace[BATCH];
+static int nr_trace = 0;
+static uint8_t last_good[DIFFTEST_REG_SIZE];
+static Undo undo[NR_UNDO];
+static int nr_undo = 0;
+static bool undo_overflow = false;
+static bool isolate = false;
+
+void difftest_log_store(paddr_t addr, int len) {
+  if (nr_undo == NR_UNDO) { undo_overflow = true; return; }
+  undo[nr_undo ++] = (Undo) { .addr = addr, .len = len, .idx = nr_trace,
+    .old = host_read(guest_to_host(addr), len) };
+}
+
+// the instruction being executed writes states which can not be rolled back in REF
+void difftest_isolate() {
+  isolate = true;
+}
+
+static void batch_reset(const void *good) {
+  memcpy(last_good, good, DIFFTEST_REG_SIZE);
+  nr_trace = 0;
+  nr_undo = 0;
+  undo_overflow = false;
+  isolate = false;
+}
+
+static bool check_trace(CPU_state *ref_r, int i) {
+  uint8_t dut[DIFFTEST_REG_SIZE];
+  memcpy(dut, &cpu, DIFFTEST_REG_SIZE);
+  memcpy(&cpu, trace[i].regs, DIFFTEST_REG_SIZE);
+  bool ok = isa_difftest_checkregs(ref_r, trace[i].pc);
+  memcpy(&cpu, dut, DIFFTEST_REG_SIZE);
+  return ok;
+}
+
+static void rollback_ref() {
+  for (int i = nr_undo - 1; i >= 0; i --) {
+    ref_difftest_memcpy(undo[i].addr, &undo[i].old, undo[i].len, DIFFTEST_TO_REF);
+  }
+  ref_difftest_regcpy(last_good, DIFFTEST_TO_REF);
+}
+
+// the first `lo' instructions of the batch match, but the first `hi' do not,
+// `ref_r' is already the state of REF after a batch of one instruction
+static void bisect(CPU_state *ref_r) {
+  int lo = 0, hi = nr_trace;
+  if (nr_trace > 1 && !undo_overflow) {
+    while (hi - lo > 1) {
+      int mid = (lo + hi) / 2;
+      rollback_ref();
+      ref_difftest_exec(mid);
+      ref_difftest_regcpy(ref_r, DIFFTEST_TO_DUT);
+      if (check_trace(ref_r, mid - 1)) lo = mid;
+      else hi = mid;
+    }
+    rollback_ref();
+    ref_difftest_exec(hi);
+    ref_difftest_regcpy(ref_r, DIFFTEST_TO_DUT);
+    Log("The first mismatch in a batch of %d instructions is found by bisection", nr_trace);
+  } else if (undo_overflow) {
+    Log("Too many stores to roll back, the mismatch is reported at the end of the batch");
+  }
+
+  // bring DUT back to the state right after the mismatching instruction,
+  // other states than the registers are not written in the batch
+  for (int i = nr_undo - 1; i >= 0 && undo[i].idx >= hi; i --) {
+    host_write(guest_to_host(undo[i].addr), undo[i].len, undo[i].old);
+  }
+  memhash_invalidate();
+  memcpy(&cpu, trace[hi - 1].regs, DIFFTEST_REG_SIZE);
+  checkregs(ref_r, trace[hi - 1].pc);
+}
+
+static void batch_flush() {
+  if (nr_trace == 0) return;
+  CPU_state ref_r;
+  ref_difftest_exec(nr_trace);
+  ref_difftest_regcpy(&ref_r, DIFFTEST_TO_DUT);
+  if (!check_trace(&ref_r, nr_trace - 1)) {
+    bisect(&ref_r);
+    return;
+  }
+  int n = nr_trace;
+  batch_reset(trace[nr_trace - 1].regs);
+  checkpoint(n);
+}
+
+void difftest_flush() {
+  if (nemu_state.state != NEMU_ABORT) batch_flush();
+}
+#elif defined(CONFIG_DIFFTEST_THREAD)
+/* REF runs on its own thread. DUT publishes its registers after every
+ * instruction into a single-producer single-consumer ring, while REF
+ * consumes the records, steps and compares in parallel. The first
+ * mismatch is reported back to DUT through `mismatch'. The REF thread
+ * has its own hart holding the registers of the record being checked, so
+ * that isa_difftest_checkregs() sees them as `cpu'.
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#define QUEUE_SIZE 4096 // must be a power of 2
+
+enum { REC_STEP, REC_SYNC, REC_INTR };
+
+typedef struct {
+  int type; // REC_STEP: REF executes an instruction and compares with `regs'
+            // REC_SYNC: copy `regs' to REF to skip an instruction
+            // REC_INTR: REF takes the interrupt `pc'
+  vaddr_t pc;
+  uint8_t regs[DIFFTEST_REG_SIZE]; // registers of DUT after executing the instruction at `pc'
+} Record;
+
+static Record queue[QUEUE_SIZE];
+static uint64_t q_head = 0; // only written by DUT
+static uint64_t q_tail = 0; // only written by REF
+static bool mismatch = false, reported = false;
+static Record bad;
+static CPU_state bad_ref;
+static Hart ref_view; // `hart' of the REF thread
+
+static void* ref_thread(void *arg) {
+  CPU_state ref_r;
+  int idle = 0;
+  hart = &ref_view;
+  for (uint64_t tail = 0; ; tail ++) {
+    while (tail == __atomic_load_n(&q_head, __ATOMIC_ACQUIRE)) {
+      // do not burn the host CPU when DUT is waiting for commands in sdb
+      if (++ idle < 1000) sched_yield();
+      else usleep(100);
+    }
+    idle = 0;
+
+    Record *r = &queue[tail & (QUEUE_SIZE - 1)];
+    if (r->type == REC_SYNC) {
+      ref_difftest_regcpy(r->regs, DIFFTEST_TO_REF);
+    } else if (r->type == REC_INTR) {
+      ref_difftest_raise_intr(r->pc);
+    } else {
+      ref_difftest_exec(1);
+      ref_difftest_regcpy(&ref_r, DIFFTEST_TO_DUT);
+      memcpy(&cpu, r->regs, DIFFTEST_REG_SIZE);
+      if (!isa_difftest_checkregs(&ref_r, r->pc)) {
+        bad = *r;
+        bad_ref = ref_r;
+        __atomic_store_n(&mismatch, true, __ATOMIC_RELEASE);
+        return NULL;
+      }
+    }
+    __atomic_store_n(&q_tail, tail + 1, __ATOMIC_RELEASE);
+  }
+}
+
+static void start_ref_thread() {
+  pthread_t t;
+  int ret = pthread_create(&t, NULL, ref_thread, NULL);
+  assert(ret == 0);
+  pthread_detach(t);
+}
+
+static bool check_mismatch() {
+  if (likely(!__atomic_load_n(&mismatch, __ATOMIC_ACQUIRE))) return false;
+  if (!reported) {
+    reported = true;
+    Log("REF reports a mismatch while DUT has run %" PRIu64 " instructions ahead",
+        q_head - __atomic_load_n(&q_tail, __ATOMIC_ACQUIRE) - 1);
+    memcpy(&cpu, bad.regs, DIFFTEST_REG_SIZE);
+    checkregs(&bad_ref, bad.pc);
+  }
+  return true;
+}
+
+static void publish(int type, vaddr_t pc) {
+  while (q_head - __atomic_load_n(&q_tail, __ATOMIC_ACQUIRE) == QUEUE_SIZE) {
+    if (check_mismatch()) return;
+    sched_yield();
+  }
+  Record *r = &queue[q_head & (QUEUE_SIZE - 1)];
+  r->type = type;
+  r->pc = pc;
+  memcpy(r->regs, &cpu, DIFFTEST_REG_SIZE);
+  __atomic_store_n(&q_head, q_head + 1, __ATOMIC_RELEASE);
+}
+
+// wait until REF catches up with DUT
+static void batch_flush() {
+  while (__atomic_load_n(&q_tail, __ATOMIC_ACQUIRE) != q_head) {
+    if (check_mismatch()) return;
+    sched_yield();
+  }
+}
+
+static void batch_reset(const void *good) { }
+
+void difftest_flush() {
+  batch_flush();
+}
+#else
+static void batch_flush() { }
+static void batch_reset(const void *good) { }
+void difftest_flush() { }
+#endif
+
 // this is used to let ref skip instructions which
 // can not produce consistent behavior with NEMU
 void difftest_skip_ref() {
@@ -52,6 +326,7 @@ void difftest_skip_ref() {
 //   Let REF run `nr_ref` instructions first.
 //   We expect that DUT will catch up with REF within `nr_dut` instructions.
 void difftest_skip_dut(int nr_ref, int nr_dut) {
+  batch_flush();
   skip_dut_nr_inst += nr_dut;
 
   while (nr_ref -- > 0) {
@@ -87,18 +362,43 @@ void init_difftest(char *ref_so_file, long img_size, int port) {
       "If it is not necessary, you can turn it off in menuconfig.", ref_so_file);
 
   ref_difftest_init(port);
+#if CONFIG_DIFFTEST_MEMHASH_INTERVAL > 0
+  ref_difftest_memhash = dlsym(handle, "difftest_memhash");
+  assert(ref_difftest_memhash);
+#endif
+#ifdef CONFIG_DIFFTEST_SHARE_MEM
+  void (*ref_difftest_memshare)(void *buf) = dlsym(handle, "difftest_memshare");
+  assert(ref_difftest_memshare);
+  ref_difftest_memshare(guest_to_host(PMEM_LEFT));
+#else
   ref_difftest_memcpy(RESET_VECTOR, guest_to_host(RESET_VECTOR), img_size, DIFFTEST_TO_REF);
+#endif
   ref_difftest_regcpy(&cpu, DIFFTEST_TO_REF);
+  batch_reset(&cpu);
+  IFDEF(CONFIG_DIFFTEST_THREAD, start_ref_thread());
 }
 
 static void checkregs(CPU_state *ref, vaddr_t pc) {
   if (!isa_difftest_checkregs(ref, pc)) {
     nemu_state.state = NEMU_ABORT;
     nemu_state.halt_pc = pc;
+    machine_kick(machine);
     isa_reg_display();
   }
 }
 
+// DUT takes an interrupt between two instructions, REF should take the same one
+void difftest_take_intr(word_t NO) {
+#ifdef CONFIG_DIFFTEST_THREAD
+  if (!check_mismatch()) publish(REC_INTR, NO);
+  return;
+#endif
+  batch_flush();
+  if (nemu_state.state == NEMU_ABORT) return;
+  ref_difftest_raise_intr(NO);
+  batch_reset(&cpu);
+}
+
 void difftest_step(vaddr_t pc, vaddr_t npc) {
   CPU_state ref_r;
 
@@ -107,6 +407,7 @@ void difftest_step(vaddr_t pc, vaddr_t npc) {
     if (ref_r.pc == npc) {
       skip_dut_nr_inst = 0;
       checkregs(&ref_r, npc);
+      batch_reset(&cpu);
       return;
     }
     skip_dut_nr_inst --;
@@ -115,17 +416,48 @@ void difftest_step(vaddr_t pc, vaddr_t npc) {
     return;
   }
 
+#ifdef CONFIG_DIFFTEST_THREAD
+  if (check_mismatch()) return;
+  publish(is_skip_ref ? REC_SYNC : REC_STEP, pc);
+  is_skip_ref = false;
+  return;
+#endif
+
   if (is_skip_ref) {
+    // REF should catch up with the instructions before this one first
+    batch_flush();
+    if (nemu_state.state == NEMU_ABORT) return;
     // to skip the checking of an instruction, just copy the reg state to reference design
     ref_difftest_regcpy(&cpu, DIFFTEST_TO_REF);
     is_skip_ref = false;
+    batch_reset(&cpu);
+    return;
+  }
+
+#if CONFIG_DIFFTEST_BATCH > 1
+  if (isolate) {
+    // the instructions before this one are checked first, then this one alone
+    batch_flush();
+    if (nemu_state.state == NEMU_ABORT) return;
+    ref_difftest_exec(1);
+    ref_difftest_regcpy(&ref_r, DIFFTEST_TO_DUT);
+    checkregs(&ref_r, pc);
+    batch_reset(&cpu);
+    checkpoint(1);
     return;
   }
+  trace[nr_trace].pc = pc;
+  memcpy(trace[nr_trace].regs, &cpu, DIFFTEST_REG_SIZE);
+  nr_trace ++;
+  if (nr_trace == BATCH || nemu_state.state != NEMU_RUNNING) batch_flush();
+  return;
+#endif
 
   ref_difftest_exec(1);
   ref_difftest_regcpy(&ref_r, DIFFTEST_TO_DUT);
 
   checkregs(&ref_r, pc);
+  checkpoint(1);
 }
 #else
 void init_difftest(char *ref_so_file, long img_size, int port) { }
@@ -17,21 +17,40 @@
 #include <cpu/cpu.h>
 #include <difftest-def.h>
 #include <memory/paddr.h>
+#include <memory/memhash.h>
 
 __EXPORT void difftest_memcpy(paddr_t addr, void *buf, size_t n, bool direction) {
-  assert(0);
+  if (direction == DIFFTEST_TO_REF) {
+    memcpy(guest_to_host(addr), buf, n);
+    memhash_invalidate();
+  }
+  else memcpy(buf, guest_to_host(addr), n);
+}
+
+#ifdef CONFIG_MEMHASH
+// return the hash of the `page'-th page of pmem, or of the whole pmem if `page' is -1
+__EXPORT uint64_t difftest_memhash(int page) {
+  return memhash(page);
+}
+#endif
+
+// let REF access the memory of DUT directly, `buf' is the host address of
+// the beginning of pmem in DUT, so no copying is needed any more
+__EXPORT void difftest_memshare(void *buf) {
+  pmem_share(buf);
 }
 
 __EXPORT void difftest_regcpy(void *dut, bool direction) {
-  assert(0);
+  if (direction == DIFFTEST_TO_REF) memcpy(&cpu, dut, DIFFTEST_REG_SIZE);
+  else memcpy(dut, &cpu, DIFFTEST_REG_SIZE);
 }
 
 __EXPORT void difftest_exec(uint64_t n) {
-  assert(0);
+  cpu_exec(n);
 }
 
 __EXPORT void difftest_raise_intr(word_t NO) {
-  assert(0);
+  cpu.pc = isa_raise_intr(NO, cpu.pc);
 }
 
 __EXPORT void difftest_init(int port) {
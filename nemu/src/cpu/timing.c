@@ -0,0 +1,164 @@
+/***************************************************************************************
+* Copyright (c) 2014-2022 Zihao Yu, Nanjing University
+*
+* NEMU is licensed under Mulan PSL v2.
+* You can use this software according to the terms and conditions of the Mulan PSL v2.
+* You may obtain a copy of Mulan PSL v2 at:
+*          http://license.coscl.org.cn/MulanPSL2
+*
+* THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+* EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+* MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+*
+* See the Mulan PSL v2 for more details.
+***************************************************************************************/
+
+#include <cpu/timing.h>
+#include <memory/paddr.h>
+
+#ifdef CONFIG_TIMING
+
+/* A cycle-approximate model of a single-issue in-order pipeline.
+ * Every instruction occupies the pipeline for the latency of its class.
+ * Extra cycles are charged for load-use interlocks, control flow
+ * redirects and L1 cache misses. Accesses outside pmem are uncached.
+ */
+
+static const int latency[NR_TM_CLASS] = {
+  [TM_ALU]    = CONFIG_TIMING_LAT_ALU,
+  [TM_MUL]    = CONFIG_TIMING_LAT_MUL,
+  [TM_DIV]    = CONFIG_TIMING_LAT_DIV,
+  [TM_LOAD]   = CONFIG_TIMING_LAT_LOAD,
+  [TM_STORE]  = CONFIG_TIMING_LAT_STORE,
+  [TM_BRANCH] = CONFIG_TIMING_LAT_ALU,
+  [TM_JUMP]   = CONFIG_TIMING_LAT_ALU,
+  [TM_SYSTEM] = CONFIG_TIMING_LAT_SYSTEM,
+};
+static const char *class_name[NR_TM_CLASS] = {
+  "alu", "mul", "div", "load", "store", "branch", "jump", "system"
+};
+
+#define LINE_BITS CONFIG_TIMING_CACHE_LINE_BITS
+#define NR_WAY CONFIG_TIMING_CACHE_WAYS
+
+typedef struct {
+  const char *name;
+  int set_bits;
+  uint32_t *tag;     // [set][way], 0 means invalid
+  uint64_t *stamp;   // last access time for LRU
+  uint64_t access, miss;
+} Cache;
+
+static Cache icache = { .name = "icache", .set_bits = CONFIG_TIMING_ICACHE_SET_BITS };
+static Cache dcache = { .name = "dcache", .set_bits = CONFIG_TIMING_DCACHE_SET_BITS };
+
+static uint64_t cycles = 0;
+static uint64_t pending = 0; // penalty of the instruction in execution
+static uint64_t nr_inst[NR_TM_CLASS] = {};
+static uint64_t stall_load_use = 0, stall_redirect = 0, stall_mem = 0;
+static int last_load_rd = 0;
+
+static void cache_init(Cache *c) {
+  int n = (1 << c->set_bits) * NR_WAY;
+  c->tag = calloc(n, sizeof(*c->tag));
+  c->stamp = calloc(n, sizeof(*c->stamp));
+  assert(c->tag && c->stamp);
+}
+
+// return whether the access hits
+static bool cache_access(Cache *c, paddr_t addr) {
+  if (unlikely(c->tag == NULL)) cache_init(c);
+  uint32_t line = addr >> LINE_BITS;
+  uint32_t set = line & BITMASK(c->set_bits);
+  uint32_t tag = (line >> c->set_bits) + 1; // avoid 0 for valid lines
+  uint32_t *t = c->tag + set * NR_WAY;
+  uint64_t *s = c->stamp + set * NR_WAY;
+  c->access ++;
+  int victim = 0;
+  for (int w = 0; w < NR_WAY; w ++) {
+    if (t[w] == tag) { s[w] = c->access; return true; }
+    if (s[w] < s[victim]) victim = w;
+  }
+  c->miss ++;
+  t[victim] = tag;
+  s[victim] = c->access;
+  return false;
+}
+
+static inline uint64_t mem_penalty(Cache *c, paddr_t addr) {
+  if (!in_pmem(addr)) return CONFIG_TIMING_MISS_PENALTY;
+  return (cache_access(c, addr) ? 0 : CONFIG_TIMING_MISS_PENALTY);
+}
+
+void timing_mem(paddr_t addr, bool is_write) {
+  uint64_t p = mem_penalty(&dcache, addr);
+  stall_mem += p;
+  pending += p;
+}
+
+void timing_redirect(bool redirect) {
+  if (redirect) {
+    stall_redirect += CONFIG_TIMING_REDIRECT_PENALTY;
+    pending += CONFIG_TIMING_REDIRECT_PENALTY;
+  }
+}
+
+void timing_inst(vaddr_t pc, int cls, int rd, int rs1, int rs2) {
+  uint64_t p = mem_penalty(&icache, pc);
+  stall_mem += p;
+  pending += p;
+
+  if (last_load_rd != 0 && (rs1 == last_load_rd || rs2 == last_load_rd)) {
+    stall_load_use += CONFIG_TIMING_LOAD_USE;
+    pending += CONFIG_TIMING_LOAD_USE;
+  }
+  last_load_rd = (cls == TM_LOAD ? rd : 0);
+
+  cycles += latency[cls] + pending;
+  pending = 0;
+  nr_inst[cls] ++;
+}
+
+uint64_t timing_cycles() {
+  return cycles;
+}
+
+static void cache_reset(Cache *c) {
+  int n = (1 << c->set_bits) * NR_WAY;
+  if (c->tag != NULL) {
+    memset(c->tag, 0, n * sizeof(*c->tag));
+    memset(c->stamp, 0, n * sizeof(*c->stamp));
+  }
+  c->access = c->miss = 0;
+}
+
+void timing_reset() {
+  cycles = pending = 0;
+  memset(nr_inst, 0, sizeof(nr_inst));
+  stall_load_use = stall_redirect = stall_mem = 0;
+  last_load_rd = 0;
+  cache_reset(&icache);
+  cache_reset(&dcache);
+}
+
+static void cache_report(Cache *c) {
+  Log("%s: %d KiB, %d-way, %'" PRIu64 " accesses, %'" PRIu64 " misses (%.2f%%)", c->name,
+      (NR_WAY << (c->set_bits + LINE_BITS)) / 1024, NR_WAY, c->access, c->miss,
+      (c->access == 0 ? 0.0 : 100.0 * c->miss / c->access));
+}
+
+void timing_report() {
+  uint64_t n = 0;
+  for (int i = 0; i < NR_TM_CLASS; i ++) n += nr_inst[i];
+  Log("estimated cycles = %'" PRIu64 ", IPC = %.3f", cycles, (cycles == 0 ? 0.0 : (double)n / cycles));
+  for (int i = 0; i < NR_TM_CLASS; i ++) {
+    if (nr_inst[i] == 0) continue;
+    Log("%-6s: %'" PRIu64 " instructions (%.2f%%)", class_name[i], nr_inst[i], 100.0 * nr_inst[i] / n);
+  }
+  Log("stall cycles: load-use = %'" PRIu64 ", redirect = %'" PRIu64 ", memory = %'" PRIu64,
+      stall_load_use, stall_redirect, stall_mem);
+  cache_report(&icache);
+  cache_report(&dcache);
+}
+
+#endif
@@ -15,8 +15,18 @@
 
 #include <common.h>
 #include <device/map.h>
+#include <device/event.h>
+#include <machine.h>
 #include <SDL2/SDL.h>
 
+/* The guest writes the samples into the stream buffer as a ring, and
+ * adds the number of bytes written to the count register. The buffer is
+ * drained by an event on guest time, one period of `samples' frames every
+ * samples / freq seconds, so the count read by the guest goes down as its
+ * own time passes. The periods drained by the default machine are queued
+ * to the audio device of the host.
+ */
+
 enum {
   reg_freq,
   reg_channels,
@@ -27,10 +37,73 @@ enum {
   nr_reg
 };
 
-static uint8_t *sbuf = NULL;
-static uint32_t *audio_base = NULL;
+#define sbuf (machine->dev.sbuf)
+#define sbuf_head (machine->dev.sbuf_head)
+#define audio_base (machine->dev.audio_base)
+
+static SDL_AudioDeviceID audio_dev = 0;
+
+static void open_audio() {
+  if (audio_dev != 0) SDL_CloseAudioDevice(audio_dev);
+  else SDL_InitSubSystem(SDL_INIT_AUDIO);
+  SDL_AudioSpec s = {
+    .freq = audio_base[reg_freq],
+    .format = AUDIO_S16SYS,
+    .channels = audio_base[reg_channels],
+    .samples = audio_base[reg_samples],
+  };
+  audio_dev = SDL_OpenAudioDevice(NULL, 0, &s, NULL, 0);
+  if (audio_dev == 0) {
+    Log("Can not open the audio device: %s", SDL_GetError());
+    return;
+  }
+  SDL_PauseAudioDevice(audio_dev, 0);
+}
+
+// instructions of hart 0 to play one period
+static uint64_t period_inst() {
+  return (uint64_t)audio_base[reg_samples] * CONFIG_AUDIO_INST_PER_SEC / audio_base[reg_freq];
+}
+
+static void queue_audio(const uint8_t *buf, uint32_t len) {
+  // the host falls behind the guest, drop the samples instead of piling them up
+  if (SDL_GetQueuedAudioSize(audio_dev) > CONFIG_SB_SIZE) return;
+  SDL_QueueAudio(audio_dev, buf, len);
+}
+
+static void audio_play() {
+  uint32_t count = audio_base[reg_count];
+  uint32_t len = audio_base[reg_samples] * audio_base[reg_channels] * sizeof(int16_t);
+  if (len > count) len = count;
+  // the bytes beyond the end of the ring are at the beginning
+  uint32_t first = (len < CONFIG_SB_SIZE - sbuf_head ? len : CONFIG_SB_SIZE - sbuf_head);
+  if (machine_is_default() && audio_dev != 0) {
+    queue_audio(sbuf + sbuf_head, first);
+    if (len > first) queue_audio(sbuf, len - first);
+  }
+  sbuf_head = (sbuf_head + len) % CONFIG_SB_SIZE;
+  audio_base[reg_count] = count - len;
+  event_schedule(audio_play, event_now() + period_inst());
+}
 
 static void audio_io_handler(uint32_t offset, int len, bool is_write) {
+  if (!is_write) return;
+  switch (offset / sizeof(uint32_t)) {
+    case reg_count:
+      if (audio_base[reg_count] > CONFIG_SB_SIZE) audio_base[reg_count] = CONFIG_SB_SIZE;
+      break;
+    case reg_init:
+      // a new stream starts at the beginning of the buffer, an invalid format stops the playback
+      sbuf_head = 0;
+      audio_base[reg_count] = 0;
+      if (audio_base[reg_freq] == 0 || audio_base[reg_channels] == 0 || audio_base[reg_samples] == 0) {
+        event_schedule(audio_play, UINT64_MAX);
+        break;
+      }
+      if (machine_is_default()) open_audio();
+      event_schedule(audio_play, event_now() + period_inst());
+      break;
+  }
 }
 
 void init_audio() {
@@ -41,7 +114,9 @@ void init_audio() {
 #else
   add_mmio_map("audio", CONFIG_AUDIO_CTL_MMIO, audio_base, space_size, audio_io_handler);
 #endif
+  audio_base[reg_sbuf_size] = CONFIG_SB_SIZE;
 
   sbuf = (uint8_t *)new_space(CONFIG_SB_SIZE);
   add_mmio_map("audio-sbuf", CONFIG_SB_ADDR, sbuf, CONFIG_SB_SIZE, NULL);
+  sbuf_head = 0;
 }
@@ -0,0 +1,113 @@
+/***************************************************************************************
+* Copyright (c) 2014-2022 Zihao Yu, Nanjing University
+*
+* NEMU is licensed under Mulan PSL v2.
+* You can use this software according to the terms and conditions of the Mulan PSL v2.
+* You may obtain a copy of Mulan PSL v2 at:
+*          http://license.coscl.org.cn/MulanPSL2
+*
+* THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+* EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+* MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+*
+* See the Mulan PSL v2 for more details.
+***************************************************************************************/
+
+#include <device/map.h>
+#include <device/event.h>
+#include <memory/host.h>
+#include <machine.h>
+
+/* The core-local interruptor of RISC-V, with the layout of the one in
+ * SiFive cores. Writing msip[i] raises or clears the machine software
+ * interrupt of hart i, which is how harts send IPIs to each other.
+ * The machine timer interrupt of hart i is pending while mtime >= mtimecmp[i].
+ * mtime counts guest time instead of host time: it advances by one every
+ * CONFIG_CLINT_INST_PER_TICK instructions retired by hart 0, so the timer
+ * interrupts arrive at the same instructions in every run.
+ */
+
+#define CLINT_MSIP     0x0
+#define CLINT_MTIMECMP 0x4000
+#define CLINT_MTIME    0xbff8
+#define CLINT_SIZE     0x10000
+
+#define clint (machine->dev.clint)
+#define INST_PER_TICK CONFIG_CLINT_INST_PER_TICK
+
+void isa_set_msip(int id, bool pending);
+void isa_set_mtip(int id, bool pending);
+
+static inline uint64_t* mtimecmp(int id) {
+  return (uint64_t *)((uint8_t *)clint.base + CLINT_MTIMECMP) + id;
+}
+
+static inline uint64_t mtime() {
+  return event_now() / INST_PER_TICK + clint.skew;
+}
+
+// update MTIP of every hart and schedule it again when the next one should be raised
+static void clint_update() {
+  uint64_t now = mtime();
+  uint64_t next = UINT64_MAX;
+  for (int i = 0; i < NR_HART; i ++) {
+    uint64_t cmp = *mtimecmp(i);
+    isa_set_mtip(i, now >= cmp);
+    if (now < cmp && cmp - now < next) next = cmp - now;
+  }
+  // mtime reaches now + next when hart 0 retires (tick + next) * INST_PER_TICK instructions
+  uint64_t tick = event_now() / INST_PER_TICK;
+  event_schedule(clint_update, (next > UINT64_MAX / INST_PER_TICK - tick ?
+      UINT64_MAX : (tick + next) * INST_PER_TICK));
+}
+
+// nothing will happen on hart 0 until the next mtimecmp, let mtime jump there
+void clint_skip_idle() {
+  uint64_t deadline = event_when(clint_update);
+  if (deadline == UINT64_MAX) return;
+  clint.skew += deadline / INST_PER_TICK - event_now() / INST_PER_TICK;
+  clint_update();
+}
+
+static void mtime_io_handler(uint32_t offset, int len, bool is_write) {
+  uint8_t *reg = (uint8_t *)clint.base + CLINT_MTIME;
+  uint64_t now = mtime();
+  if (!is_write) {
+    memcpy(reg, &now, 8);
+    return;
+  }
+  // only the written half of mtime is changed
+  uint64_t val = now;
+  memcpy((uint8_t *)&val + (offset - CLINT_MTIME), reg + (offset - CLINT_MTIME), len);
+  clint.skew += val - now;
+  clint_update();
+}
+
+static void clint_io_handler(uint32_t offset, int len, bool is_write) {
+  assert((len == 4 || len == 8) && offset % len == 0);
+  if (offset >= CLINT_MTIME && offset < CLINT_MTIME + 8) {
+    mtime_io_handler(offset, len, is_write);
+    return;
+  }
+
+  int id = (offset < CLINT_MTIMECMP ? (offset - CLINT_MSIP) / 4 : (offset - CLINT_MTIMECMP) / 8);
+  if (id >= NR_HART) {
+    // registers of harts which do not exist are hardwired to 0
+    host_write((uint8_t *)clint.base + offset, len, 0);
+    return;
+  }
+  if (!is_write) return;
+  if (offset < CLINT_MTIMECMP) {
+    clint.base[id] &= 1;
+    isa_set_msip(id, clint.base[id]);
+  } else {
+    clint_update();
+  }
+}
+
+void init_clint() {
+  clint.base = (uint32_t *)new_space(CLINT_SIZE);
+  add_mmio_map("clint", CONFIG_CLINT_MMIO, clint.base, CLINT_SIZE, clint_io_handler);
+  for (int i = 0; i < NR_HART; i ++) *mtimecmp(i) = UINT64_MAX;
+  clint_update();
+}
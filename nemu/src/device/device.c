@@ -14,8 +14,9 @@
 ***************************************************************************************/
 
 #include <common.h>
-#include <utils.h>
-#include <device/alarm.h>
+#include <machine.h>
+#include <device/mmio.h>
+#include <device/event.h>
 #ifndef CONFIG_TARGET_AM
 #include <SDL2/SDL.h>
 #endif
@@ -28,24 +29,23 @@ void init_i8042();
 void init_audio();
 void init_disk();
 void init_sdcard();
-void init_alarm();
+void init_clint();
+void init_plic();
+void init_event();
+void free_vga();
 
 void send_key(uint8_t, bool);
-void vga_update_screen();
 
-void device_update() {
-  static uint64_t last = 0;
-  uint64_t now = get_time();
-  if (now - last < 1000000 / TIMER_HZ) {
-    return;
-  }
-  last = now;
-
-  IFDEF(CONFIG_HAS_VGA, vga_update_screen());
+// the window is polled every CONFIG_DEVICE_POLL_INST instructions of guest time
+static void input_poll() {
+  event_schedule(input_poll, event_now() + CONFIG_DEVICE_POLL_INST);
 
 #ifndef CONFIG_TARGET_AM
+  // the events of the window go to the default machine,
+  // they are pumped by the render thread of the VGA, which owns the window
+  if (!machine_is_default()) return;
   SDL_Event event;
-  while (SDL_PollEvent(&event)) {
+  while (SDL_PeepEvents(&event, 1, SDL_GETEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT) > 0) {
     switch (event.type) {
       case SDL_QUIT:
         nemu_state.state = NEMU_QUIT;
@@ -69,13 +69,14 @@ void device_update() {
 void sdl_clear_event_queue() {
 #ifndef CONFIG_TARGET_AM
   SDL_Event event;
-  while (SDL_PollEvent(&event));
+  while (SDL_PeepEvents(&event, 1, SDL_GETEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT) > 0);
 #endif
 }
 
-void init_device() {
-  IFDEF(CONFIG_TARGET_AM, ioe_init());
+// devices of the current machine
+void init_machine_device() {
   init_map();
+  init_event();
 
   IFDEF(CONFIG_HAS_SERIAL, init_serial());
   IFDEF(CONFIG_HAS_TIMER, init_timer());
@@ -84,6 +85,21 @@ void init_device() {
   IFDEF(CONFIG_HAS_AUDIO, init_audio());
   IFDEF(CONFIG_HAS_DISK, init_disk());
   IFDEF(CONFIG_HAS_SDCARD, init_sdcard());
+  IFDEF(CONFIG_HAS_CLINT, init_clint());
+  IFDEF(CONFIG_HAS_PLIC, init_plic());
+  event_schedule(input_poll, CONFIG_DEVICE_POLL_INST);
+}
 
-  IFNDEF(CONFIG_TARGET_AM, init_alarm());
+// the default machine is never freed, so its devices are shut down at exit
+static void exit_device() {
+  IFDEF(CONFIG_HAS_VGA, free_vga());
+#ifndef CONFIG_TARGET_AM
+  SDL_Quit();
+#endif
+}
+
+void init_device() {
+  IFDEF(CONFIG_TARGET_AM, ioe_init());
+  init_machine_device();
+  atexit(exit_device);
 }
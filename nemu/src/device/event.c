@@ -0,0 +1,114 @@
+/***************************************************************************************
+* Copyright (c) 2014-2022 Zihao Yu, Nanjing University
+*
+* NEMU is licensed under Mulan PSL v2.
+* You can use this software according to the terms and conditions of the Mulan PSL v2.
+* You may obtain a copy of Mulan PSL v2 at:
+*          http://license.coscl.org.cn/MulanPSL2
+*
+* THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+* EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+* MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+*
+* See the Mulan PSL v2 for more details.
+***************************************************************************************/
+
+#include <device/event.h>
+#include <device/mmio.h>
+#include <machine.h>
+
+/* The pending events are kept in a binary min-heap by their times, and
+ * the time of the top is cached in `next', which is also the deadline of
+ * hart 0 in execute(). Therefore adding or removing an event costs
+ * O(log NR_EVENT), and nothing is done between the events. The heap is a
+ * part of the machine, so it is copied together with the other devices.
+ */
+
+#define ev (machine->dev.event)
+
+uint64_t event_now() {
+  return machine->harts[0].nr_inst;
+}
+
+static void swap(int i, int j) {
+  typeof(ev.heap[0]) t = ev.heap[i];
+  ev.heap[i] = ev.heap[j];
+  ev.heap[j] = t;
+}
+
+static void sift_up(int i) {
+  for (; i > 0 && ev.heap[(i - 1) / 2].when > ev.heap[i].when; i = (i - 1) / 2) {
+    swap(i, (i - 1) / 2);
+  }
+}
+
+static void sift_down(int i) {
+  while (true) {
+    int l = 2 * i + 1, r = l + 1, min = i;
+    if (l < ev.nr && ev.heap[l].when < ev.heap[min].when) min = l;
+    if (r < ev.nr && ev.heap[r].when < ev.heap[min].when) min = r;
+    if (min == i) return;
+    swap(i, min);
+    i = min;
+  }
+}
+
+static int find(event_handler_t handler) {
+  for (int i = 0; i < ev.nr; i ++) {
+    if (ev.heap[i].handler == handler) return i;
+  }
+  return -1;
+}
+
+static void remove_at(int i) {
+  ev.heap[i] = ev.heap[-- ev.nr];
+  if (i < ev.nr) {
+    sift_up(i);
+    sift_down(i);
+  }
+}
+
+static void update_next() {
+  uint64_t next = (ev.nr > 0 ? ev.heap[0].when : UINT64_MAX);
+  // hart 0 only looks at `next' again when it reaches its deadline
+  if (next < ev.next) hart_kick(&machine->harts[0]);
+  ev.next = next;
+}
+
+void event_schedule(event_handler_t handler, uint64_t when) {
+  int i = find(handler);
+  if (i >= 0) remove_at(i);
+  if (when != UINT64_MAX) {
+    // an event can not happen in the past, the earliest is after the current instruction
+    uint64_t now = event_now();
+    if (when <= now) when = now + 1;
+    Assert(ev.nr < NR_EVENT, "too many pending events, enlarge NR_EVENT");
+    ev.heap[ev.nr].when = when;
+    ev.heap[ev.nr].handler = handler;
+    sift_up(ev.nr ++);
+  }
+  update_next();
+}
+
+uint64_t event_when(event_handler_t handler) {
+  int i = find(handler);
+  return (i >= 0 ? ev.heap[i].when : UINT64_MAX);
+}
+
+// called by hart 0 when `next' is reached
+void event_run() {
+  uint64_t now = event_now();
+  device_lock();
+  while (ev.next <= now) {
+    event_handler_t handler = ev.heap[0].handler;
+    remove_at(0);
+    update_next();
+    handler();
+  }
+  device_unlock();
+}
+
+void init_event() {
+  ev.nr = 0;
+  ev.next = UINT64_MAX;
+}
@@ -20,8 +20,8 @@
 
 #define IO_SPACE_MAX (2 * 1024 * 1024)
 
-static uint8_t *io_space = NULL;
-static uint8_t *p_space = NULL;
+#define io_space (machine->io_space)
+#define p_space (machine->p_space)
 
 uint8_t* new_space(int size) {
   uint8_t *p = p_space;
@@ -56,6 +56,7 @@ word_t map_read(paddr_t addr, int len, IOMap *map) {
   assert(len >= 1 && len <= 8);
   check_bound(map, addr);
   paddr_t offset = addr - map->low;
+  if (map->ext_callback) return map->ext_callback(map->opaque, offset, len, false, 0);
   invoke_callback(map->callback, offset, len, false); // prepare data to read
   word_t ret = host_read(map->space + offset, len);
   return ret;
@@ -65,6 +66,7 @@ void map_write(paddr_t addr, int len, word_t data, IOMap *map) {
   assert(len >= 1 && len <= 8);
   check_bound(map, addr);
   paddr_t offset = addr - map->low;
+  if (map->ext_callback) { map->ext_callback(map->opaque, offset, len, true, data); return; }
   host_write(map->space + offset, len, data);
   invoke_callback(map->callback, offset, len, true);
 }
@@ -14,12 +14,12 @@
 ***************************************************************************************/
 
 #include <device/map.h>
+#include <device/mmio.h>
 #include <memory/paddr.h>
+#include <machine.h>
 
-#define NR_MAP 16
-
-static IOMap maps[NR_MAP] = {};
-static int nr_map = 0;
+#define maps (machine->mmio_maps)
+#define nr_map (machine->nr_mmio_map)
 
 static IOMap* fetch_mmio_map(paddr_t addr) {
   int mapid = find_mapid_by_addr(maps, nr_map, addr);
@@ -32,10 +32,10 @@ static void report_mmio_overlap(const char *name1, paddr_t l1, paddr_t r1,
                "with %s@[" FMT_PADDR ", " FMT_PADDR "]", name1, l1, r1, name2, l2, r2);
 }
 
-/* device interface */
-void add_mmio_map(const char *name, paddr_t addr, void *space, uint32_t len, io_callback_t callback) {
+static void add_map(IOMap map) {
   assert(nr_map < NR_MAP);
-  paddr_t left = addr, right = addr + len - 1;
+  const char *name = map.name;
+  paddr_t left = map.low, right = map.high;
   if (in_pmem(left) || in_pmem(right)) {
     report_mmio_overlap(name, left, right, "pmem", PMEM_LEFT, PMEM_RIGHT);
   }
@@ -45,19 +45,46 @@ void add_mmio_map(const char *name, paddr_t addr, void *space, uint32_t len, io_
     }
   }
 
-  maps[nr_map] = (IOMap){ .name = name, .low = addr, .high = addr + len - 1,
-    .space = space, .callback = callback };
+  maps[nr_map] = map;
   Log("Add mmio map '%s' at [" FMT_PADDR ", " FMT_PADDR "]",
       maps[nr_map].name, maps[nr_map].low, maps[nr_map].high);
 
   nr_map ++;
 }
 
+/* device interface */
+void add_mmio_map(const char *name, paddr_t addr, void *space, uint32_t len, io_callback_t callback) {
+  add_map((IOMap){ .name = name, .low = addr, .high = addr + len - 1,
+    .space = space, .callback = callback });
+}
+
+void add_mmio_map_ext(const char *name, paddr_t addr, uint32_t len, io_ext_callback_t callback, void *opaque) {
+  add_map((IOMap){ .name = name, .low = addr, .high = addr + len - 1,
+    .ext_callback = callback, .opaque = opaque });
+}
+
+#ifdef SMP_PARALLEL
+static bool dev_lock = false;
+
+void device_lock() {
+  while (__atomic_test_and_set(&dev_lock, __ATOMIC_ACQUIRE));
+}
+
+void device_unlock() {
+  __atomic_clear(&dev_lock, __ATOMIC_RELEASE);
+}
+#endif
+
 /* bus interface */
 word_t mmio_read(paddr_t addr, int len) {
-  return map_read(addr, len, fetch_mmio_map(addr));
+  device_lock();
+  word_t ret = map_read(addr, len, fetch_mmio_map(addr));
+  device_unlock();
+  return ret;
 }
 
 void mmio_write(paddr_t addr, int len, word_t data) {
+  device_lock();
   map_write(addr, len, data, fetch_mmio_map(addr));
+  device_unlock();
 }
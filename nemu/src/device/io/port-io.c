@@ -14,12 +14,12 @@
 ***************************************************************************************/
 
 #include <device/map.h>
+#include <machine.h>
 
 #define PORT_IO_SPACE_MAX 65535
 
-#define NR_MAP 16
-static IOMap maps[NR_MAP] = {};
-static int nr_map = 0;
+#define maps (machine->pio_maps)
+#define nr_map (machine->nr_pio_map)
 
 /* device interface */
 void add_pio_map(const char *name, ioaddr_t addr, void *space, uint32_t len, io_callback_t callback) {
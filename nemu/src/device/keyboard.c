@@ -14,7 +14,8 @@
 ***************************************************************************************/
 
 #include <device/map.h>
-#include <utils.h>
+#include <device/plic.h>
+#include <machine.h>
 
 #define KEYDOWN_MASK 0x8000
 
@@ -45,14 +46,15 @@ static void init_keymap() {
   MAP(NEMU_KEYS, SDL_KEYMAP)
 }
 
-#define KEY_QUEUE_LEN 1024
-static int key_queue[KEY_QUEUE_LEN] = {};
-static int key_f = 0, key_r = 0;
+#define key_queue (machine->dev.key_queue)
+#define key_f (machine->dev.key_f)
+#define key_r (machine->dev.key_r)
 
 static void key_enqueue(uint32_t am_scancode) {
   key_queue[key_r] = am_scancode;
   key_r = (key_r + 1) % KEY_QUEUE_LEN;
   Assert(key_r != key_f, "key queue overflow!");
+  plic_raise_irq(IRQ_KEYBOARD);
 }
 
 static uint32_t key_dequeue() {
@@ -80,7 +82,7 @@ static uint32_t key_dequeue() {
 }
 #endif
 
-static uint32_t *i8042_data_port_base = NULL;
+#define i8042_data_port_base (machine->dev.i8042_data_port_base)
 
 static void i8042_data_io_handler(uint32_t offset, int len, bool is_write) {
   assert(!is_write);
@@ -0,0 +1,114 @@
+/***************************************************************************************
+* Copyright (c) 2014-2022 Zihao Yu, Nanjing University
+*
+* NEMU is licensed under Mulan PSL v2.
+* You can use this software according to the terms and conditions of the Mulan PSL v2.
+* You may obtain a copy of Mulan PSL v2 at:
+*          http://license.coscl.org.cn/MulanPSL2
+*
+* THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+* EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+* MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+*
+* See the Mulan PSL v2 for more details.
+***************************************************************************************/
+
+#include <device/map.h>
+#include <device/plic.h>
+#include <machine.h>
+
+/* The platform-level interrupt controller of RISC-V, with the layout of
+ * the one in SiFive cores, reduced to 32 sources and one context for the
+ * machine mode of every hart. Sources are edge-triggered: an event of a
+ * device makes its source pending, and a claim takes the pending source
+ * with the highest priority above the threshold of the context. A claimed
+ * source is not delivered again until it is completed.
+ */
+
+#define PLIC_PRIORITY 0x0
+#define PLIC_PENDING  0x1000
+#define PLIC_ENABLE   0x2000   // 0x80 bytes per context
+#define PLIC_CONTEXT  0x200000 // 0x1000 bytes per context: threshold, claim/complete
+#define PLIC_SIZE     0x4000000
+#define NR_SOURCE     32
+
+#define plic (machine->dev.plic)
+
+void isa_set_meip(int id, bool pending);
+
+// 0 if no source should interrupt context `ctx'
+static int plic_best(int ctx) {
+  uint32_t ready = plic.pending & ~plic.claimed & plic.enable[ctx];
+  int best = 0;
+  for (int i = 1; i < NR_SOURCE; i ++) {
+    if ((ready & (1u << i)) && plic.priority[i] > plic.threshold[ctx] &&
+        (best == 0 || plic.priority[i] > plic.priority[best])) best = i;
+  }
+  return best;
+}
+
+static void plic_update() {
+  for (int i = 0; i < NR_HART; i ++) isa_set_meip(i, plic_best(i) != 0);
+}
+
+void plic_raise_irq(int irq) {
+  assert(irq > 0 && irq < NR_SOURCE);
+  plic.pending |= 1u << irq;
+  plic_update();
+}
+
+static uint32_t plic_read(uint64_t offset) {
+  if (offset < PLIC_PENDING) return (offset / 4 < NR_SOURCE ? plic.priority[offset / 4] : 0);
+  if (offset == PLIC_PENDING) return plic.pending;
+  if (offset >= PLIC_ENABLE && offset < PLIC_CONTEXT) {
+    int ctx = (offset - PLIC_ENABLE) / 0x80;
+    return (ctx < NR_HART && offset % 0x80 == 0 ? plic.enable[ctx] : 0);
+  }
+  int ctx = (offset - PLIC_CONTEXT) / 0x1000;
+  if (offset < PLIC_CONTEXT || ctx >= NR_HART) return 0;
+  switch (offset % 0x1000) {
+    case 0: return plic.threshold[ctx];
+    case 4: {
+      int id = plic_best(ctx);
+      if (id != 0) {
+        plic.pending &= ~(1u << id);
+        plic.claimed |= 1u << id;
+        plic_update();
+      }
+      return id;
+    }
+    default: return 0;
+  }
+}
+
+static void plic_write(uint64_t offset, uint32_t data) {
+  if (offset < PLIC_PENDING) {
+    // priorities are 0 to 7, source 0 does not exist
+    if (offset / 4 < NR_SOURCE && offset != 0) plic.priority[offset / 4] = data & 0x7;
+  } else if (offset >= PLIC_ENABLE && offset < PLIC_CONTEXT) {
+    int ctx = (offset - PLIC_ENABLE) / 0x80;
+    if (ctx < NR_HART && offset % 0x80 == 0) plic.enable[ctx] = data & ~1u;
+  } else if (offset >= PLIC_CONTEXT) {
+    int ctx = (offset - PLIC_CONTEXT) / 0x1000;
+    if (ctx >= NR_HART) return;
+    switch (offset % 0x1000) {
+      case 0: plic.threshold[ctx] = data & 0x7; break;
+      case 4: if (data < NR_SOURCE) plic.claimed &= ~(1u << data); break;
+      default: return;
+    }
+  } else return; // pending bits are read-only
+  plic_update();
+}
+
+static uint64_t plic_io_handler(void *opaque, uint64_t offset, int len, bool is_write, uint64_t data) {
+  assert(len == 4 && offset % 4 == 0);
+  if (is_write) {
+    plic_write(offset, data);
+    return 0;
+  }
+  return plic_read(offset);
+}
+
+void init_plic() {
+  add_mmio_map_ext("plic", CONFIG_PLIC_MMIO, PLIC_SIZE, plic_io_handler, NULL);
+}
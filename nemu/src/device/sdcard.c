@@ -14,6 +14,7 @@
 ***************************************************************************************/
 
 #include <device/map.h>
+#include <machine.h>
 #include "mmc.h"
 
 // http://www.files.e-shop.co.il/pdastore/Tech-mmc-samsung/SEC%20MMC%20SPEC%20ver09.pdf
@@ -40,13 +41,13 @@ enum {
   SDHBLC
 };
 
-static FILE *fp = NULL;
-static uint32_t *base = NULL;
-static uint32_t blkcnt = 0;
-static long blk_addr = 0;
-static uint32_t addr = 0;
-static bool write_cmd = 0;
-static bool read_ext_csd = false;
+#define fp (machine->dev.sdcard.fp)
+#define base (machine->dev.sdcard.base)
+#define blkcnt (machine->dev.sdcard.blkcnt)
+#define blk_addr (machine->dev.sdcard.blk_addr)
+#define addr (machine->dev.sdcard.addr)
+#define write_cmd (machine->dev.sdcard.write_cmd)
+#define read_ext_csd (machine->dev.sdcard.read_ext_csd)
 
 static void prepare_rw(int is_write) {
   blk_addr = base[SDARG];
@@ -15,13 +15,14 @@
 
 #include <utils.h>
 #include <device/map.h>
+#include <machine.h>
 
 /* http://en.wikibooks.org/wiki/Serial_Programming/8250_UART_Programming */
 // NOTE: this is compatible to 16550
 
 #define CH_OFFSET 0
 
-static uint8_t *serial_base = NULL;
+#define serial_base (machine->dev.serial_base)
 
 
 static void serial_putc(char ch) {
@@ -15,6 +15,8 @@
 
 #include <common.h>
 #include <device/map.h>
+#include <device/event.h>
+#include <machine.h>
 
 #define SCREEN_W (MUXDEF(CONFIG_VGA_SIZE_800x600, 800, 400))
 #define SCREEN_H (MUXDEF(CONFIG_VGA_SIZE_800x600, 600, 300))
@@ -31,18 +33,73 @@ static uint32_t screen_size() {
   return screen_width() * screen_height() * sizeof(uint32_t);
 }
 
-static void *vmem = NULL;
-static uint32_t *vgactl_port_base = NULL;
+#define vmem (machine->dev.vmem)
+#define vgactl_port_base (machine->dev.vgactl_port_base)
+#define dirty (machine->dev.vga_dirty)
+
+// called with the device lock held, like every MMIO callback, so harts running in parallel do not race
+static inline void mark_dirty(uint32_t offset) {
+  uint32_t pixel = offset / sizeof(uint32_t);
+  uint32_t y = pixel / screen_width(), x = pixel % screen_width();
+  dirty.rows[y / 64] |= 1ull << (y % 64);
+  if (x < dirty.x_lo) dirty.x_lo = x;
+  if (x >= dirty.x_hi) dirty.x_hi = x + 1;
+}
+
+static void vmem_io_handler(uint32_t offset, int len, bool is_write) {
+  if (!is_write) return;
+  mark_dirty(offset); mark_dirty(offset + len - 1); // an unaligned write may cross scanlines
+}
+
+static void mark_all_dirty() {
+  for (uint32_t y = 0; y < screen_height(); y ++) dirty.rows[y / 64] |= 1ull << (y % 64);
+  dirty.x_lo = 0;
+  dirty.x_hi = screen_width();
+}
 
 #ifdef CONFIG_VGA_SHOW_SCREEN
+static inline bool row_dirty(const uint64_t *rows, int y) {
+  return (rows[y / 64] >> (y % 64)) & 1;
+}
+
+// skip to the next run of dirty scanlines from `*y', and return the length of the run
+static int next_run(const uint64_t *rows, int *y) {
+  int h = screen_height();
+  while (*y < h && !row_dirty(rows, *y)) (*y) ++;
+  int end = *y;
+  while (end < h && row_dirty(rows, end)) end ++;
+  return end - *y;
+}
+
 #ifndef CONFIG_TARGET_AM
 #include <SDL2/SDL.h>
+#include <pthread.h>
 
+// The window is owned by the render thread, which uploads and presents the frames.
+// On sync the CPU thread only copies the dirty scanlines into `frame'
+// and continues, so it never waits for the presentation. The render thread
+// takes them into `upload' and calls SDL without holding `frame_lock'.
+static struct {
+  uint32_t *buf;
+  uint64_t rows[(SCREEN_H + 63) / 64]; // scanlines not uploaded yet
+  uint32_t x_lo, x_hi;
+  bool ready; // the window is created, so SDL can be used by other threads
+  bool quit;
+} frame;
+static struct {
+  uint32_t *buf;
+  uint64_t rows[(SCREEN_H + 63) / 64];
+  uint32_t x_lo, x_hi;
+} upload; // only used by the render thread
+static pthread_mutex_t frame_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t frame_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t render_tid;
+
+static SDL_Window *window = NULL;
 static SDL_Renderer *renderer = NULL;
 static SDL_Texture *texture = NULL;
 
-static void init_screen() {
-  SDL_Window *window = NULL;
+static void init_window() {
   char title[128];
   sprintf(title, "%s-NEMU", str(__GUEST_ISA__));
   SDL_Init(SDL_INIT_VIDEO);
@@ -56,31 +113,158 @@ static void init_screen() {
   SDL_RenderPresent(renderer);
 }
 
-static inline void update_screen() {
-  SDL_UpdateTexture(texture, NULL, vmem, SCREEN_W * sizeof(uint32_t));
-  SDL_RenderClear(renderer);
-  SDL_RenderCopy(renderer, texture, NULL, NULL);
-  SDL_RenderPresent(renderer);
+// SDL video is shut down by the thread which initialized it
+static void free_window() {
+  SDL_DestroyTexture(texture);
+  SDL_DestroyRenderer(renderer);
+  SDL_DestroyWindow(window);
+  SDL_QuitSubSystem(SDL_INIT_VIDEO);
+}
+
+// take the pending frame into `upload' with `frame_lock' held, return whether there is one
+static bool take_frame() {
+  if (frame.x_lo >= frame.x_hi) return false;
+  int w = frame.x_hi - frame.x_lo;
+  for (int y = 0, h; (h = next_run(frame.rows, &y)) > 0; y += h) {
+    for (int i = y; i < y + h; i ++) {
+      memcpy(upload.buf + i * SCREEN_W + frame.x_lo, frame.buf + i * SCREEN_W + frame.x_lo,
+          w * sizeof(uint32_t));
+    }
+  }
+  memcpy(upload.rows, frame.rows, sizeof(frame.rows));
+  upload.x_lo = frame.x_lo;
+  upload.x_hi = frame.x_hi;
+  memset(frame.rows, 0, sizeof(frame.rows));
+  frame.x_lo = SCREEN_W;
+  frame.x_hi = 0;
+  return true;
+}
+
+static void upload_frame() {
+  for (int y = 0, h; (h = next_run(upload.rows, &y)) > 0; y += h) {
+    SDL_Rect rect = { .x = upload.x_lo, .y = y, .w = upload.x_hi - upload.x_lo, .h = h };
+    SDL_UpdateTexture(texture, &rect, upload.buf + y * SCREEN_W + upload.x_lo,
+        SCREEN_W * sizeof(uint32_t));
+  }
+}
+
+// events of the window are also pumped here at TIMER_HZ, and fetched by input_poll()
+static void* render_thread(void *arg) {
+  init_window();
+  pthread_mutex_lock(&frame_lock);
+  frame.ready = true;
+  pthread_cond_broadcast(&frame_cond);
+  for (bool quit = false; !quit; ) {
+    if (frame.x_lo >= frame.x_hi && !frame.quit) {
+      struct timespec ts;
+      clock_gettime(CLOCK_REALTIME, &ts);
+      ts.tv_nsec += 1000000000 / TIMER_HZ;
+      if (ts.tv_nsec >= 1000000000) { ts.tv_sec ++; ts.tv_nsec -= 1000000000; }
+      pthread_cond_timedwait(&frame_cond, &frame_lock, &ts);
+    }
+    quit = frame.quit;
+    bool present = take_frame();
+    pthread_mutex_unlock(&frame_lock);
+    SDL_PumpEvents();
+    // the texture covers the whole window, so it is not cleared before the copy
+    if (present) {
+      upload_frame();
+      SDL_RenderCopy(renderer, texture, NULL, NULL);
+      SDL_RenderPresent(renderer);
+    }
+    pthread_mutex_lock(&frame_lock);
+  }
+  pthread_mutex_unlock(&frame_lock);
+  free_window();
+  return NULL;
+}
+
+static void init_screen() {
+  if (frame.buf != NULL) return; // the window outlives a reset of the machine
+  frame.buf = malloc(SCREEN_W * SCREEN_H * sizeof(uint32_t));
+  upload.buf = malloc(SCREEN_W * SCREEN_H * sizeof(uint32_t));
+  assert(frame.buf && upload.buf);
+  frame.x_lo = SCREEN_W;
+  frame.x_hi = 0;
+  int ret = pthread_create(&render_tid, NULL, render_thread, NULL);
+  Assert(ret == 0, "fail to create the render thread");
+  // input_poll() fetches the events of the window, which is only valid after SDL is initialized
+  pthread_mutex_lock(&frame_lock);
+  while (!frame.ready) pthread_cond_wait(&frame_cond, &frame_lock);
+  pthread_mutex_unlock(&frame_lock);
+}
+
+// the pending frame is still presented before the render thread exits
+static void free_screen() {
+  if (frame.buf == NULL) return;
+  pthread_mutex_lock(&frame_lock);
+  frame.quit = true;
+  pthread_cond_signal(&frame_cond);
+  pthread_mutex_unlock(&frame_lock);
+  pthread_join(render_tid, NULL);
+  free(frame.buf);
+  free(upload.buf);
+  memset(&frame, 0, sizeof(frame));
+  memset(&upload, 0, sizeof(upload));
+}
+
+// copy the dirty scanlines into the frame for the render thread
+static void update_screen() {
+  int w = dirty.x_hi - dirty.x_lo;
+  pthread_mutex_lock(&frame_lock);
+  for (int y = 0, h; (h = next_run(dirty.rows, &y)) > 0; y += h) {
+    for (int i = y; i < y + h; i ++) {
+      memcpy(frame.buf + i * SCREEN_W + dirty.x_lo, (uint32_t *)vmem + i * SCREEN_W + dirty.x_lo,
+          w * sizeof(uint32_t));
+      frame.rows[i / 64] |= 1ull << (i % 64);
+    }
+  }
+  if (dirty.x_lo < frame.x_lo) frame.x_lo = dirty.x_lo;
+  if (dirty.x_hi > frame.x_hi) frame.x_hi = dirty.x_hi;
+  pthread_cond_signal(&frame_cond);
+  pthread_mutex_unlock(&frame_lock);
 }
 #else
 static void init_screen() {}
+static void free_screen() {}
 
-static inline void update_screen() {
-  io_write(AM_GPU_FBDRAW, 0, 0, vmem, screen_width(), screen_height(), true);
+// draw each run of dirty scanlines, then sync once
+static void update_screen() {
+  for (int y = 0, h; (h = next_run(dirty.rows, &y)) > 0; y += h) {
+    io_write(AM_GPU_FBDRAW, 0, y, (uint32_t *)vmem + y * screen_width(), screen_width(), h, false);
+  }
+  io_write(AM_GPU_FBDRAW, 0, 0, NULL, 0, 0, true);
 }
 #endif
 #endif
 
-void vga_update_screen() {
+static void clear_dirty() {
+  memset(dirty.rows, 0, sizeof(dirty.rows));
+  dirty.x_lo = screen_width();
+  dirty.x_hi = 0;
+}
+
+static void vga_update_screen() {
   // TODO: call `update_screen()` when the sync register is non-zero,
   // then zero out the sync register
    uint32_t sync = vgactl_port_base[1];
-  if (sync) {
-    update_screen();
+  // only the default machine owns the screen
+  if (sync && machine_is_default()) {
+    // a sync with nothing written is not presented
+    if (dirty.x_lo < dirty.x_hi) {
+      IFDEF(CONFIG_VGA_SHOW_SCREEN, update_screen());
+      clear_dirty();
+    }
     vgactl_port_base[1] = 0;
   }
 }
 
+// the sync register is checked every CONFIG_DEVICE_POLL_INST instructions of guest time
+static void vga_refresh() {
+  event_schedule(vga_refresh, event_now() + CONFIG_DEVICE_POLL_INST);
+  vga_update_screen();
+}
+
 void init_vga() {
   vgactl_port_base = (uint32_t *)new_space(8);
   vgactl_port_base[0] = (screen_width() << 16) | screen_height();
@@ -90,8 +274,15 @@ void init_vga() {
   add_mmio_map("vgactl", CONFIG_VGA_CTL_MMIO, vgactl_port_base, 8, NULL);
 #endif
 
+  Assert(screen_height() <= VGA_MAX_H, "screen height %d is larger than VGA_MAX_H", screen_height());
   vmem = new_space(screen_size());
-  add_mmio_map("vmem", CONFIG_FB_ADDR, vmem, screen_size(), NULL);
-  IFDEF(CONFIG_VGA_SHOW_SCREEN, init_screen());
+  add_mmio_map("vmem", CONFIG_FB_ADDR, vmem, screen_size(), vmem_io_handler);
+  IFDEF(CONFIG_VGA_SHOW_SCREEN, if (machine_is_default()) init_screen());
   IFDEF(CONFIG_VGA_SHOW_SCREEN, memset(vmem, 0, screen_size()));
+  mark_all_dirty();
+  event_schedule(vga_refresh, CONFIG_DEVICE_POLL_INST);
+}
+
+void free_vga() {
+  IFDEF(CONFIG_VGA_SHOW_SCREEN, free_screen());
 }
@@ -23,6 +23,7 @@ void set_nemu_state(int state, vaddr_t pc, int halt_ret) {
   nemu_state.state = state;
   nemu_state.halt_pc = pc;
   nemu_state.halt_ret = halt_ret;
+  machine_kick(machine); // stop all harts
 }
 
 __attribute__((noinline))
@@ -16,11 +16,15 @@
 #include <cpu/cpu.h>
 
 void sdb_mainloop();
+bool run_image_list();
 
 void engine_start() {
 #ifdef CONFIG_TARGET_AM
   cpu_exec(-1);
 #else
+  /* Run the images given by --list, if any. */
+  if (run_image_list()) return;
+
   /* Receive commands from user. */
   sdb_mainloop();
 #endif
@@ -19,7 +19,10 @@ DIRS-$(CONFIG_MODE_SYSTEM) += src/memory
 DIRS-BLACKLIST-$(CONFIG_TARGET_AM) += src/monitor/sdb
 
 SHARE = $(if $(CONFIG_TARGET_SHARE),1,0)
-LIBS += $(if $(CONFIG_TARGET_NATIVE_ELF),-lreadline -ldl -pie,)
+LIBS += $(if $(CONFIG_TARGET_NATIVE_ELF),-lreadline -ldl -lpthread -pie,)
+# the shared object is linked by libnemu users, so it carries its own dependencies
+LIBS += $(if $(CONFIG_LIBNEMU),-lreadline,)
+LIBS += $(if $(CONFIG_RVFD),-lm,)
 
 ifdef mainargs
 ASFLAGS += -DBIN_PATH=\"$(mainargs)\"
@@ -29,3 +29,10 @@ void isa_reg_display() {
 word_t isa_reg_str2val(const char *s, bool *success) {
   return 0;
 }
+
+int isa_reg_str2idx(const char *s) {
+  for (int i = 0; i < 32; i++) {
+    if (strcmp(s, regs[i]) == 0) return i;
+  }
+  return -1;
+}
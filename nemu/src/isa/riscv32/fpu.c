@@ -0,0 +1,246 @@
+/***************************************************************************************
+* Copyright (c) 2014-2022 Zihao Yu, Nanjing University
+*
+* NEMU is licensed under Mulan PSL v2.
+* You can use this software according to the terms and conditions of the Mulan PSL v2.
+* You may obtain a copy of Mulan PSL v2 at:
+*          http://license.coscl.org.cn/MulanPSL2
+*
+* THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+* EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+* MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+*
+* See the Mulan PSL v2 for more details.
+***************************************************************************************/
+
+#include <isa.h>
+#include "local-include/fpu.h"
+
+#ifdef CONFIG_RVFD
+#include <fenv.h>
+#include <math.h>
+
+/* Floating point instructions run on the host FPU. The host exception
+ * flags are cleared before an operation, so after it they hold exactly
+ * the exceptions it raised. Operands and results go through
+ * volatile variables to keep the operation between the changes of the
+ * host rounding mode and the check of the flags.
+ */
+
+#define F32_QNAN 0x7fc00000u
+#define F64_QNAN 0x7ff8000000000000ull
+
+enum { FFLAG_NX = 0x1, FFLAG_UF = 0x2, FFLAG_OF = 0x4, FFLAG_DZ = 0x8, FFLAG_NV = 0x10 };
+enum { RM_RNE, RM_RTZ, RM_RDN, RM_RUP, RM_RMM, RM_DYN = 7 };
+
+#define fflags_raise(f) (cpu.csr.fcsr |= (f), fpu_set_dirty())
+
+static inline uint32_t unbox32(uint64_t r) {
+  return ((r >> 32) == 0xffffffffu ? (uint32_t)r : F32_QNAN);
+}
+
+static inline float f32(uint64_t r) {
+  uint32_t v = unbox32(r);
+  float f;
+  memcpy(&f, &v, sizeof(f));
+  return f;
+}
+
+static inline double f64(uint64_t r) {
+  double d;
+  memcpy(&d, &r, sizeof(d));
+  return d;
+}
+
+// NaNs generated by the operations are always canonical
+static inline uint64_t box_f32(float f) {
+  uint32_t v;
+  memcpy(&v, &f, sizeof(v));
+  bool nan = ((v >> 23) & 0xff) == 0xff && (v & BITMASK(23)) != 0;
+  return fpu_box32(nan ? F32_QNAN : v);
+}
+
+static inline uint64_t box_f64(double d) {
+  uint64_t v;
+  memcpy(&v, &d, sizeof(v));
+  bool nan = ((v >> 52) & 0x7ff) == 0x7ff && (v & BITMASK(52)) != 0;
+  return (nan ? F64_QNAN : v);
+}
+
+// classify by the bits, since a host comparison of a signaling NaN raises invalid
+static inline bool is_nan(bool dp, uint64_t r) {
+  if (dp) return ((r >> 52) & 0x7ff) == 0x7ff && (r & BITMASK(52)) != 0;
+  uint32_t v = unbox32(r);
+  return ((v >> 23) & 0xff) == 0xff && (v & BITMASK(23)) != 0;
+}
+
+static inline bool is_snan(bool dp, uint64_t r) {
+  if (dp) return ((r >> 51) & 0xfff) == 0xffe && (r & BITMASK(51)) != 0;
+  uint32_t v = unbox32(r);
+  return ((v >> 22) & 0x1ff) == 0x1fe && (v & BITMASK(22)) != 0;
+}
+
+static inline int resolve_rm(int rm) {
+  return (rm == RM_DYN ? (cpu.csr.fcsr >> 5) & 0x7 : rm);
+}
+
+bool fpu_rm_valid(int rm) {
+  return resolve_rm(rm) <= RM_RMM;
+}
+
+// RMM is not provided by the host and is approximated by RNE
+static int host_rm(int rm) {
+  switch (resolve_rm(rm)) {
+    case RM_RTZ: return FE_TOWARDZERO;
+    case RM_RDN: return FE_DOWNWARD;
+    case RM_RUP: return FE_UPWARD;
+    default:     return FE_TONEAREST;
+  }
+}
+
+static inline int fp_begin(int rm) {
+  int mode = host_rm(rm);
+  feclearexcept(FE_ALL_EXCEPT);
+  if (mode != FE_TONEAREST) fesetround(mode);
+  return mode;
+}
+
+static inline void fp_end(int mode) {
+  if (mode != FE_TONEAREST) fesetround(FE_TONEAREST);
+  int ex = fetestexcept(FE_ALL_EXCEPT);
+  if (ex == 0) return;
+  word_t f = 0;
+  if (ex & FE_INEXACT)   f |= FFLAG_NX;
+  if (ex & FE_UNDERFLOW) f |= FFLAG_UF;
+  if (ex & FE_OVERFLOW)  f |= FFLAG_OF;
+  if (ex & FE_DIVBYZERO) f |= FFLAG_DZ;
+  if (ex & FE_INVALID)   f |= FFLAG_NV;
+  fflags_raise(f);
+}
+
+// the comparisons in min and max never see a NaN, so they raise nothing on the host
+#define MINMAX(T, box, a, b, ra, rb, is_max) do { \
+  if (is_snan(dp, ra) || is_snan(dp, rb)) fflags_raise(FFLAG_NV); \
+  if (is_nan(dp, ra) && is_nan(dp, rb)) return box(NAN); \
+  if (is_nan(dp, ra)) return box(b); \
+  if (is_nan(dp, rb)) return box(a); \
+  if (a == b) return box((signbit(a) != 0) != (is_max) ? a : b); \
+  return box((is_max) == (a > b) ? a : b); \
+} while (0)
+
+#define ARITH(T, fma_f, sqrt_f, box, a, b, c) do { \
+  volatile T va = a, vb = b, vc = c; \
+  T r; \
+  switch (op) { \
+    case FOP_ADD:   r = va + vb; break; \
+    case FOP_SUB:   r = va - vb; break; \
+    case FOP_MUL:   r = va * vb; break; \
+    case FOP_DIV:   r = va / vb; break; \
+    case FOP_SQRT:  r = sqrt_f(va); break; \
+    case FOP_MADD:  r = fma_f(va, vb, vc); break; \
+    case FOP_MSUB:  r = fma_f(va, vb, -vc); break; \
+    case FOP_NMSUB: r = fma_f(-va, vb, vc); break; \
+    case FOP_NMADD: r = fma_f(-va, vb, -vc); break; \
+    default: panic("unknown floating point operation %d", op); \
+  } \
+  volatile T vr = r; \
+  ret = box(vr); \
+} while (0)
+
+uint64_t fpu_arith(int op, bool dp, int rm, uint64_t a, uint64_t b, uint64_t c) {
+  if (op == FOP_MIN || op == FOP_MAX) {
+    if (dp) MINMAX(double, box_f64, f64(a), f64(b), a, b, op == FOP_MAX);
+    else MINMAX(float, box_f32, f32(a), f32(b), a, b, op == FOP_MAX);
+  }
+
+  uint64_t ret;
+  int mode = fp_begin(rm);
+  if (op == FOP_CVT_S_D) { volatile double v = f64(a); volatile float r = v; ret = box_f32(r); }
+  else if (op == FOP_CVT_D_S) { volatile float v = f32(a); volatile double r = v; ret = box_f64(r); }
+  else if (dp) ARITH(double, fma, sqrt, box_f64, f64(a), f64(b), f64(c));
+  else ARITH(float, fmaf, sqrtf, box_f32, f32(a), f32(b), f32(c));
+  fp_end(mode);
+  return ret;
+}
+
+uint64_t fpu_sgnj(int op, bool dp, uint64_t a, uint64_t b) {
+  int sign_bit = (dp ? 63 : 31);
+  uint64_t x = (dp ? a : unbox32(a)), y = (dp ? b : unbox32(b));
+  uint64_t mask = 1ull << sign_bit;
+  uint64_t sign;
+  switch (op) {
+    case FOP_SGNJ:  sign = y & mask; break;
+    case FOP_SGNJN: sign = ~y & mask; break;
+    case FOP_SGNJX: sign = (x ^ y) & mask; break;
+    default: panic("unknown floating point operation %d", op);
+  }
+  x = (x & ~mask) | sign;
+  return (dp ? x : fpu_box32(x));
+}
+
+// feq only signals on signaling NaNs, flt and fle on all NaNs
+word_t fpu_cmp(int op, bool dp, uint64_t a, uint64_t b) {
+  if (is_nan(dp, a) || is_nan(dp, b)) {
+    if (op != FOP_EQ || is_snan(dp, a) || is_snan(dp, b)) fflags_raise(FFLAG_NV);
+    return 0;
+  }
+  double x = (dp ? f64(a) : f32(a)), y = (dp ? f64(b) : f32(b));
+  switch (op) {
+    case FOP_EQ: return x == y;
+    case FOP_LT: return x < y;
+    case FOP_LE: return x <= y;
+    default: panic("unknown floating point operation %d", op);
+  }
+}
+
+word_t fpu_class(bool dp, uint64_t a) {
+  if (is_nan(dp, a)) return (is_snan(dp, a) ? 1 << 8 : 1 << 9);
+  // a subnormal single precision value is normal as a double
+  int cls = (dp ? fpclassify(f64(a)) : fpclassify(f32(a)));
+  bool neg = (dp ? a >> 63 : unbox32(a) >> 31);
+  switch (cls) {
+    case FP_INFINITE:  return (neg ? 1 << 0 : 1 << 7);
+    case FP_NORMAL:    return (neg ? 1 << 1 : 1 << 6);
+    case FP_SUBNORMAL: return (neg ? 1 << 2 : 1 << 5);
+    case FP_ZERO:      return (neg ? 1 << 3 : 1 << 4);
+    default: panic("unexpected class of floating point value");
+  }
+}
+
+// out of range values and NaNs saturate and signal invalid without inexact
+word_t fpu_to_int(bool dp, bool is_unsigned, int rm, uint64_t a) {
+  if (is_nan(dp, a)) {
+    fflags_raise(FFLAG_NV);
+    return (is_unsigned ? UINT32_MAX : INT32_MAX);
+  }
+  double x = (dp ? f64(a) : f32(a)); // exact for single precision
+  double max = (is_unsigned ? (double)UINT32_MAX : (double)INT32_MAX);
+  double min = (is_unsigned ? 0.0 : (double)INT32_MIN);
+
+  int mode = fp_begin(rm);
+  volatile double v = x;
+  double r = (resolve_rm(rm) == RM_RMM ? round(v) : nearbyint(v));
+  fp_end(mode);
+
+  if (r > max || r < min) {
+    fflags_raise(FFLAG_NV);
+    return (r < min ? (word_t)(is_unsigned ? 0 : INT32_MIN) : (word_t)(is_unsigned ? UINT32_MAX : INT32_MAX));
+  }
+  if (r != x) fflags_raise(FFLAG_NX);
+  return (is_unsigned ? (word_t)(uint32_t)r : (word_t)(int32_t)r);
+}
+
+uint64_t fpu_from_int(bool dp, bool is_unsigned, int rm, word_t x) {
+  uint64_t ret;
+  int mode = fp_begin(rm);
+  if (dp) {
+    volatile double r = (is_unsigned ? (double)(uint32_t)x : (double)(int32_t)x);
+    ret = box_f64(r);
+  } else {
+    volatile float r = (is_unsigned ? (float)(uint32_t)x : (float)(int32_t)x);
+    ret = box_f32(r);
+  }
+  fp_end(mode);
+  return ret;
+}
+#endif
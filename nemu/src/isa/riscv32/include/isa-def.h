@@ -18,29 +18,62 @@
 
 #include <common.h>
 
+// events which can be selected by mhpmevent3..31
+enum {
+  HPM_NONE, HPM_LOAD, HPM_STORE, HPM_BRANCH, HPM_BRANCH_TAKEN, HPM_JUMP,
+  HPM_EXCEPTION, HPM_INTERRUPT, NR_HPM_EVENT
+};
+
 typedef struct {
   word_t mcause;
   vaddr_t mepc;
   word_t mstatus;
   word_t mtvec;
+  word_t mie;
+  word_t mip;
+  word_t mhartid;
+  word_t mscratch;
+  word_t mtval;
+  word_t satp;
+  word_t fcsr; // frm in bits 7:5, fflags in bits 4:0
+  word_t vstart, vl, vtype;
 } MUXDEF(CONFIG_RV64, riscv64_CSRs, riscv32_CSRs);
 
 typedef struct {
   word_t gpr[MUXDEF(CONFIG_RVE, 16, 32)]; 
   vaddr_t pc; 
   MUXDEF(CONFIG_RV64, riscv64_CSRs, riscv32_CSRs) csr;
-  bool INTR; 
+  // reservation of lr.w, sc.w succeeds if the word there is still `val'
+  struct { vaddr_t addr; word_t val; bool valid; } resv;
+  // counter i reads its source plus offset[i], or just offset[i] if it is inhibited
+  struct {
+    uint64_t event[NR_HPM_EVENT]; // always counted
+    uint64_t offset[32];
+    word_t sel[32];               // mhpmevent
+    word_t inhibit;               // mcountinhibit
+  } hpm;
+#ifdef CONFIG_RVFD
+  uint64_t fpr[32]; // single-precision values are NaN-boxed
+#endif
+#ifdef CONFIG_RVV
+  // a register group is contiguous, element i of it is at byte i * SEW / 8
+  uint8_t vr[32][CONFIG_RVV_VLEN / 8] __attribute__((aligned(16)));
+#endif
 } MUXDEF(CONFIG_RV64, riscv64_CPU_state, riscv32_CPU_state);
 
 
 typedef struct {
   union {
-    uint32_t val;
+    uint32_t val; // as fetched, only the lower 16 bits for a compressed instruction
   } inst;
+  uint32_t full;  // the 32-bit form which is decoded
 } MUXDEF(CONFIG_RV64, riscv64_ISADecodeInfo, riscv32_ISADecodeInfo);
 
 // 定义一个宏，用于执行内存管理单元的检查，始终返回 MMU_DIRECT。
 #define isa_mmu_check(vaddr, len, type) (MMU_DIRECT)
 
+// a cheap check before isa_query_intr(), which is only needed if an interrupt is both pending and enabled
+#define isa_intr_pending() ((cpu.csr.mip & cpu.csr.mie) != 0)
+
 #endif
 
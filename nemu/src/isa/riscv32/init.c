@@ -15,6 +15,7 @@
 
 #include <isa.h>
 #include <memory/paddr.h>
+#include "local-include/csr.h"
 
 // this is not consistent with uint8_t
 // but it is ok since we do not access the array directly
@@ -27,11 +28,17 @@ static const uint32_t img [] = {
 };
 
 static void restart() {
-  /* Set the initial program counter. */
-  cpu.pc = RESET_VECTOR;
+  for (int i = 0; i < NR_HART; i ++) {
+    CPU_state *c = &machine->harts[i].state;
+    /* Set the initial program counter. */
+    c->pc = RESET_VECTOR;
 
-  /* The zero register is always 0. */
-  cpu.gpr[0] = 0;
+    /* The zero register is always 0. */
+    c->gpr[0] = 0;
+
+    c->csr.mhartid = i;
+    c->csr.mstatus = MSTATUS_MPP_M;
+  }
 }
 
 void init_isa() {
@@ -40,4 +47,6 @@ void init_isa() {
 
   /* Initialize this virtual computer system. */
   restart();
+
+  init_csr();
 }
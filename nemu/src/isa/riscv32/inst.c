@@ -17,10 +17,17 @@
 #include <cpu/cpu.h> // 包含 CPU 的结构和函数
 #include <cpu/ifetch.h> // 包含指令取址的函数
 #include <cpu/decode.h> // 包含指令解码的函数
+#include <cpu/bpred.h>
+#include <cpu/timing.h>
+#include <cpu/difftest.h>
+#include "local-include/fpu.h"
+#include "local-include/rvc.h"
+#include "local-include/vector.h"
+#include "local-include/csr.h"
 
 #define R(i) gpr(i) // 定义一个宏，用于访问通用寄存器的值
-#define Mr vaddr_read // 定义一个宏，用于读取虚拟地址的内容
-#define Mw vaddr_write // 定义一个宏，用于写入虚拟地址的内容
+#define Mr(addr, len) (hpm_count(LOAD), vaddr_read(addr, len)) // 读取虚拟地址的内容，并计入访存事件
+#define Mw(addr, len, data) (hpm_count(STORE), vaddr_write(addr, len, data)) // 写入虚拟地址的内容
 
 enum {
   TYPE_I, TYPE_U, TYPE_S,TYPE_R, TYPE_B, TYPE_J,
@@ -39,23 +46,165 @@ enum {
 #define func3() BITS(i, 14, 12)
 // 定义一个宏，用于获取 R 型指令的功能码
 #define func7() BITS(i, 31, 25)
-static vaddr_t *csr_register(word_t imm) {
-  switch (imm)
-  {
-  case 0x341: return &(cpu.csr.mepc);
-  case 0x342: return &(cpu.csr.mcause);
-  case 0x300: return &(cpu.csr.mstatus);
-  case 0x305: return &(cpu.csr.mtvec);
-  default: panic("Unknown csr");
+
+#define UIMM BITS(s->isa.full, 19, 15) // csrr?i 中零扩展的 rs1 字段
+// rs1 为 x0 或者 uimm 为 0 时，csrrs 和 csrrc 不写 CSR
+#define CSRRX(new_val, wen) do { \
+  int no = BITS(s->isa.full, 31, 20); \
+  word_t t; \
+  if (!csr_read(no, &t) || ((wen) && !csr_write(no, new_val))) { INV(s->pc); break; } \
+  R(rd) = t; \
+} while (0)
+// mepc 指向下一条指令，AM 的异常处理程序直接返回到那里
+#define ECALL(dnpc) { bool success; dnpc = (isa_raise_intr(isa_reg_str2val("a7", &success), s->pc + 4)); }
+
+/* 其他 hart 的写操作不会使保留失效，sc.w 用宿主机的原子指令与 lr.w 读到的值进行
+ * 比较并交换。只有其他 hart 写回了相同的值时 (ABA 问题)，才与真正的保留不同。
+ */
+static word_t lr(vaddr_t addr, int len) {
+  word_t val = Mr(addr, len);
+  cpu.resv.addr = addr;
+  cpu.resv.val = val;
+  cpu.resv.valid = true;
+  return val;
+}
+
+// 成功时返回 0，作为 sc.w 的 rd
+static word_t sc(vaddr_t addr, int len, word_t data) {
+  bool ok = cpu.resv.valid && cpu.resv.addr == addr &&
+    vaddr_cmpxchg(addr, len, cpu.resv.val, data);
+  cpu.resv.valid = false;
+  return !ok;
+}
+
+// 不对齐的原子操作引发异常而不访存：lr.w 是读地址不对齐 (4)，sc.w 和 AMO 是写/AMO 地址不对齐 (6)
+static bool misaligned(Decode *s, vaddr_t addr, int len, word_t cause) {
+  if (addr % len == 0) return false;
+  cpu.csr.mtval = addr;
+  s->dnpc = isa_raise_intr(cause, s->pc);
+  return true;
+}
+
+#ifdef CONFIG_RVFD
+static inline uint64_t *fpr_write(int rd) {
+  fpu_set_dirty();
+  return &cpu.fpr[rd];
+}
+
+static bool bad_rm(Decode *s) {
+  if (fpu_rm_valid(BITS(s->isa.full, 14, 12))) return false;
+  cpu.csr.mtval = s->isa.full;
+  s->dnpc = isa_raise_intr(2, s->pc);
+  return true;
+}
+#endif
+
+#define AMO(op) do { if (!misaligned(s, src1, 4, 6)) R(rd) = SEXT(vaddr_amo(src1, 4, concat(AMO_, op), src2), 32); } while (0)
+
+#ifdef CONFIG_RVB
+static inline word_t ror32(word_t x, int shamt) { return (x >> (shamt & 31)) | (x << (-shamt & 31)); }
+
+static inline word_t orc_b(word_t x) {
+  word_t t = (((x & 0x7f7f7f7f) + 0x7f7f7f7f) | x) & 0x80808080; // 非零字节的最高位
+  return (t >> 7) * 0xff;
+}
+
+#define BIT(n) ((word_t)1 << ((n) & 31))
+#endif
+
+#ifdef CONFIG_RVFD
+#define F1 (cpu.fpr[BITS(s->isa.full, 19, 15)])
+#define F2 (cpu.fpr[BITS(s->isa.full, 24, 20)])
+#define F3 (cpu.fpr[BITS(s->isa.full, 31, 27)])
+#define FD (*fpr_write(rd))
+#define RM BITS(s->isa.full, 14, 12)
+#define DP BITS(s->isa.full, 25, 25) // 是否为双精度格式
+#define FARITH(op) FD = fpu_arith(concat(FOP_, op), DP, RM, F1, F2, F3)
+// 带舍入模式的指令先检查 rm，保留的舍入模式引发非法指令异常 (2)，不执行指令
+#define FRM(...) do { if (!bad_rm(s)) { __VA_ARGS__; } } while (0)
+#define FLOAD64(addr) (Mr(addr, 4) | (uint64_t)vaddr_read((addr) + 4, 4) << 32)
+#define FSTORE64(addr, val) do { Mw(addr, 4, (uint32_t)(val)); vaddr_write((addr) + 4, 4, (val) >> 32); } while (0)
+#endif
+
+#ifdef CONFIG_RVV
+// rs1 = x0 时，若 rd 也是 x0 则保持 vl 不变，否则请求 VLMAX
+#define AVL(avl) (BITS(s->isa.full, 19, 15) != 0 ? (avl) : (rd != 0 ? (word_t)-1 : cpu.csr.vl))
+#define VCHECK(ok) do { if (!(ok)) INV(s->pc); } while (0)
+#endif
+
+// 按照 RISC-V 非特权级手册表 2.1 中返回地址栈的提示对跳转分类
+static inline int jump_attr(Decode *s, int rd, bool indirect) {
+  int rs1 = BITS(s->isa.full, 19, 15);
+  bool rd_link = (rd == 1 || rd == 5);
+  bool rs1_link = indirect && (rs1 == 1 || rs1 == 5);
+  int attr = (indirect ? BP_INDIRECT : 0);
+  if (rd_link) attr |= BP_PUSH;
+  if (rs1_link && (!rd_link || rd != rs1)) attr |= BP_POP;
+  return attr;
+}
+
+// 没有分支预测器时，每个跳转的分支都会重定向取指
+#define BRANCH(cond) do { \
+  bool taken = (cond); \
+  if (taken) s->dnpc = s->pc + imm; \
+  hpm_count(BRANCH); \
+  cpu.hpm.event[HPM_BRANCH_TAKEN] += taken; \
+  bool miss = bpred_branch(s->pc, taken); \
+  timing_redirect(ISDEF(CONFIG_BPRED) ? miss : taken); \
+} while (0)
+
+#define JUMP(target, indirect) do { \
+  s->dnpc = (target); \
+  hpm_count(JUMP); \
+  bool miss = bpred_jump(s->pc, s->dnpc, s->snpc, jump_attr(s, rd, indirect)); \
+  timing_redirect(ISDEF(CONFIG_BPRED) ? miss : true); \
+  R(rd) = s->snpc; \
+} while (0)
+
+#ifdef CONFIG_TIMING
+static void timing_classify(Decode *s) {
+  uint32_t i = s->isa.full;
+  int rd = BITS(i, 11, 7), rs1 = BITS(i, 19, 15), rs2 = BITS(i, 24, 20);
+  int cls = TM_ALU;
+  switch (BITS(i, 6, 0)) {
+    case 0x03: cls = TM_LOAD;   rs2 = 0; break;
+    case 0x2f: cls = TM_LOAD;   break;      // AMO
+    case 0x07: cls = TM_LOAD;   rd = rs2 = 0; break; // 浮点读写内存指令的数据寄存器
+    case 0x27: cls = TM_STORE;  rd = rs2 = 0; break; // 不是通用寄存器
+    case 0x43: case 0x47: case 0x4b: case 0x4f: case 0x53: rd = rs1 = rs2 = 0; break; // 浮点运算
+    case 0x57: rd = rs1 = rs2 = 0; break; // 向量
+    case 0x23: cls = TM_STORE;  rd = 0;  break;
+    case 0x63: cls = TM_BRANCH; rd = 0;  break;
+    case 0x6f: cls = TM_JUMP;   rs1 = rs2 = 0; break;
+    case 0x67: cls = TM_JUMP;   rs2 = 0; break;
+    case 0x37: case 0x17: rs1 = rs2 = 0; break; // lui 和 auipc
+    case 0x13: rs2 = 0; break;                  // 立即数运算
+    case 0x33:
+      if (BITS(i, 31, 25) == 1) cls = (BITS(i, 14, 12) < 4 ? TM_MUL : TM_DIV);
+      break;
+    case 0x73: cls = TM_SYSTEM; rs2 = 0; break;
   }
+  timing_inst(s->pc, cls, rd, rs1, rs2);
 }
-#define ECALL(dnpc) { bool success; dnpc = (isa_raise_intr(isa_reg_str2val("a7", &success), s->pc)); }
-#define CSR(i) *csr_register(i)
+#endif
+
+#ifdef CONFIG_DIFFTEST
+// 写 CSR、浮点寄存器、向量寄存器或者 LR/SC 保留状态的指令，这些状态在 REF 中无法回滚，需要单独比较
+static inline bool difftest_unbatchable(uint32_t i) {
+  switch (BITS(i, 6, 0)) {
+    case 0x73: return true; // SYSTEM
+    case 0x07: case 0x43: case 0x47: case 0x4b: case 0x4f: case 0x53: return true; // 浮点和向量的读内存与运算
+    case 0x57: return true; // 向量
+    case 0x2f: return BITS(i, 31, 28) == 0x1; // lr.w 和 sc.w
+    default: return false;
+  }
+}
+#endif
 
 
 static void decode_operand(Decode *s, int *rd, word_t *src1, word_t *src2, word_t *imm, int type) {
   // 定义一个静态函数，用于解码指令的操作数
-  uint32_t i = s->isa.inst.val; // 获取指令的原始值
+  uint32_t i = s->isa.full; // 获取指令的 32 位形式
   int rs1 = BITS(i, 19, 15); // 获取源寄存器 1 的编号
   int rs2 = BITS(i, 24, 20); // 获取源寄存器 2 的编号
   *rd     = BITS(i, 11, 7); // 获取目标寄存器的编号
@@ -77,7 +226,7 @@ static int decode_exec(Decode *s) {
   word_t src1 = 0, src2 = 0, imm = 0; // 定义三个变量，用于存放操作数的值
   s->dnpc = s->snpc; // 设置下一条指令的地址
 
-#define INSTPAT_INST(s) ((s)->isa.inst.val) // 定义一个宏，用于获取指令的原始值
+#define INSTPAT_INST(s) ((s)->isa.full) // 定义一个宏，用于获取指令的 32 位形式
 #define INSTPAT_MATCH(s, name, type, ... /* execute body */ ) { \
   decode_operand(s, &rd, &src1, &src2, &imm, concat(TYPE_, type)); \
   __VA_ARGS__ ; \
@@ -93,17 +242,17 @@ INSTPAT("0000000 ????? ????? 000 ????? 01100 11", add    , R, R(rd) = src1 + src
 INSTPAT("0000000 ????? ????? 000 ????? 01110 11", addw   , R, R(rd) = SEXT(src1 + src2, 32));
 INSTPAT("??????? ????? ????? 000 ????? 00100 11", addi   , I, R(rd) = src1 + imm);
 INSTPAT("??????? ????? ????? 000 ????? 00110 11", addiw  , I, R(rd) = SEXT(src1 + imm, 32));
-INSTPAT("??????? ????? ????? 000 ????? 11000 11", beq    , B, if (src1 == src2) s->dnpc = s->pc + imm);
-INSTPAT("??????? ????? ????? 001 ????? 11000 11", bne    , B, if (src1 != src2) s->dnpc = s->pc + imm);
-INSTPAT("??????? ????? ????? 100 ????? 11000 11", blt    , B, if ((sword_t)src1 < (sword_t)src2) s->dnpc = s->pc + imm);
-INSTPAT("??????? ????? ????? 110 ????? 11000 11", bltu   , B, if (src1 < src2) s->dnpc = s->pc + imm);
-INSTPAT("??????? ????? ????? 111 ????? 11000 11", bgeu   , B, if (src1 >= src2) s->dnpc = s->pc + imm);
-INSTPAT("??????? ????? ????? 101 ????? 11000 11", bge    , B, if ((sword_t)src1 >= (sword_t)src2) s->dnpc = s->pc + imm);
+INSTPAT("??????? ????? ????? 000 ????? 11000 11", beq    , B, BRANCH(src1 == src2));
+INSTPAT("??????? ????? ????? 001 ????? 11000 11", bne    , B, BRANCH(src1 != src2));
+INSTPAT("??????? ????? ????? 100 ????? 11000 11", blt    , B, BRANCH((sword_t)src1 < (sword_t)src2));
+INSTPAT("??????? ????? ????? 110 ????? 11000 11", bltu   , B, BRANCH(src1 < src2));
+INSTPAT("??????? ????? ????? 111 ????? 11000 11", bgeu   , B, BRANCH(src1 >= src2));
+INSTPAT("??????? ????? ????? 101 ????? 11000 11", bge    , B, BRANCH((sword_t)src1 >= (sword_t)src2));
 INSTPAT("0000001 ????? ????? 100 ????? 01100 11", div    , R, R(rd) = (int32_t)src1 / (int32_t)src2); 
 INSTPAT("0000001 ????? ????? 101 ????? 01100 11", divu   , R, R(rd) = src1 / src2); 
 INSTPAT("0000001 ????? ????? 100 ????? 01110 11", divw   , R, R(rd) = SEXT(src1, 32) / SEXT(src2, 32));
-INSTPAT("??????? ????? ????? ??? ????? 11011 11", jal    , J, s->dnpc = s->pc; s->dnpc += imm; R(rd) = s->pc + 4);//aaaa
-INSTPAT("??????? ????? ????? 000 ????? 11001 11", jalr   , I, s->dnpc = (src1 + imm) & ~(word_t)1; R(rd) = s->pc + 4);//aaaa
+INSTPAT("??????? ????? ????? ??? ????? 11011 11", jal    , J, JUMP(s->pc + imm, false));
+INSTPAT("??????? ????? ????? 000 ????? 11001 11", jalr   , I, JUMP((src1 + imm) & ~(word_t)1, true));
 INSTPAT("??????? ????? ????? ??? ????? 01101 11", lui    , U, R(rd) = imm);
 INSTPAT("??????? ????? ????? 000 ????? 00000 11", lb     , I, R(rd) = SEXT(Mr(src1 + imm, 1), 8));
 INSTPAT("??????? ????? ????? 001 ????? 00000 11", lh     , I, R(rd) = SEXT(Mr(src1 + imm, 2), 16));
@@ -151,10 +300,104 @@ INSTPAT("0100000 ????? ????? 000 ????? 01100 11", sub    , R, R(rd) = src1 - src
 INSTPAT("0100000 ????? ????? 000 ????? 01110 11", subw   , R, R(rd) = SEXT(src1 - src2, 32));
 INSTPAT("0000000 ????? ????? 100 ????? 01100 11", xor    , R, R(rd) = src1 ^ src2);
 
-INSTPAT("??????? ????? ????? 001 ????? 11100 11", csrrw  , I, R(rd) = CSR(imm); CSR(imm) = src1);
-INSTPAT("??????? ????? ????? 010 ????? 11100 11", csrrs  , I, R(rd) = CSR(imm); CSR(imm) |= src1);
-INSTPAT("??????? ????? ????? 011 ????? 11100 11", csrrc, I, R(rd) = CSR(imm); CSR(imm) &= ~src1);
-INSTPAT("0011000 00010 00000 000 00000 11100 11", mret,  I, s->dnpc=CSR(0x341););
+INSTPAT("00010?? 00000 ????? 010 ????? 01011 11", lr_w      , R, if (!misaligned(s, src1, 4, 4)) R(rd) = SEXT(lr(src1, 4), 32));
+INSTPAT("00011?? ????? ????? 010 ????? 01011 11", sc_w      , R, if (!misaligned(s, src1, 4, 6)) R(rd) = sc(src1, 4, src2));
+INSTPAT("00001?? ????? ????? 010 ????? 01011 11", amoswap_w , R, AMO(SWAP));
+INSTPAT("00000?? ????? ????? 010 ????? 01011 11", amoadd_w  , R, AMO(ADD));
+INSTPAT("00100?? ????? ????? 010 ????? 01011 11", amoxor_w  , R, AMO(XOR));
+INSTPAT("01100?? ????? ????? 010 ????? 01011 11", amoand_w  , R, AMO(AND));
+INSTPAT("01000?? ????? ????? 010 ????? 01011 11", amoor_w   , R, AMO(OR));
+INSTPAT("10000?? ????? ????? 010 ????? 01011 11", amomin_w  , R, AMO(MIN));
+INSTPAT("10100?? ????? ????? 010 ????? 01011 11", amomax_w  , R, AMO(MAX));
+INSTPAT("11000?? ????? ????? 010 ????? 01011 11", amominu_w , R, AMO(MINU));
+INSTPAT("11100?? ????? ????? 010 ????? 01011 11", amomaxu_w , R, AMO(MAXU));
+
+#ifdef CONFIG_RVB
+INSTPAT("0010000 ????? ????? 010 ????? 01100 11", sh1add   , R, R(rd) = (src1 << 1) + src2);
+INSTPAT("0010000 ????? ????? 100 ????? 01100 11", sh2add   , R, R(rd) = (src1 << 2) + src2);
+INSTPAT("0010000 ????? ????? 110 ????? 01100 11", sh3add   , R, R(rd) = (src1 << 3) + src2);
+INSTPAT("0100000 ????? ????? 111 ????? 01100 11", andn     , R, R(rd) = src1 & ~src2);
+INSTPAT("0100000 ????? ????? 110 ????? 01100 11", orn      , R, R(rd) = src1 | ~src2);
+INSTPAT("0100000 ????? ????? 100 ????? 01100 11", xnor     , R, R(rd) = ~(src1 ^ src2));
+INSTPAT("0110000 00000 ????? 001 ????? 00100 11", clz      , I, R(rd) = (src1 == 0 ? 32 : __builtin_clz(src1)));
+INSTPAT("0110000 00001 ????? 001 ????? 00100 11", ctz      , I, R(rd) = (src1 == 0 ? 32 : __builtin_ctz(src1)));
+INSTPAT("0110000 00010 ????? 001 ????? 00100 11", cpop     , I, R(rd) = __builtin_popcount(src1));
+INSTPAT("0000101 ????? ????? 110 ????? 01100 11", max      , R, R(rd) = ((sword_t)src1 > (sword_t)src2 ? src1 : src2));
+INSTPAT("0000101 ????? ????? 111 ????? 01100 11", maxu     , R, R(rd) = (src1 > src2 ? src1 : src2));
+INSTPAT("0000101 ????? ????? 100 ????? 01100 11", min      , R, R(rd) = ((sword_t)src1 < (sword_t)src2 ? src1 : src2));
+INSTPAT("0000101 ????? ????? 101 ????? 01100 11", minu     , R, R(rd) = (src1 < src2 ? src1 : src2));
+INSTPAT("0110000 00100 ????? 001 ????? 00100 11", sext_b   , I, R(rd) = SEXT(BITS(src1, 7, 0), 8));
+INSTPAT("0110000 00101 ????? 001 ????? 00100 11", sext_h   , I, R(rd) = SEXT(BITS(src1, 15, 0), 16));
+INSTPAT("0000100 00000 ????? 100 ????? 01100 11", zext_h   , R, R(rd) = BITS(src1, 15, 0));
+INSTPAT("0110000 ????? ????? 001 ????? 01100 11", rol      , R, R(rd) = ror32(src1, -(int)src2));
+INSTPAT("0110000 ????? ????? 101 ????? 01100 11", ror      , R, R(rd) = ror32(src1, src2));
+INSTPAT("0110000 ????? ????? 101 ????? 00100 11", rori     , I, R(rd) = ror32(src1, imm));
+INSTPAT("0010100 00111 ????? 101 ????? 00100 11", orc_b    , I, R(rd) = orc_b(src1));
+INSTPAT("0110100 11000 ????? 101 ????? 00100 11", rev8     , I, R(rd) = __builtin_bswap32(src1));
+INSTPAT("0100100 ????? ????? 001 ????? 01100 11", bclr     , R, R(rd) = src1 & ~BIT(src2));
+INSTPAT("0100100 ????? ????? 001 ????? 00100 11", bclri    , I, R(rd) = src1 & ~BIT(imm));
+INSTPAT("0100100 ????? ????? 101 ????? 01100 11", bext     , R, R(rd) = (src1 & BIT(src2)) != 0);
+INSTPAT("0100100 ????? ????? 101 ????? 00100 11", bexti    , I, R(rd) = (src1 & BIT(imm)) != 0);
+INSTPAT("0110100 ????? ????? 001 ????? 01100 11", binv     , R, R(rd) = src1 ^ BIT(src2));
+INSTPAT("0110100 ????? ????? 001 ????? 00100 11", binvi    , I, R(rd) = src1 ^ BIT(imm));
+INSTPAT("0010100 ????? ????? 001 ????? 01100 11", bset     , R, R(rd) = src1 | BIT(src2));
+INSTPAT("0010100 ????? ????? 001 ????? 00100 11", bseti    , I, R(rd) = src1 | BIT(imm));
+#endif
+
+#ifdef CONFIG_RVFD
+INSTPAT("??????? ????? ????? 010 ????? 00001 11", flw      , I, FD = fpu_box32(Mr(src1 + imm, 4)));
+INSTPAT("??????? ????? ????? 011 ????? 00001 11", fld      , I, FD = FLOAD64(src1 + imm));
+INSTPAT("??????? ????? ????? 010 ????? 01001 11", fsw      , S, Mw(src1 + imm, 4, (uint32_t)F2));
+INSTPAT("??????? ????? ????? 011 ????? 01001 11", fsd      , S, FSTORE64(src1 + imm, F2));
+INSTPAT("?????0? ????? ????? ??? ????? 10000 11", fmadd    , N, FRM(FARITH(MADD)));
+INSTPAT("?????0? ????? ????? ??? ????? 10001 11", fmsub    , N, FRM(FARITH(MSUB)));
+INSTPAT("?????0? ????? ????? ??? ????? 10010 11", fnmsub   , N, FRM(FARITH(NMSUB)));
+INSTPAT("?????0? ????? ????? ??? ????? 10011 11", fnmadd   , N, FRM(FARITH(NMADD)));
+INSTPAT("000000? ????? ????? ??? ????? 10100 11", fadd     , N, FRM(FARITH(ADD)));
+INSTPAT("000010? ????? ????? ??? ????? 10100 11", fsub     , N, FRM(FARITH(SUB)));
+INSTPAT("000100? ????? ????? ??? ????? 10100 11", fmul     , N, FRM(FARITH(MUL)));
+INSTPAT("000110? ????? ????? ??? ????? 10100 11", fdiv     , N, FRM(FARITH(DIV)));
+INSTPAT("010110? 00000 ????? ??? ????? 10100 11", fsqrt    , N, FRM(FARITH(SQRT)));
+INSTPAT("001000? ????? ????? 000 ????? 10100 11", fsgnj    , N, FD = fpu_sgnj(FOP_SGNJ, DP, F1, F2));
+INSTPAT("001000? ????? ????? 001 ????? 10100 11", fsgnjn   , N, FD = fpu_sgnj(FOP_SGNJN, DP, F1, F2));
+INSTPAT("001000? ????? ????? 010 ????? 10100 11", fsgnjx   , N, FD = fpu_sgnj(FOP_SGNJX, DP, F1, F2));
+INSTPAT("001010? ????? ????? 000 ????? 10100 11", fmin     , N, FARITH(MIN));
+INSTPAT("001010? ????? ????? 001 ????? 10100 11", fmax     , N, FARITH(MAX));
+INSTPAT("0100000 00001 ????? ??? ????? 10100 11", fcvt_s_d , N, FRM(FARITH(CVT_S_D)));
+INSTPAT("0100001 00000 ????? ??? ????? 10100 11", fcvt_d_s , N, FRM(FARITH(CVT_D_S)));
+INSTPAT("101000? ????? ????? 010 ????? 10100 11", feq      , N, R(rd) = fpu_cmp(FOP_EQ, DP, F1, F2));
+INSTPAT("101000? ????? ????? 001 ????? 10100 11", flt      , N, R(rd) = fpu_cmp(FOP_LT, DP, F1, F2));
+INSTPAT("101000? ????? ????? 000 ????? 10100 11", fle      , N, R(rd) = fpu_cmp(FOP_LE, DP, F1, F2));
+INSTPAT("111000? 00000 ????? 001 ????? 10100 11", fclass   , N, R(rd) = fpu_class(DP, F1));
+INSTPAT("110000? 00000 ????? ??? ????? 10100 11", fcvt_w   , N, FRM(R(rd) = fpu_to_int(DP, false, RM, F1)));
+INSTPAT("110000? 00001 ????? ??? ????? 10100 11", fcvt_wu  , N, FRM(R(rd) = fpu_to_int(DP, true, RM, F1)));
+INSTPAT("110100? 00000 ????? ??? ????? 10100 11", fcvt_f_w , I, FRM(FD = fpu_from_int(DP, false, RM, src1)));
+INSTPAT("110100? 00001 ????? ??? ????? 10100 11", fcvt_f_wu, I, FRM(FD = fpu_from_int(DP, true, RM, src1)));
+INSTPAT("1110000 00000 ????? 000 ????? 10100 11", fmv_x_w  , N, R(rd) = (uint32_t)F1);
+INSTPAT("1111000 00000 ????? 000 ????? 10100 11", fmv_w_x  , I, FD = fpu_box32(src1));
+#endif
+
+#ifdef CONFIG_RVV
+INSTPAT("0?????? ????? ????? 111 ????? 10101 11", vsetvli  , I, R(rd) = vec_setvl(AVL(src1), BITS(imm, 10, 0)));
+INSTPAT("11????? ????? ????? 111 ????? 10101 11", vsetivli , I, R(rd) = vec_setvl(UIMM, BITS(imm, 9, 0)));
+INSTPAT("1000000 ????? ????? 111 ????? 10101 11", vsetvl   , R, R(rd) = vec_setvl(AVL(src1), src2));
+INSTPAT("??????? ????? ????? 000 ????? 00001 11", vload    , R, hpm_count(LOAD); VCHECK(vec_load(s->isa.full, src1, src2)));
+INSTPAT("??????? ????? ????? 1?? ????? 00001 11", vload    , R, hpm_count(LOAD); VCHECK(vec_load(s->isa.full, src1, src2)));
+INSTPAT("??????? ????? ????? 000 ????? 01001 11", vstore   , R, hpm_count(STORE); VCHECK(vec_store(s->isa.full, src1, src2)));
+INSTPAT("??????? ????? ????? 1?? ????? 01001 11", vstore   , R, hpm_count(STORE); VCHECK(vec_store(s->isa.full, src1, src2)));
+INSTPAT("0100001 ????? 00000 010 ????? 10101 11", vmv_x_s  , N, VCHECK(vec_mv_x_s(BITS(s->isa.full, 24, 20), &R(rd))));
+INSTPAT("??????? ????? ????? ??? ????? 10101 11", vop      , I, VCHECK(vec_op(s->isa.full, src1)));
+#endif
+
+INSTPAT("??????? ????? ????? 001 ????? 11100 11", csrrw  , I, CSRRX(src1, true));
+INSTPAT("??????? ????? ????? 010 ????? 11100 11", csrrs  , I, CSRRX(t | src1, UIMM != 0));
+INSTPAT("??????? ????? ????? 011 ????? 11100 11", csrrc, I, CSRRX(t & ~src1, UIMM != 0));
+INSTPAT("??????? ????? ????? 101 ????? 11100 11", csrrwi , I, CSRRX(UIMM, true));
+INSTPAT("??????? ????? ????? 110 ????? 11100 11", csrrsi , I, CSRRX(t | UIMM, UIMM != 0));
+INSTPAT("??????? ????? ????? 111 ????? 11100 11", csrrci , I, CSRRX(t & ~UIMM, UIMM != 0));
+INSTPAT("0011000 00010 00000 000 00000 11100 11", mret,  I, s->dnpc=cpu.csr.mepc; restore_interrupt(););
+// wfi 等待挂起并且被 mie 打开的中断，不论 mstatus.MIE 是否置位
+INSTPAT("0001000 00101 00000 000 00000 11100 11", wfi   , N, if (!isa_intr_pending()) cpu_idle());
 
 INSTPAT("0000000 00000 00000 000 00000 11100 11", ecall  , I, ECALL(s->dnpc));
 
@@ -171,7 +414,20 @@ INSTPAT("0000000 00000 00000 000 00000 11100 11", ecall  , I, ECALL(s->dnpc));
 
 int isa_exec_once(Decode *s) {
   // 定义一个函数，用于执行一条指令
-  s->isa.inst.val = inst_fetch(&s->snpc, 4); // 从内存中取出一条指令，长度为 4 字节
-  return decode_exec(s); // 调用 decode_exec 函数，解码和执行指令
+#ifdef CONFIG_RVC
+  // 一次取 4 个字节，除非高半部分可能超出内存，例如内存末尾的压缩指令
+  uint32_t inst = inst_fetch(&s->snpc, likely(in_pmem(s->pc + 3)) ? 4 : 2);
+  bool compressed = rvc_is_compressed(inst);
+  if (compressed) { inst &= 0xffff; s->snpc = s->pc + 2; }
+  else if (s->snpc - s->pc == 2) inst |= inst_fetch(&s->snpc, 2) << 16;
+  s->isa.inst.val = inst;
+  s->isa.full = (compressed ? rvc_expand_cached(inst) : inst);
+#else
+  s->isa.inst.val = s->isa.full = inst_fetch(&s->snpc, 4); // 从内存中取出一条指令，长度为 4 字节
+#endif
+  int ret = decode_exec(s); // 调用 decode_exec 函数，解码和执行指令
+  IFDEF(CONFIG_DIFFTEST, if (difftest_unbatchable(s->isa.full)) difftest_isolate());
+  IFDEF(CONFIG_TIMING, timing_classify(s)); // 在时序模式下，按指令类别累加估算的周期数
+  return ret;
 }
 
@@ -0,0 +1,35 @@
+/***************************************************************************************
+* Copyright (c) 2014-2022 Zihao Yu, Nanjing University
+*
+* NEMU is licensed under Mulan PSL v2.
+* You can use this software according to the terms and conditions of the Mulan PSL v2.
+* You may obtain a copy of Mulan PSL v2 at:
+*          http://license.coscl.org.cn/MulanPSL2
+*
+* THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+* EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+* MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+*
+* See the Mulan PSL v2 for more details.
+***************************************************************************************/
+
+#ifndef __RISCV_CSR_H__
+#define __RISCV_CSR_H__
+
+#include <common.h>
+
+void init_csr();
+// return false if the CSR does not exist, or it is read-only and written
+bool csr_read(int no, word_t *val);
+bool csr_write(int no, word_t val);
+// mret restores mstatus.MIE from mstatus.MPIE
+void restore_interrupt();
+
+#define MSTATUS_MPP_M 0x00001800u // the only privilege mode
+#define MSTATUS_FS    0x00006000u // all ones is Dirty
+#define MSTATUS_VS    0x00000600u
+#define MSTATUS_SD    0x80000000u // FS or VS is Dirty
+
+#define hpm_count(e) (cpu.hpm.event[concat(HPM_, e)] ++)
+
+#endif
@@ -0,0 +1,51 @@
+/***************************************************************************************
+* Copyright (c) 2014-2022 Zihao Yu, Nanjing University
+*
+* NEMU is licensed under Mulan PSL v2.
+* You can use this software according to the terms and conditions of the Mulan PSL v2.
+* You may obtain a copy of Mulan PSL v2 at:
+*          http://license.coscl.org.cn/MulanPSL2
+*
+* THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+* EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+* MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+*
+* See the Mulan PSL v2 for more details.
+***************************************************************************************/
+
+#ifndef __RISCV_FPU_H__
+#define __RISCV_FPU_H__
+
+#include <common.h>
+#include "csr.h"
+
+// operations of fpu_arith(), in the order of the funct5 of OP-FP where possible
+enum {
+  FOP_ADD, FOP_SUB, FOP_MUL, FOP_DIV, FOP_SQRT, FOP_MIN, FOP_MAX,
+  FOP_MADD, FOP_MSUB, FOP_NMSUB, FOP_NMADD, FOP_CVT_S_D, FOP_CVT_D_S,
+};
+// operations of fpu_sgnj() and fpu_cmp()
+enum { FOP_SGNJ, FOP_SGNJN, FOP_SGNJX };
+enum { FOP_LE, FOP_LT, FOP_EQ };
+
+/* The values in fpr[] are 64-bit. Single-precision values are NaN-boxed,
+ * i.e. the upper 32 bits are all ones, otherwise they are read as the
+ * canonical NaN. `dp' selects double precision, `rm' is the rounding
+ * mode field of the instruction. The exceptions raised are accrued
+ * into fflags.
+ */
+uint64_t fpu_arith(int op, bool dp, int rm, uint64_t a, uint64_t b, uint64_t c);
+uint64_t fpu_sgnj(int op, bool dp, uint64_t a, uint64_t b);
+word_t fpu_cmp(int op, bool dp, uint64_t a, uint64_t b);
+word_t fpu_class(bool dp, uint64_t a);
+word_t fpu_to_int(bool dp, bool is_unsigned, int rm, uint64_t a);
+uint64_t fpu_from_int(bool dp, bool is_unsigned, int rm, word_t x);
+// false for the reserved rounding modes, including the dynamic one with a reserved frm
+bool fpu_rm_valid(int rm);
+
+// every write to the floating point registers or fcsr makes mstatus.FS Dirty
+static inline void fpu_set_dirty() { cpu.csr.mstatus |= MSTATUS_FS; }
+
+static inline uint64_t fpu_box32(uint32_t x) { return x | 0xffffffff00000000ull; }
+
+#endif
@@ -0,0 +1,39 @@
+/***************************************************************************************
+* Copyright (c) 2014-2022 Zihao Yu, Nanjing University
+*
+* NEMU is licensed under Mulan PSL v2.
+* You can use this software according to the terms and conditions of the Mulan PSL v2.
+* You may obtain a copy of Mulan PSL v2 at:
+*          http://license.coscl.org.cn/MulanPSL2
+*
+* THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+* EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+* MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+*
+* See the Mulan PSL v2 for more details.
+***************************************************************************************/
+
+#ifndef __RISCV_RVC_H__
+#define __RISCV_RVC_H__
+
+#include <common.h>
+
+static inline bool rvc_is_compressed(uint32_t lo) { return (lo & 0x3) != 0x3; }
+
+#ifdef CONFIG_RVC
+/* Expand a 16-bit instruction to its 32-bit equivalent. The expansion
+ * only depends on the 16 bits, so it is done once for every encoding and
+ * kept in a table indexed by them. Reserved and illegal encodings expand
+ * to 0, which is decoded as an invalid instruction.
+ */
+extern uint32_t rvc_table[1 << 16];
+uint32_t rvc_expand(uint16_t c);
+
+static inline uint32_t rvc_expand_cached(uint16_t c) {
+  uint32_t i = rvc_table[c];
+  if (likely(i != 0)) return i;
+  return (rvc_table[c] = rvc_expand(c));
+}
+#endif
+
+#endif
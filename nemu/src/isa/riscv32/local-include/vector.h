@@ -0,0 +1,31 @@
+/***************************************************************************************
+* Copyright (c) 2014-2022 Zihao Yu, Nanjing University
+*
+* NEMU is licensed under Mulan PSL v2.
+* You can use this software according to the terms and conditions of the Mulan PSL v2.
+* You may obtain a copy of Mulan PSL v2 at:
+*          http://license.coscl.org.cn/MulanPSL2
+*
+* THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+* EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+* MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+*
+* See the Mulan PSL v2 for more details.
+***************************************************************************************/
+
+#ifndef __RISCV_VECTOR_H__
+#define __RISCV_VECTOR_H__
+
+#include <common.h>
+
+/* `inst' is the whole instruction, `x' is the value of the general purpose
+ * register at rs1 and `stride' the one at rs2. The functions return false
+ * if the instruction is illegal or not supported.
+ */
+word_t vec_setvl(word_t avl, word_t vtype); // return the new vl
+bool vec_load(uint32_t inst, word_t base, word_t stride);
+bool vec_store(uint32_t inst, word_t base, word_t stride);
+bool vec_op(uint32_t inst, word_t x);
+bool vec_mv_x_s(int vs2, word_t *x);
+
+#endif
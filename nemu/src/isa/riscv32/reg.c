@@ -27,20 +27,24 @@ void isa_reg_display() {
 	for(int i = 0; i< 32 ;i++){
 			 printf("register #%s --> %x\n",regs[i],cpu.gpr[i]);
 	}
+#ifdef CONFIG_RVFD
+  for (int i = 0; i < 32; i ++) {
+    printf("register #f%d --> %016" PRIx64 "\n", i, cpu.fpr[i]);
+  }
+  printf("register #fcsr --> %x\n", cpu.csr.fcsr);
+#endif
 }
 
-word_t isa_reg_str2val(const char *s, bool *success) {
-  // 定义一个函数，用于根据寄存器的名称返回其当前值，参数是一个字符串指针和一个布尔指针
-  for (int i = 0; i < 32; i++) { // 用一个循环，遍历 32 个寄存器的名称
-    if (strcmp(s, regs[i]) == 0) { // 如果字符串 s 和第 i 个寄存器的名称相等，说明找到了对应的寄存器
-      *success = true; // 设置 success 指针指向的变量的值为 true，表示找到了寄存器
-      return cpu.gpr[i]; // 返回 cpu 结构体中的第 i 个寄存器的值
-    }
+int isa_reg_str2idx(const char *s) {
+  for (int i = 0; i < 32; i++) {
+    if (strcmp(s, regs[i]) == 0) return i;
   }
-  // 如果循环结束后没有找到对应的寄存器，说明 s 不是一个有效的寄存器名称
-  *success = false; // 设置 success 指针指向的变量的值为 false，表示没有找到寄存器
-  return 0; // 返回 0，表示无效的值
+  return -1;
 }
 
-
-
+word_t isa_reg_str2val(const char *s, bool *success) {
+  // 定义一个函数，用于根据寄存器的名称返回其当前值，参数是一个字符串指针和一个布尔指针
+  int i = isa_reg_str2idx(s); // 查找寄存器名称对应的下标
+  *success = (i >= 0); // 找到寄存器时设置 success 为 true，否则说明 s 不是一个有效的寄存器名称
+  return (*success ? cpu.gpr[i] : 0); // 返回 cpu 结构体中的第 i 个寄存器的值，无效时返回 0
+}
@@ -0,0 +1,137 @@
+/***************************************************************************************
+* Copyright (c) 2014-2022 Zihao Yu, Nanjing University
+*
+* NEMU is licensed under Mulan PSL v2.
+* You can use this software according to the terms and conditions of the Mulan PSL v2.
+* You may obtain a copy of Mulan PSL v2 at:
+*          http://license.coscl.org.cn/MulanPSL2
+*
+* THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+* EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+* MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+*
+* See the Mulan PSL v2 for more details.
+***************************************************************************************/
+
+#include <common.h>
+#include "local-include/rvc.h"
+
+#ifdef CONFIG_RVC
+
+uint32_t rvc_table[1 << 16] = {};
+
+#define OP_LOAD    0x03
+#define OP_LOAD_FP 0x07
+#define OP_IMM     0x13
+#define OP_STORE   0x23
+#define OP_STORE_FP 0x27
+#define OP_OP      0x33
+#define OP_LUI     0x37
+#define OP_BRANCH  0x63
+#define OP_JALR    0x67
+#define OP_JAL     0x6f
+#define OP_SYSTEM  0x73
+
+// assemble the 32-bit instructions of each format
+static inline uint32_t r_type(int funct7, int rs2, int rs1, int funct3, int rd, int op) {
+  return funct7 << 25 | rs2 << 20 | rs1 << 15 | funct3 << 12 | rd << 7 | op;
+}
+
+static inline uint32_t i_type(int32_t imm, int rs1, int funct3, int rd, int op) {
+  return (uint32_t)imm << 20 | rs1 << 15 | funct3 << 12 | rd << 7 | op;
+}
+
+static inline uint32_t s_type(int32_t imm, int rs2, int rs1, int funct3, int op) {
+  return BITS(imm, 11, 5) << 25 | rs2 << 20 | rs1 << 15 | funct3 << 12 | BITS(imm, 4, 0) << 7 | op;
+}
+
+static inline uint32_t b_type(int32_t imm, int rs2, int rs1, int funct3) {
+  return BITS(imm, 12, 12) << 31 | BITS(imm, 10, 5) << 25 | rs2 << 20 | rs1 << 15 |
+    funct3 << 12 | BITS(imm, 4, 1) << 8 | BITS(imm, 11, 11) << 7 | OP_BRANCH;
+}
+
+static inline uint32_t j_type(int32_t imm, int rd) {
+  return BITS(imm, 20, 20) << 31 | BITS(imm, 10, 1) << 21 | BITS(imm, 11, 11) << 20 |
+    BITS(imm, 19, 12) << 12 | rd << 7 | OP_JAL;
+}
+
+// fields of the compressed formats
+#define C(hi, lo) ((uint32_t)BITS(c, hi, lo))
+#define RD   C(11, 7)
+#define RS2  C(6, 2)
+#define RDP  (8 + C(4, 2))  // rd' and rs2'
+#define RS1P (8 + C(9, 7))  // rs1'
+#define IMM6 ((int32_t)SEXT(C(12, 12) << 5 | C(6, 2), 6))
+
+uint32_t rvc_expand(uint16_t c) {
+  // the offsets of the loads and stores are zero-extended and scaled
+  uint32_t lw_off  = C(5, 5) << 6 | C(12, 10) << 3 | C(6, 6) << 2;
+  uint32_t lwsp_off = C(3, 2) << 6 | C(12, 12) << 5 | C(6, 4) << 2;
+  uint32_t swsp_off = C(8, 7) << 6 | C(12, 9) << 2;
+#ifdef CONFIG_RVFD
+  uint32_t ld_off  = C(6, 5) << 6 | C(12, 10) << 3;
+  uint32_t ldsp_off = C(4, 2) << 6 | C(12, 12) << 5 | C(6, 5) << 3;
+  uint32_t sdsp_off = C(9, 7) << 6 | C(12, 10) << 3;
+#endif
+  int32_t j_off = SEXT(C(12, 12) << 11 | C(8, 8) << 10 | C(10, 9) << 8 | C(6, 6) << 7 |
+      C(7, 7) << 6 | C(2, 2) << 5 | C(11, 11) << 4 | C(5, 3) << 1, 12);
+  int32_t b_off = SEXT(C(12, 12) << 8 | C(6, 5) << 6 | C(2, 2) << 5 | C(11, 10) << 3 | C(4, 3) << 1, 9);
+
+  switch (C(1, 0) << 3 | C(15, 13)) {
+    // quadrant 0
+    case 000: { // c.addi4spn
+      uint32_t imm = C(10, 7) << 6 | C(12, 11) << 4 | C(5, 5) << 3 | C(6, 6) << 2;
+      return (imm == 0 ? 0 : i_type(imm, 2, 0, RDP, OP_IMM));
+    }
+    case 001: return MUXDEF(CONFIG_RVFD, i_type(ld_off, RS1P, 3, RDP, OP_LOAD_FP), 0); // c.fld
+    case 002: return i_type(lw_off, RS1P, 2, RDP, OP_LOAD);                             // c.lw
+    case 003: return MUXDEF(CONFIG_RVFD, i_type(lw_off, RS1P, 2, RDP, OP_LOAD_FP), 0); // c.flw
+    case 005: return MUXDEF(CONFIG_RVFD, s_type(ld_off, RDP, RS1P, 3, OP_STORE_FP), 0); // c.fsd
+    case 006: return s_type(lw_off, RDP, RS1P, 2, OP_STORE);                            // c.sw
+    case 007: return MUXDEF(CONFIG_RVFD, s_type(lw_off, RDP, RS1P, 2, OP_STORE_FP), 0); // c.fsw
+
+    // quadrant 1
+    case 010: return i_type(IMM6, RD, 0, RD, OP_IMM); // c.addi, c.nop
+    case 011: return j_type(j_off, 1);                // c.jal
+    case 012: return i_type(IMM6, 0, 0, RD, OP_IMM);  // c.li
+    case 013:
+      if (RD == 2) { // c.addi16sp
+        int32_t imm = SEXT(C(12, 12) << 9 | C(4, 3) << 7 | C(5, 5) << 6 | C(2, 2) << 5 | C(6, 6) << 4, 10);
+        return (imm == 0 ? 0 : i_type(imm, 2, 0, 2, OP_IMM));
+      }
+      return (IMM6 == 0 ? 0 : (uint32_t)IMM6 << 12 | RD << 7 | OP_LUI); // c.lui
+    case 014:
+      switch (C(11, 10)) {
+        case 0: return (C(12, 12) ? 0 : i_type(C(6, 2), RS1P, 5, RS1P, OP_IMM));            // c.srli
+        case 1: return (C(12, 12) ? 0 : i_type(0x400 | C(6, 2), RS1P, 5, RS1P, OP_IMM));    // c.srai
+        case 2: return i_type(IMM6, RS1P, 7, RS1P, OP_IMM);                                 // c.andi
+        default: {
+          if (C(12, 12)) return 0; // c.subw and c.addw of RV64
+          static const int funct3[] = { 0, 4, 6, 7 }; // c.sub, c.xor, c.or, c.and
+          return r_type(C(6, 5) == 0 ? 0x20 : 0, RDP, RS1P, funct3[C(6, 5)], RS1P, OP_OP);
+        }
+      }
+    case 015: return j_type(j_off, 0);             // c.j
+    case 016: return b_type(b_off, 0, RS1P, 0);    // c.beqz
+    case 017: return b_type(b_off, 0, RS1P, 1);    // c.bnez
+
+    // quadrant 2
+    case 020: return (C(12, 12) ? 0 : i_type(C(6, 2), RD, 1, RD, OP_IMM)); // c.slli
+    case 021: return MUXDEF(CONFIG_RVFD, i_type(ldsp_off, 2, 3, RD, OP_LOAD_FP), 0); // c.fldsp
+    case 022: return (RD == 0 ? 0 : i_type(lwsp_off, 2, 2, RD, OP_LOAD));         // c.lwsp
+    case 023: return MUXDEF(CONFIG_RVFD, i_type(lwsp_off, 2, 2, RD, OP_LOAD_FP), 0); // c.flwsp
+    case 024:
+      if (C(12, 12) == 0) {
+        if (RS2 != 0) return r_type(0, RS2, 0, 0, RD, OP_OP);         // c.mv
+        return (RD == 0 ? 0 : i_type(0, RD, 0, 0, OP_JALR));         // c.jr
+      }
+      if (RS2 != 0) return r_type(0, RS2, RD, 0, RD, OP_OP);         // c.add
+      if (RD == 0) return i_type(1, 0, 0, 0, OP_SYSTEM);             // c.ebreak
+      return i_type(0, RD, 0, 1, OP_JALR);                           // c.jalr
+    case 025: return MUXDEF(CONFIG_RVFD, s_type(sdsp_off, RS2, 2, 3, OP_STORE_FP), 0); // c.fsdsp
+    case 026: return s_type(swsp_off, RS2, 2, 2, OP_STORE);                            // c.swsp
+    case 027: return MUXDEF(CONFIG_RVFD, s_type(swsp_off, RS2, 2, 2, OP_STORE_FP), 0); // c.fswsp
+    default: return 0;
+  }
+}
+#endif
@@ -0,0 +1,237 @@
+/***************************************************************************************
+* Copyright (c) 2014-2022 Zihao Yu, Nanjing University
+*
+* NEMU is licensed under Mulan PSL v2.
+* You can use this software according to the terms and conditions of the Mulan PSL v2.
+* You may obtain a copy of Mulan PSL v2 at:
+*          http://license.coscl.org.cn/MulanPSL2
+*
+* THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+* EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+* MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+*
+* See the Mulan PSL v2 for more details.
+***************************************************************************************/
+
+#include <isa.h>
+#include <cpu/timing.h>
+#include <cpu/difftest.h>
+#include <stddef.h>
+#include "../local-include/csr.h"
+#include "../local-include/fpu.h"
+#ifndef CONFIG_TARGET_AM
+#include <pthread.h>
+#endif
+
+/* The CSRs are described by a table indexed by their numbers. A plain
+ * CSR is a field of CPU_state with a mask of the writable bits, the
+ * others are read and written through functions. Only machine mode is
+ * implemented, so every existing CSR is accessible. The table is shared
+ * by all machines and built once, the values of the CSRs are in the harts.
+ */
+
+typedef struct {
+  bool valid;
+  word_t (*read)(int no);           // NULL for a plain CSR
+  void (*write)(int no, word_t val);
+  int offset;                       // of the field in CPU_state
+  word_t wmask;
+} CSRInfo;
+
+static CSRInfo table[4096] = {};
+static word_t misa = 0;
+
+static inline word_t *field(const CSRInfo *c) {
+  return (word_t *)((uint8_t *)&cpu + c->offset);
+}
+
+bool csr_read(int no, word_t *val) {
+  const CSRInfo *c = &table[no];
+  if (unlikely(!c->valid)) return false;
+  *val = (c->read ? c->read(no) : *field(c));
+  return true;
+}
+
+// CSRs with the two top bits of their numbers set are read-only
+bool csr_write(int no, word_t val) {
+  const CSRInfo *c = &table[no];
+  if (unlikely(!c->valid || BITS(no, 11, 10) == 3)) return false;
+  if (c->write) c->write(no, val);
+  else if (c->wmask != 0) {
+    word_t *f = field(c);
+    *f = (*f & ~c->wmask) | (val & c->wmask);
+  }
+  return true;
+}
+
+/* ---------------- counters ---------------- */
+
+// counter 0 is mcycle, 2 is minstret, 3..31 are mhpmcounter3..31
+static uint64_t counter_source(int i) {
+  switch (i) {
+    case 0: return MUXDEF(CONFIG_TIMING, timing_cycles(), g_nr_guest_inst);
+    case 2: return g_nr_guest_inst;
+    default: return cpu.hpm.event[cpu.hpm.sel[i]];
+  }
+}
+
+static inline bool inhibited(int i) {
+  return (cpu.hpm.inhibit >> i) & 1;
+}
+
+static uint64_t counter_get(int i) {
+  return (inhibited(i) ? cpu.hpm.offset[i] : counter_source(i) + cpu.hpm.offset[i]);
+}
+
+static void counter_set(int i, uint64_t val) {
+  cpu.hpm.offset[i] = (inhibited(i) ? val : val - counter_source(i));
+}
+
+// REF counts neither the cycles of the timing model nor the instructions
+// skipped by difftest_skip_ref(), so it takes the counters from DUT
+static word_t counter_read(int no) {
+  difftest_skip_ref();
+  uint64_t val = counter_get(no & 0x1f);
+  return (no & 0x80 ? val >> 32 : val);
+}
+
+// the instruction writing a counter of instructions is not counted
+static void counter_write(int no, word_t val) {
+  int i = no & 0x1f;
+  uint64_t old = counter_get(i);
+  uint64_t new = (no & 0x80 ? (old & 0xffffffffull) | (uint64_t)val << 32 : (old & ~0xffffffffull) | val);
+  bool count_inst = (i == 2 || (i == 0 && !ISDEF(CONFIG_TIMING)));
+  counter_set(i, new - (count_inst && !inhibited(i)));
+}
+
+// unknown events are WARL and read as no event
+static void event_write(int no, word_t val) {
+  int i = no & 0x1f;
+  uint64_t old = counter_get(i);
+  cpu.hpm.sel[i] = (val < NR_HPM_EVENT ? val : HPM_NONE);
+  counter_set(i, old);
+}
+
+static void inhibit_write(int no, word_t val) {
+  val &= ~(word_t)0x2; // bit 1 (time) is read-only zero
+  uint64_t old[32];
+  for (int i = 0; i < 32; i ++) old[i] = counter_get(i);
+  cpu.hpm.inhibit = val;
+  for (int i = 0; i < 32; i ++) counter_set(i, old[i]);
+}
+
+/* ---------------- others ---------------- */
+
+static word_t zero_read(int no) { return 0; }
+static word_t misa_read(int no) { return misa; }
+static void ignore_write(int no, word_t val) {} // WARL with a single legal value
+
+// mstatus and mie may enable a pending interrupt, which is checked at the deadline of the hart
+static void intr_enable_write(int no, word_t val) {
+  const CSRInfo *c = &table[no];
+  word_t *f = field(c);
+  *f = (*f & ~c->wmask) | (val & c->wmask);
+  hart_kick(hart);
+}
+
+static word_t mstatus_read(int no) {
+  word_t s = cpu.csr.mstatus;
+  bool dirty = (s & MSTATUS_FS) == MSTATUS_FS || (s & MSTATUS_VS) == MSTATUS_VS;
+  return (dirty ? s | MSTATUS_SD : s);
+}
+
+// MSIP and MTIP are set by the CLINT and MEIP by the PLIC, which REF does not have
+static word_t mip_read(int no) {
+  difftest_skip_ref();
+  return __atomic_load_n(&cpu.csr.mip, __ATOMIC_ACQUIRE);
+}
+
+#ifdef CONFIG_RVFD
+// fflags and frm are fields of fcsr
+static word_t fcsr_read(int no) {
+  switch (no) {
+    case 0x001: return BITS(cpu.csr.fcsr, 4, 0);
+    case 0x002: return BITS(cpu.csr.fcsr, 7, 5);
+    default:    return BITS(cpu.csr.fcsr, 7, 0);
+  }
+}
+
+static void fcsr_write(int no, word_t val) {
+  fpu_set_dirty();
+  switch (no) {
+    case 0x001: cpu.csr.fcsr = (cpu.csr.fcsr & ~0x1f) | (val & 0x1f); break;
+    case 0x002: cpu.csr.fcsr = (cpu.csr.fcsr & ~0xe0) | ((val & 0x7) << 5); break;
+    default:    cpu.csr.fcsr = val & 0xff; break;
+  }
+}
+#endif
+
+#ifdef CONFIG_RVV
+static word_t vlenb_read(int no) { return CONFIG_RVV_VLEN / 8; }
+#endif
+
+static void def(int no, word_t (*read)(int), void (*write)(int, word_t), int offset, word_t wmask) {
+  Assert(!table[no].valid, "CSR 0x%03x is defined twice", no);
+  table[no] = (CSRInfo) { .valid = true, .read = read, .write = write, .offset = offset, .wmask = wmask };
+}
+
+#define PLAIN(no, f, wmask) def(no, NULL, NULL, offsetof(CPU_state, csr.f), wmask)
+#define HOOK(no, r, w) def(no, r, w, 0, 0)
+#define EXT(c) (1u << ((c) - 'A'))
+
+// MIE and MPIE, FS and VS with their extensions, MPP is read-only M and there is no MPRV without U-mode
+#define MSTATUS_WMASK (0x00000088u | MUXDEF(CONFIG_RVFD, MSTATUS_FS, 0) | MUXDEF(CONFIG_RVV, MSTATUS_VS, 0))
+#define MIE_WMASK     0x00000888u // MSIE, MTIE and MEIE
+
+static void init_table() {
+  misa = (1u << 30) | EXT('M') | EXT('A') | MUXDEF(CONFIG_RVE, EXT('E'), EXT('I')) |
+    MUXDEF(CONFIG_RVFD, EXT('F') | EXT('D'), 0) | MUXDEF(CONFIG_RVC, EXT('C'), 0);
+  // Zba, Zbb, Zbs and the subset of V are not the full B and V, which are not claimed
+
+  PLAIN(0xf14, mhartid, 0);
+  HOOK (0xf11, zero_read, NULL); // mvendorid
+  HOOK (0xf12, zero_read, NULL); // marchid
+  HOOK (0xf13, zero_read, NULL); // mimpid
+  HOOK (0x301, misa_read, ignore_write);
+  def(0x300, mstatus_read, intr_enable_write, offsetof(CPU_state, csr.mstatus), MSTATUS_WMASK);
+  def(0x304, NULL, intr_enable_write, offsetof(CPU_state, csr.mie), MIE_WMASK);
+  PLAIN(0x305, mtvec, ~(word_t)0x3); // direct mode only
+  PLAIN(0x340, mscratch, ~(word_t)0);
+  PLAIN(0x341, mepc, ~(word_t)MUXDEF(CONFIG_RVC, 0x1, 0x3));
+  PLAIN(0x342, mcause, ~(word_t)0);
+  PLAIN(0x343, mtval, ~(word_t)0);
+  HOOK (0x344, mip_read, ignore_write);
+  PLAIN(0x180, satp, ~(word_t)0);
+
+  for (int i = 0; i < 32; i ++) {
+    if (i == 1) continue; // time is not a machine counter
+    HOOK(0xb00 + i, counter_read, counter_write);
+    HOOK(0xb80 + i, counter_read, counter_write);
+    HOOK(0xc00 + i, counter_read, NULL);
+    HOOK(0xc80 + i, counter_read, NULL);
+    if (i >= 3) def(0x320 + i, NULL, event_write, offsetof(CPU_state, hpm.sel[i]), 0); // mhpmevent
+  }
+  def(0x320, NULL, inhibit_write, offsetof(CPU_state, hpm.inhibit), 0); // mcountinhibit
+
+#ifdef CONFIG_RVFD
+  HOOK(0x001, fcsr_read, fcsr_write); // fflags
+  HOOK(0x002, fcsr_read, fcsr_write); // frm
+  HOOK(0x003, fcsr_read, fcsr_write); // fcsr
+#endif
+#ifdef CONFIG_RVV
+  PLAIN(0x008, vstart, ~(word_t)0);
+  PLAIN(0xc20, vl, 0);
+  PLAIN(0xc21, vtype, 0);
+  HOOK (0xc22, vlenb_read, NULL);
+#endif
+}
+
+void init_csr() {
+#ifdef CONFIG_TARGET_AM
+  static bool done = false;
+  if (!done) { init_table(); done = true; }
+#else
+  static pthread_once_t once = PTHREAD_ONCE_INIT;
+  pthread_once(&once, init_table);
+#endif
+}
@@ -14,10 +14,13 @@
 ***************************************************************************************/
 
 #include <isa.h>
+#include <cpu/difftest.h>
 
 #define MPIE_OFFSET 7
 #define MIE_OFFSET 3
-#define IRQ_TIMER 0x80000007
+#define MIP_MSIP (1 << 3)
+#define MIP_MTIP (1 << 7)
+#define MIP_MEIP (1 << 11)
 word_t isa_raise_intr(word_t NO, vaddr_t epc) {
   /* TODO: Trigger an interrupt/exception with ``NO''.
    * Then return the address of the interrupt/exception vector.
@@ -28,10 +31,10 @@ word_t isa_raise_intr(word_t NO, vaddr_t epc) {
     // 将 MIE 置为 0
   cpu.csr.mstatus &= ~(1 << MIE_OFFSET);
   
-  epc+=4;
-  
+  cpu.hpm.event[(NO >> 31) ? HPM_INTERRUPT : HPM_EXCEPTION] ++;
   cpu.csr.mcause = NO;
   cpu.csr.mepc = epc;
+  difftest_isolate(); // 异常写了 CSR，在 REF 中无法回滚，这条指令需要单独比较
    
   return cpu.csr.mtvec;
 }
@@ -43,15 +46,29 @@ void restore_interrupt() {
   cpu.csr.mstatus = (cpu.csr.mstatus & ~(1 << MIE_OFFSET)) | ((cpu.csr.mstatus >> MPIE_OFFSET) & 0x1)<< MIE_OFFSET;
   // 将 MPIE 位置为 1
   cpu.csr.mstatus |= (1 << MPIE_OFFSET);
+  hart_kick(hart); // 打开中断后，挂起的中断在下一条指令之前响应
 
 }
 
 
 
+static void set_mip(int id, word_t bit, bool pending) {
+  word_t *mip = &machine->harts[id].state.csr.mip;
+  if (pending) __atomic_or_fetch(mip, bit, __ATOMIC_RELEASE);
+  else __atomic_and_fetch(mip, ~bit, __ATOMIC_RELEASE);
+  hart_kick(&machine->harts[id]);
+}
+
+// 由 CLINT 和 PLIC 调用，可能在其他 hart 的线程上
+void isa_set_msip(int id, bool pending) { set_mip(id, MIP_MSIP, pending); }
+void isa_set_mtip(int id, bool pending) { set_mip(id, MIP_MTIP, pending); }
+void isa_set_meip(int id, bool pending) { set_mip(id, MIP_MEIP, pending); }
+
+// 挂起并且打开的中断才会响应，优先级依次为外部中断、软件中断和时钟中断
 word_t isa_query_intr() {
-    if ((cpu.csr.mstatus & (1 << MIE_OFFSET))&& cpu.INTR) { 
-        cpu.INTR = false;
-        return IRQ_TIMER;
-    }
-    return INTR_EMPTY; 
+  word_t pending = __atomic_load_n(&cpu.csr.mip, __ATOMIC_ACQUIRE) & cpu.csr.mie;
+  if (pending == 0 || !(cpu.csr.mstatus & (1 << MIE_OFFSET))) return INTR_EMPTY;
+  if (pending & MIP_MEIP) return 0x80000000 | 11;
+  if (pending & MIP_MSIP) return 0x80000000 | 3;
+  return 0x80000000 | 7;
 }
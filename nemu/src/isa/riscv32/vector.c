@@ -0,0 +1,401 @@
+/***************************************************************************************
+* Copyright (c) 2014-2022 Zihao Yu, Nanjing University
+*
+* NEMU is licensed under Mulan PSL v2.
+* You can use this software according to the terms and conditions of the Mulan PSL v2.
+* You may obtain a copy of Mulan PSL v2 at:
+*          http://license.coscl.org.cn/MulanPSL2
+*
+* THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+* EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+* MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+*
+* See the Mulan PSL v2 for more details.
+***************************************************************************************/
+
+#include <isa.h>
+#include <memory/vaddr.h>
+#include <memory/host.h>
+#include "local-include/vector.h"
+
+#ifdef CONFIG_RVV
+
+/* A subset of RVV 1.0 with ELEN = 32. Inactive and tail elements are
+ * left undisturbed, which is also allowed by the agnostic policies.
+ * Instructions are never interrupted in the middle, so vstart is always
+ * 0 after them. Unmasked element-wise operations work on chunks of the
+ * width of the host SIMD registers with GCC vector types, and the
+ * remaining elements are handled one by one.
+ */
+
+#define VLENB (CONFIG_RVV_VLEN / 8)
+_Static_assert((CONFIG_RVV_VLEN & (CONFIG_RVV_VLEN - 1)) == 0, "VLEN should be a power of 2");
+
+#ifdef __AVX2__
+#define HOST_VBYTES 32
+#else
+#define HOST_VBYTES 16
+#endif
+
+#define VTYPE_VILL ((word_t)1 << 31)
+#define VR(r) (cpu.vr[r])
+
+// get log2 of SEW in bytes and log2 of LMUL, return false if vtype is illegal
+static bool vtype_decode(word_t vtype, int *sew, int *lmul) {
+  if (vtype >> 8) return false; // vill or reserved bits, vta and vma are ignored
+  int vsew = BITS(vtype, 5, 3), vlmul = BITS(vtype, 2, 0);
+  if (vsew > 2 || vlmul == 4) return false;
+  *sew = vsew;
+  *lmul = (vlmul < 4 ? vlmul : vlmul - 8);
+  return *sew <= *lmul + 2; // SEW <= LMUL * ELEN
+}
+
+static inline word_t vlmax(int sew, int lmul) {
+  word_t n = VLENB >> sew;
+  return (lmul >= 0 ? n << lmul : n >> -lmul);
+}
+
+word_t vec_setvl(word_t avl, word_t vtype) {
+  int sew, lmul;
+  if (vtype_decode(vtype, &sew, &lmul)) {
+    word_t max = vlmax(sew, lmul);
+    cpu.csr.vtype = vtype;
+    cpu.csr.vl = (avl < max ? avl : max);
+  } else {
+    cpu.csr.vtype = VTYPE_VILL;
+    cpu.csr.vl = 0;
+  }
+  cpu.csr.vstart = 0;
+  return cpu.csr.vl;
+}
+
+// a register group of 2^emul registers should be aligned to its size
+static inline bool vreg_ok(int r, int emul) {
+  return emul <= 0 || (r & BITMASK(emul)) == 0;
+}
+
+static inline bool vmask(int i) {
+  return (VR(0)[i >> 3] >> (i & 7)) & 1;
+}
+
+/* ---------------- loads and stores ---------------- */
+
+// log2 of the element width in bytes encoded in the width field
+static inline int eew_decode(int width) {
+  switch (width) {
+    case 0: return 0;
+    case 5: return 1;
+    case 6: return 2;
+    default: return -1;
+  }
+}
+
+static void vmem(bool is_store, vaddr_t addr, word_t stride, uint8_t *reg, int eew, int n, bool vm) {
+  int size = 1 << eew;
+  if (vm && stride == size) {
+    bool ok = (is_store ? vaddr_write_block(addr, reg, n << eew) : vaddr_read_block(addr, reg, n << eew));
+    if (ok) return;
+  }
+  for (int i = 0; i < n; i ++, addr += stride) {
+    if (!vm && !vmask(i)) continue;
+    if (is_store) vaddr_write(addr, size, host_read(reg + (i << eew), size));
+    else host_write(reg + (i << eew), size, vaddr_read(addr, size));
+  }
+}
+
+static bool vec_mem(bool is_store, uint32_t inst, word_t base, word_t stride) {
+  int nf = BITS(inst, 31, 29), mew = BITS(inst, 28, 28), mop = BITS(inst, 27, 26);
+  bool vm = BITS(inst, 25, 25);
+  int umop = BITS(inst, 24, 20), vd = BITS(inst, 11, 7);
+  int eew = eew_decode(BITS(inst, 14, 12));
+  if (eew < 0 || mew) return false;
+
+  if (mop == 0 && umop == 0x08) { // whole register, independent of vtype and vl
+    int nreg = nf + 1;
+    if (!vm || (nreg & (nreg - 1)) != 0 || (vd & (nreg - 1)) != 0) return false;
+    if (is_store && eew != 0) return false;
+    vmem(is_store, base, 1, VR(vd), 0, nreg * VLENB, true);
+    cpu.csr.vstart = 0;
+    return true;
+  }
+
+  // segments, indexed, mask and fault-only-first accesses are not supported
+  if (nf != 0 || (mop != 0 && mop != 2) || (mop == 0 && umop != 0)) return false;
+  int sew, lmul;
+  if (!vtype_decode(cpu.csr.vtype, &sew, &lmul)) return false;
+  int emul = lmul + eew - sew;
+  if (emul < -3 || emul > 3 || !vreg_ok(vd, emul)) return false;
+  if (!is_store && !vm && vd == 0) return false;
+  vmem(is_store, base, (mop == 0 ? (word_t)1 << eew : stride), VR(vd), eew, cpu.csr.vl, vm);
+  cpu.csr.vstart = 0;
+  return true;
+}
+
+bool vec_load(uint32_t inst, word_t base, word_t stride) {
+  return vec_mem(false, inst, base, stride);
+}
+
+bool vec_store(uint32_t inst, word_t base, word_t stride) {
+  return vec_mem(true, inst, base, stride);
+}
+
+/* ---------------- arithmetic ---------------- */
+
+enum {
+  EW_ADD, EW_SUB, EW_RSUB, EW_AND, EW_OR, EW_XOR, EW_SLL, EW_SRL, EW_SRA,
+  EW_MINU, EW_MIN, EW_MAXU, EW_MAX, EW_MUL, EW_MULH, EW_MULHU, EW_MULHSU, EW_MACC,
+  EW_MERGE, EW_MV,
+};
+enum { CMP_EQ, CMP_NE, CMP_LTU, CMP_LT, CMP_LEU, CMP_LE, CMP_GTU, CMP_GT };
+
+/* `u' is the element of vs2, `v' the one of vs1 or the scalar operand.
+ * EW_SIMD() goes through the host SIMD registers if no element is masked off.
+ */
+#define EW_SCALAR(expr) do { \
+  for (int i = 0; i < vl; i ++) { \
+    if (!vm && !vmask(i)) continue; \
+    T u = a[i], v = (b ? b[i] : s); \
+    (void)u; (void)v; \
+    d[i] = (expr); \
+  } \
+} while (0)
+
+#define EW_SIMD(expr) do { \
+  if (!vm) { EW_SCALAR(expr); break; } \
+  VT vs = (VT){} + s; \
+  int i = 0; \
+  for (; i + NR_LANE <= vl; i += NR_LANE) { \
+    VT u, v = vs, r; \
+    memcpy(&u, a + i, sizeof(VT)); \
+    if (b) memcpy(&v, b + i, sizeof(VT)); \
+    (void)u; \
+    r = (expr); \
+    memcpy(d + i, &r, sizeof(VT)); \
+  } \
+  for (; i < vl; i ++) { \
+    T u = a[i], v = (b ? b[i] : s); \
+    (void)u; \
+    d[i] = (expr); \
+  } \
+} while (0)
+
+#define DEF_EW(bits) \
+static void ew##bits(int op, void *vd, const void *vs2, const void *vs1, word_t x, bool vm, int vl) { \
+  typedef uint##bits##_t T; \
+  typedef int##bits##_t ST; \
+  typedef T VT __attribute__((vector_size(HOST_VBYTES))); \
+  enum { NR_LANE = HOST_VBYTES / sizeof(T) }; \
+  T *d = vd, s = x; \
+  const T *a = vs2, *b = vs1; \
+  switch (op) { \
+    case EW_ADD:    EW_SIMD(u + v); break; \
+    case EW_SUB:    EW_SIMD(u - v); break; \
+    case EW_RSUB:   EW_SIMD(v - u); break; \
+    case EW_AND:    EW_SIMD(u & v); break; \
+    case EW_OR:     EW_SIMD(u | v); break; \
+    case EW_XOR:    EW_SIMD(u ^ v); break; \
+    case EW_SLL:    EW_SIMD(u << (v & (bits - 1))); break; \
+    case EW_SRL:    EW_SIMD(u >> (v & (bits - 1))); break; \
+    case EW_MUL:    EW_SIMD(u * v); break; \
+    case EW_MV:     EW_SIMD(v); break; \
+    case EW_SRA:    EW_SCALAR((ST)u >> (v & (bits - 1))); break; \
+    case EW_MINU:   EW_SCALAR(u < v ? u : v); break; \
+    case EW_MIN:    EW_SCALAR((ST)u < (ST)v ? u : v); break; \
+    case EW_MAXU:   EW_SCALAR(u > v ? u : v); break; \
+    case EW_MAX:    EW_SCALAR((ST)u > (ST)v ? u : v); break; \
+    case EW_MULH:   EW_SCALAR(((int64_t)(ST)u * (ST)v) >> bits); break; \
+    case EW_MULHU:  EW_SCALAR(((uint64_t)u * v) >> bits); break; \
+    case EW_MULHSU: EW_SCALAR(((int64_t)(ST)u * (int64_t)v) >> bits); break; \
+    case EW_MACC:   EW_SCALAR((uint32_t)u * v + d[i]); break; \
+    case EW_MERGE: \
+      for (int i = 0; i < vl; i ++) d[i] = (vmask(i) ? (b ? b[i] : s) : a[i]); \
+      break; \
+    default: panic("unknown vector operation %d", op); \
+  } \
+}
+
+#define DEF_CMP(bits) \
+static void cmp##bits(int op, uint8_t *md, const void *vs2, const void *vs1, word_t x, bool vm, int vl) { \
+  typedef uint##bits##_t T; \
+  typedef int##bits##_t ST; \
+  T s = x; \
+  const T *a = vs2, *b = vs1; \
+  for (int i = 0; i < vl; i ++) { \
+    if (!vm && !vmask(i)) continue; \
+    T u = a[i], v = (b ? b[i] : s); \
+    bool r; \
+    switch (op) { \
+      case CMP_EQ:  r = u == v; break; \
+      case CMP_NE:  r = u != v; break; \
+      case CMP_LTU: r = u < v; break; \
+      case CMP_LT:  r = (ST)u < (ST)v; break; \
+      case CMP_LEU: r = u <= v; break; \
+      case CMP_LE:  r = (ST)u <= (ST)v; break; \
+      case CMP_GTU: r = u > v; break; \
+      case CMP_GT:  r = (ST)u > (ST)v; break; \
+      default: panic("unknown vector comparison %d", op); \
+    } \
+    md[i >> 3] = (md[i >> 3] & ~(1 << (i & 7))) | (r << (i & 7)); \
+  } \
+}
+
+#define RED_LOOP(expr) do { \
+  for (int i = 0; i < vl; i ++) { \
+    if (!vm && !vmask(i)) continue; \
+    T u = a[i]; \
+    acc = (expr); \
+  } \
+} while (0)
+
+// vd[0] = op(vs1[0], vs2[*]), vd is untouched if vl is 0
+#define DEF_RED(bits) \
+static void red##bits(int op, void *vd, const void *vs2, const void *vs1, bool vm, int vl) { \
+  typedef uint##bits##_t T; \
+  typedef int##bits##_t ST; \
+  const T *a = vs2; \
+  T acc = *(const T *)vs1; \
+  if (vl == 0) return; \
+  switch (op) { \
+    case EW_ADD:  RED_LOOP(acc + u); break; \
+    case EW_AND:  RED_LOOP(acc & u); break; \
+    case EW_OR:   RED_LOOP(acc | u); break; \
+    case EW_XOR:  RED_LOOP(acc ^ u); break; \
+    case EW_MINU: RED_LOOP(u < acc ? u : acc); break; \
+    case EW_MIN:  RED_LOOP((ST)u < (ST)acc ? u : acc); break; \
+    case EW_MAXU: RED_LOOP(u > acc ? u : acc); break; \
+    case EW_MAX:  RED_LOOP((ST)u > (ST)acc ? u : acc); break; \
+    default: panic("unknown vector reduction %d", op); \
+  } \
+  *(T *)vd = acc; \
+}
+
+DEF_EW(8) DEF_EW(16) DEF_EW(32)
+DEF_CMP(8) DEF_CMP(16) DEF_CMP(32)
+DEF_RED(8) DEF_RED(16) DEF_RED(32)
+
+static void (*const ew_fn[])(int, void *, const void *, const void *, word_t, bool, int) = { ew8, ew16, ew32 };
+static void (*const cmp_fn[])(int, uint8_t *, const void *, const void *, word_t, bool, int) = { cmp8, cmp16, cmp32 };
+static void (*const red_fn[])(int, void *, const void *, const void *, bool, int) = { red8, red16, red32 };
+
+enum { K_NONE, K_EW, K_CMP, K_RED, K_MV_S_X, K_VID };
+enum { F_VV = 1, F_VI = 2, F_VX = 4, F_IVX = F_VV | F_VX, F_ALL = F_VV | F_VI | F_VX };
+
+typedef struct {
+  uint8_t kind, op, forms;
+} VecOp;
+
+// indexed by funct6, OPIVV, OPIVI and OPIVX
+static const VecOp opi[64] = {
+  [0x00] = { K_EW,  EW_ADD,   F_ALL },
+  [0x02] = { K_EW,  EW_SUB,   F_IVX },
+  [0x03] = { K_EW,  EW_RSUB,  F_VI | F_VX },
+  [0x04] = { K_EW,  EW_MINU,  F_IVX },
+  [0x05] = { K_EW,  EW_MIN,   F_IVX },
+  [0x06] = { K_EW,  EW_MAXU,  F_IVX },
+  [0x07] = { K_EW,  EW_MAX,   F_IVX },
+  [0x09] = { K_EW,  EW_AND,   F_ALL },
+  [0x0a] = { K_EW,  EW_OR,    F_ALL },
+  [0x0b] = { K_EW,  EW_XOR,   F_ALL },
+  [0x17] = { K_EW,  EW_MERGE, F_ALL }, // also vmv.v.*
+  [0x18] = { K_CMP, CMP_EQ,   F_ALL },
+  [0x19] = { K_CMP, CMP_NE,   F_ALL },
+  [0x1a] = { K_CMP, CMP_LTU,  F_IVX },
+  [0x1b] = { K_CMP, CMP_LT,   F_IVX },
+  [0x1c] = { K_CMP, CMP_LEU,  F_ALL },
+  [0x1d] = { K_CMP, CMP_LE,   F_ALL },
+  [0x1e] = { K_CMP, CMP_GTU,  F_VI | F_VX },
+  [0x1f] = { K_CMP, CMP_GT,   F_VI | F_VX },
+  [0x25] = { K_EW,  EW_SLL,   F_ALL },
+  [0x28] = { K_EW,  EW_SRL,   F_ALL },
+  [0x29] = { K_EW,  EW_SRA,   F_ALL },
+};
+
+// indexed by funct6, OPMVV and OPMVX
+static const VecOp opm[64] = {
+  [0x00] = { K_RED, EW_ADD,    F_VV },
+  [0x01] = { K_RED, EW_AND,    F_VV },
+  [0x02] = { K_RED, EW_OR,     F_VV },
+  [0x03] = { K_RED, EW_XOR,    F_VV },
+  [0x04] = { K_RED, EW_MINU,   F_VV },
+  [0x05] = { K_RED, EW_MIN,    F_VV },
+  [0x06] = { K_RED, EW_MAXU,   F_VV },
+  [0x07] = { K_RED, EW_MAX,    F_VV },
+  [0x10] = { K_MV_S_X, 0,      F_VX },
+  [0x14] = { K_VID, 0,         F_VV },
+  [0x24] = { K_EW,  EW_MULHU,  F_IVX },
+  [0x25] = { K_EW,  EW_MUL,    F_IVX },
+  [0x26] = { K_EW,  EW_MULHSU, F_IVX },
+  [0x27] = { K_EW,  EW_MULH,   F_IVX },
+  [0x2d] = { K_EW,  EW_MACC,   F_IVX },
+};
+
+static inline bool is_shift(int op) {
+  return op == EW_SLL || op == EW_SRL || op == EW_SRA;
+}
+
+bool vec_op(uint32_t inst, word_t x) {
+  int funct6 = BITS(inst, 31, 26), vs2 = BITS(inst, 24, 20), vs1 = BITS(inst, 19, 15);
+  int funct3 = BITS(inst, 14, 12), vd = BITS(inst, 11, 7);
+  bool vm = BITS(inst, 25, 25);
+  const VecOp *e;
+  int form;
+  switch (funct3) {
+    case 0: e = &opi[funct6]; form = F_VV; break;
+    case 3: e = &opi[funct6]; form = F_VI; break;
+    case 4: e = &opi[funct6]; form = F_VX; break;
+    case 2: e = &opm[funct6]; form = F_VV; break;
+    case 6: e = &opm[funct6]; form = F_VX; break;
+    default: return false; // floating point
+  }
+  if (!(e->forms & form)) return false;
+  int sew, lmul;
+  if (!vtype_decode(cpu.csr.vtype, &sew, &lmul)) return false;
+
+  int op = e->op, vl = cpu.csr.vl;
+  if (form == F_VI) x = (is_shift(op) ? vs1 : SEXT(vs1, 5));
+  const void *src1 = (form == F_VV ? VR(vs1) : NULL);
+  bool vs1_ok = (form != F_VV || vreg_ok(vs1, lmul));
+
+  switch (e->kind) {
+    case K_EW:
+      if (!vreg_ok(vd, lmul) || !vreg_ok(vs2, lmul) || !vs1_ok) return false;
+      if (op == EW_MERGE && vm) { // vmv.v.*
+        if (vs2 != 0) return false;
+        op = EW_MV;
+      }
+      if (!vm && vd == 0) return false;
+      ew_fn[sew](op, VR(vd), VR(vs2), src1, x, vm, vl);
+      break;
+    case K_CMP:
+      if (!vreg_ok(vs2, lmul) || !vs1_ok) return false;
+      cmp_fn[sew](op, VR(vd), VR(vs2), src1, x, vm, vl);
+      break;
+    case K_RED:
+      if (!vreg_ok(vs2, lmul)) return false;
+      red_fn[sew](op, VR(vd), VR(vs2), src1, vm, vl);
+      break;
+    case K_MV_S_X:
+      if (vs2 != 0 || !vm) return false;
+      if (vl > 0) host_write(VR(vd), 1 << sew, x);
+      break;
+    case K_VID:
+      if (vs1 != 0x11 || vs2 != 0 || !vreg_ok(vd, lmul) || (!vm && vd == 0)) return false;
+      for (int i = 0; i < vl; i ++) {
+        if (vm || vmask(i)) host_write(VR(vd) + (i << sew), 1 << sew, i);
+      }
+      break;
+    default: return false;
+  }
+  cpu.csr.vstart = 0;
+  return true;
+}
+
+bool vec_mv_x_s(int vs2, word_t *x) {
+  int sew, lmul;
+  if (!vtype_decode(cpu.csr.vtype, &sew, &lmul)) return false;
+  word_t v = host_read(VR(vs2), 1 << sew);
+  *x = (sew == 0 ? (word_t)(int8_t)v : sew == 1 ? (word_t)(int16_t)v : v);
+  cpu.csr.vstart = 0;
+  return true;
+}
+#endif
@@ -0,0 +1,83 @@
+/***************************************************************************************
+* Copyright (c) 2014-2022 Zihao Yu, Nanjing University
+*
+* NEMU is licensed under Mulan PSL v2.
+* You can use this software according to the terms and conditions of the Mulan PSL v2.
+* You may obtain a copy of Mulan PSL v2 at:
+*          http://license.coscl.org.cn/MulanPSL2
+*
+* THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+* EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+* MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+*
+* See the Mulan PSL v2 for more details.
+***************************************************************************************/
+
+#include <memory/host.h>
+#include <memory/paddr.h>
+#include <memory/memhash.h>
+#include <machine.h>
+
+#ifdef CONFIG_MEMHASH
+
+/* The hash of a page is the XOR of the hashes of all its words, and the
+ * hash of a word depends on both its address and its value. Therefore a
+ * store only needs to update the hash of the words it modifies, and two
+ * copies of memory can be compared page by page with the hashes. Every
+ * machine keeps the hashes of its own pmem.
+ */
+
+static inline uint64_t word_hash(paddr_t addr, uint32_t val) {
+  // the finalizer of splitmix64
+  uint64_t x = ((uint64_t)addr << 32) | val;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+static void rehash() {
+  typeof(machine->memhash) *m = &machine->memhash;
+  m->total = 0;
+  for (int i = 0; i < MEMHASH_NR_PAGE; i ++) {
+    paddr_t base = CONFIG_MBASE + ((paddr_t)i << MEMHASH_PAGE_SHIFT);
+    uint32_t *p = (uint32_t *)guest_to_host(base);
+    uint64_t h = 0;
+    for (int j = 0; j < MEMHASH_PAGE_SIZE / 4; j ++) {
+      h ^= word_hash(base + j * 4, p[j]);
+    }
+    m->page[i] = h;
+    m->total ^= h;
+  }
+  m->valid = true;
+}
+
+void memhash_store(paddr_t addr, int len, word_t data) {
+  typeof(machine->memhash) *m = &machine->memhash;
+  if (!m->valid) return;
+  paddr_t base = addr & ~(paddr_t)3;
+  int nr_word = ((addr + len - 1 - base) >> 2) + 1;
+  uint32_t old[3], new[3];
+  assert(nr_word <= ARRLEN(old));
+  memcpy(old, guest_to_host(base), nr_word * 4);
+  memcpy(new, old, nr_word * 4);
+  memcpy((uint8_t *)new + (addr - base), &data, len);
+  for (int i = 0; i < nr_word; i ++) {
+    if (old[i] == new[i]) continue;
+    paddr_t a = base + i * 4;
+    uint64_t diff = word_hash(a, old[i]) ^ word_hash(a, new[i]);
+    m->page[(a - CONFIG_MBASE) >> MEMHASH_PAGE_SHIFT] ^= diff;
+    m->total ^= diff;
+  }
+}
+
+void memhash_invalidate() {
+  machine->memhash.valid = false;
+}
+
+uint64_t memhash(int page) {
+  // the hashes are computed lazily, since the image is loaded without paddr_write()
+  if (!machine->memhash.valid) rehash();
+  return (page < 0 ? machine->memhash.total : machine->memhash.page[page]);
+}
+
+#endif
@@ -17,49 +17,186 @@
 #include <memory/paddr.h>
 #include <device/mmio.h>
 #include <isa.h>
+#include <cpu/watchpoint.h>
+#include <cpu/difftest.h>
+#include <memory/memhash.h>
 
-#if   defined(CONFIG_PMEM_MALLOC) // 如果定义了 CONFIG_PMEM_MALLOC 这个宏，表示使用动态分配的方式管理物理内存
-static uint8_t *pmem = NULL; // 定义一个静态的字节指针，用于指向物理内存的起始地址，初始为 NULL
-#else // CONFIG_PMEM_GARRAY // 否则，表示使用静态数组的方式管理物理内存
-static uint8_t pmem[CONFIG_MSIZE] PG_ALIGN = {}; // 定义一个静态的字节数组，用于存放物理内存的内容，大小为 CONFIG_MSIZE，表示物理内存的大小，对齐为 PG_ALIGN，表示页对齐
+#ifdef CONFIG_PMEM_GARRAY // 使用静态数组的方式管理物理内存时，只有默认的机器使用这个数组，其它机器的物理内存总是动态分配
+static uint8_t pmem_garray[CONFIG_MSIZE] PG_ALIGN = {}; // 定义一个静态的字节数组，用于存放物理内存的内容，大小为 CONFIG_MSIZE，表示物理内存的大小，对齐为 PG_ALIGN，表示页对齐
 #endif
+#define pmem (machine->pmem) // 物理内存的起始地址属于当前模拟的机器
 
 uint8_t* guest_to_host(paddr_t paddr) { return pmem + paddr - CONFIG_MBASE; } // 定义一个函数，用于把物理地址转换为主机地址，参数是一个物理地址，返回值是一个字节指针，计算方法是物理内存的起始地址加上物理地址减去 CONFIG_MBASE，表示物理内存的基址
 paddr_t host_to_guest(uint8_t *haddr) { return haddr - pmem + CONFIG_MBASE; } // 定义一个函数，用于把主机地址转换为物理地址，参数是一个字节指针，返回值是一个物理地址，计算方法是主机地址减去物理内存的起始地址加上 CONFIG_MBASE，表示物理内存的基址
 
+void pmem_share(uint8_t *buf) { // 使用外部提供的内存作为物理内存，例如差分测试中 DUT 的内存
+  free(machine->pmem_alloc);
+  machine->pmem_alloc = NULL;
+  pmem = buf;
+  memhash_invalidate();
+}
+
+static inline void mark_dirty(paddr_t addr) { // 在脏页位图中记录被写过的页面
+  uint32_t page = (addr - CONFIG_MBASE) >> PMEM_DIRTY_SHIFT;
+  uint64_t *w = &machine->pmem_dirty[page / 64], bit = 1ull << (page % 64);
+  // 页面通常早已是脏的，先读一次可以避免写；并行执行的 hart 会同时修改同一个字，需要原子操作
+  if (!(__atomic_load_n(w, __ATOMIC_RELAXED) & bit)) __atomic_or_fetch(w, bit, __ATOMIC_RELAXED);
+}
+
+void pmem_set_dirty(paddr_t addr, size_t len) {
+  if (len == 0) return;
+  for (paddr_t a = addr & ~BITMASK(PMEM_DIRTY_SHIFT); a <= addr + len - 1; a += 1u << PMEM_DIRTY_SHIFT) {
+    mark_dirty(a);
+  }
+}
+
+void pmem_reset() { // 只把写过的页面恢复为初始的内容，而不是整个物理内存
+  for (int i = 0; i < NR_PMEM_DIRTY; i ++) {
+    uint64_t w = machine->pmem_dirty[i];
+    machine->pmem_dirty[i] = 0;
+    for (; w != 0; w &= w - 1) {
+      paddr_t off = (paddr_t)(i * 64 + __builtin_ctzll(w)) << PMEM_DIRTY_SHIFT;
+      memset(pmem + off, machine->pmem_fill, 1u << PMEM_DIRTY_SHIFT);
+    }
+  }
+  memhash_invalidate();
+}
+
 static word_t pmem_read(paddr_t addr, int len) { // 定义一个静态函数，用于从物理内存中读取数据，参数是一个物理地址和一个整数，表示读取的长度
   word_t ret = host_read(guest_to_host(addr), len); // 定义一个无符号的 64 位整数，用于存放读取的数据，调用 host_read 函数，传递主机地址和读取的长度，从主机内存中读取数据
   return ret; // 返回读取的数据
 }
 
+static inline void pmem_before_store(paddr_t addr, int len, word_t data) { // 在 data 写入物理内存之前调用
+  wp_store(addr, len); // 通知监视点有写操作发生
+  difftest_log_store(addr, len); // 批量差分测试时记录旧数据，用于回滚参考模型
+  memhash_store(addr, len, data); // 增量更新物理内存的哈希值
+  mark_dirty(addr); mark_dirty(addr + len - 1); // 记录脏页，非对齐的访问可能跨页
+}
+
 static void pmem_write(paddr_t addr, int len, word_t data) { // 定义一个静态函数，用于向物理内存中写入数据，参数是一个物理地址，一个整数，表示写入的长度，和一个无符号的 64 位整数，表示写入的数据
+  pmem_before_store(addr, len, data);
   host_write(guest_to_host(addr), len, data); // 调用 host_write 函数，传递主机地址，写入的长度和写入的数据，向主机内存中写入数据
 }
 
+static uint32_t amo_result(int op, uint32_t old, uint32_t src) { // 计算原子操作写回的值
+  switch (op) {
+    case AMO_SWAP: return src;
+    case AMO_ADD:  return old + src;
+    case AMO_AND:  return old & src;
+    case AMO_OR:   return old | src;
+    case AMO_XOR:  return old ^ src;
+    case AMO_MIN:  return ((int32_t)old < (int32_t)src ? old : src);
+    case AMO_MAX:  return ((int32_t)old > (int32_t)src ? old : src);
+    case AMO_MINU: return (old < src ? old : src);
+    case AMO_MAXU: return (old > src ? old : src);
+    default: panic("unknown atomic operation %d", op);
+  }
+}
+
+/* 物理内存上的原子操作直接使用宿主机的原子指令，多个 hart 在不同的线程上并行执行时仍然正确。
+ * 写操作的钩子使用操作前读到的值计算写入的值，只有一个线程访问物理内存时这个值是准确的，
+ * 多个线程并行时只有监视点和脏页记录有意义，它们不关心写入的值。
+ */
+static word_t pmem_amo(paddr_t addr, int op, word_t src) {
+  uint32_t *p = (uint32_t *)guest_to_host(addr);
+  uint32_t old = __atomic_load_n(p, __ATOMIC_RELAXED);
+  pmem_before_store(addr, 4, amo_result(op, old, src));
+  switch (op) {
+    case AMO_SWAP: return __atomic_exchange_n(p, src, __ATOMIC_SEQ_CST);
+    case AMO_ADD:  return __atomic_fetch_add(p, src, __ATOMIC_SEQ_CST);
+    case AMO_AND:  return __atomic_fetch_and(p, src, __ATOMIC_SEQ_CST);
+    case AMO_OR:   return __atomic_fetch_or (p, src, __ATOMIC_SEQ_CST);
+    case AMO_XOR:  return __atomic_fetch_xor(p, src, __ATOMIC_SEQ_CST);
+    default: // 没有对应的宿主机指令，用比较并交换实现
+      while (!__atomic_compare_exchange_n(p, &old, amo_result(op, old, src), false,
+            __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+      return old;
+  }
+}
+
+static bool pmem_cmpxchg(paddr_t addr, word_t expected, word_t desired) {
+  uint32_t *p = (uint32_t *)guest_to_host(addr);
+  uint32_t old = expected;
+  if (__atomic_load_n(p, __ATOMIC_RELAXED) == old) pmem_before_store(addr, 4, desired);
+  return __atomic_compare_exchange_n(p, &old, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
 static void out_of_bound(paddr_t addr) { // 定义一个静态函数，用于处理物理地址越界的情况，参数是一个物理地址
   panic("address = " FMT_PADDR " is out of bound of pmem [" FMT_PADDR ", " FMT_PADDR "] at pc = " FMT_WORD, // 调用 panic 函数，输出错误信息，包括物理地址，物理内存的范围，和 CPU 的 pc 寄存器的值
       addr, PMEM_LEFT, PMEM_RIGHT, cpu.pc);
 }
 
 void init_mem() { // 定义一个函数，用于初始化物理内存
-#if   defined(CONFIG_PMEM_MALLOC) // 如果定义了 CONFIG_PMEM_MALLOC 这个宏，表示使用动态分配的方式管理物理内存
-  pmem = malloc(CONFIG_MSIZE); // 调用 malloc 函数，分配 CONFIG_MSIZE 大小的内存空间，把返回的指针赋值给 pmem
-  assert(pmem); // 调用 assert 函数，断言 pmem 不为 NULL，否则报错
+#ifdef CONFIG_PMEM_GARRAY
+  if (machine_is_default()) pmem = pmem_garray; // 默认的机器使用静态数组
+  else
 #endif
-  IFDEF(CONFIG_MEM_RANDOM, memset(pmem, rand(), CONFIG_MSIZE)); // 如果定义了 CONFIG_MEM_RANDOM 这个宏，表示使用随机数填充物理内存，就调用 memset 函数，传递物理内存的起始地址，随机数，和物理内存的大小，把随机数复制到物理内存中
+  {
+    pmem = machine->pmem_alloc = malloc(CONFIG_MSIZE); // 调用 malloc 函数，分配 CONFIG_MSIZE 大小的内存空间，把返回的指针赋值给 pmem
+    assert(pmem); // 调用 assert 函数，断言 pmem 不为 NULL，否则报错
+  }
+  machine->pmem_fill = MUXDEF(CONFIG_MEM_RANDOM, rand(), 0); // pmem_reset() 用同一个值恢复写过的页面
+  IFDEF(CONFIG_MEM_RANDOM, memset(pmem, machine->pmem_fill, CONFIG_MSIZE)); // 如果定义了 CONFIG_MEM_RANDOM 这个宏，表示使用随机数填充物理内存，就调用 memset 函数，传递物理内存的起始地址，随机数，和物理内存的大小，把随机数复制到物理内存中
   Log("physical memory area [" FMT_PADDR ", " FMT_PADDR "]", PMEM_LEFT, PMEM_RIGHT); // 调用 Log 函数，输出物理内存的范围到日志中
 }
 
 word_t paddr_read(paddr_t addr, int len) { // 定义一个函数，用于从物理地址空间中读取数据，参数是一个物理地址和一个整数，表示读取的长度
   if (likely(in_pmem(addr))) return pmem_read(addr, len); // 如果物理地址在物理内存的范围内，就调用 pmem_read 函数，传递物理地址和读取的长度，从物理内存中读取数据，返回读取的数据
-  IFDEF(CONFIG_DEVICE, return mmio_read(addr, len)); // 如果定义了 CONFIG_DEVICE 这个宏，表示开启了设备模拟，就调用 mmio_read 函数，传递物理地址和读取的长度，从设备的内存映射中读取数据，返回读取的数据
+#if defined(CONFIG_DEVICE) || defined(CONFIG_LIBNEMU) // 如果开启了设备模拟，或者由 libnemu 的使用者提供设备
+  return mmio_read(addr, len); // 就调用 mmio_read 函数，传递物理地址和读取的长度，从设备的内存映射中读取数据，返回读取的数据
+#endif
   out_of_bound(addr); // 如果物理地址既不在物理内存的范围内，也不在设备的内存映射中，就调用 out_of_bound 函数，处理物理地址越界的情况
   return 0; // 返回 0，表示无效的数据
 }
 
 void paddr_write(paddr_t addr, int len, word_t data) { // 定义一个函数，用于向物理地址空间中写入数据，参数是一个物理地址，一个整数，表示写入的长度，和一个无符号的 64 位整数，表示写入的数据
   if (likely(in_pmem(addr))) { pmem_write(addr, len, data); return; } // 如果物理地址在物理内存的范围内，就调用 pmem_write 函数，传递物理地址，写入的长度和写入的数据，向物理内存中写入数据，返回函数
-  IFDEF(CONFIG_DEVICE, mmio_write(addr, len, data); return); // 如果定义了 CONFIG_DEVICE 这个宏，表示开启了设备模拟，就调用 mmio_write 函数，传递物理地址，写入的长度和写入的数据，向设备的内存映射中写入数据，返回函数
+#if defined(CONFIG_DEVICE) || defined(CONFIG_LIBNEMU) // 如果开启了设备模拟，或者由 libnemu 的使用者提供设备
+  mmio_write(addr, len, data); return; // 就调用 mmio_write 函数，传递物理地址，写入的长度和写入的数据，向设备的内存映射中写入数据，返回函数
+#endif
   out_of_bound(addr); // 如果物理地址既不在物理内存的范围内，也不在设备的内存映射中，就调用 out_of_bound 函数，处理物理地址越界的情况
 }
 
+static inline bool in_pmem_range(paddr_t addr, int len) {
+  return len > 0 && in_pmem(addr) && in_pmem(addr + len - 1);
+}
+
+bool paddr_read_block(paddr_t addr, void *buf, int len) { // 区间全部在物理内存中时整块复制
+  if (!in_pmem_range(addr, len)) return false;
+  memcpy(buf, guest_to_host(addr), len);
+  return true;
+}
+
+bool paddr_write_block(paddr_t addr, const void *buf, int len) {
+  if (!in_pmem_range(addr, len)) return false;
+  for (int i = 0; i < len; i += 4) { // 写操作的钩子仍然按字调用
+    int n = (len - i < 4 ? len - i : 4);
+    word_t data = 0;
+    memcpy(&data, (const uint8_t *)buf + i, n);
+    pmem_before_store(addr + i, n, data);
+  }
+  memcpy(guest_to_host(addr), buf, len);
+  return true;
+}
+
+static void check_atomic(paddr_t addr, int len) { // 原子操作只支持对齐的 4 字节访问，不对齐时指令已经引发了异常
+  Assert(len == 4 && addr % 4 == 0, "atomic access of %d bytes at address = " FMT_PADDR " is not supported at pc = " FMT_WORD,
+      len, addr, cpu.pc);
+}
+
+word_t paddr_amo(paddr_t addr, int len, int op, word_t src) { // 原子地读出 addr 处的值，写回对它和 src 进行操作 op 的结果，返回读出的值
+  check_atomic(addr, len);
+  if (likely(in_pmem(addr))) return pmem_amo(addr, op, src);
+  word_t old = paddr_read(addr, len); // 设备寄存器上的原子操作只需要对当前 hart 是原子的
+  paddr_write(addr, len, amo_result(op, old, src));
+  return old;
+}
+
+bool paddr_cmpxchg(paddr_t addr, int len, word_t expected, word_t desired) { // 若 addr 处的值等于 expected，就原子地写入 desired，返回是否写入
+  check_atomic(addr, len);
+  if (likely(in_pmem(addr))) return pmem_cmpxchg(addr, expected, desired);
+  if (paddr_read(addr, len) != expected) return false;
+  paddr_write(addr, len, desired);
+  return true;
+}
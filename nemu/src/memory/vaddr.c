@@ -15,17 +15,43 @@
 
 #include <isa.h>
 #include <memory/paddr.h>
+#include <cpu/timing.h>
 
 word_t vaddr_ifetch(vaddr_t addr, int len) {
   return paddr_read(addr, len);
 }
 
 word_t vaddr_read(vaddr_t addr, int len) {
- 
-
+  timing_mem(addr, false);
   return paddr_read(addr, len);
 }
 
 void vaddr_write(vaddr_t addr, int len, word_t data) {
+  timing_mem(addr, true);
   paddr_write(addr, len, data);
 }
+
+word_t vaddr_amo(vaddr_t addr, int len, int op, word_t src) {
+  timing_mem(addr, true);
+  return paddr_amo(addr, len, op, src);
+}
+
+bool vaddr_cmpxchg(vaddr_t addr, int len, word_t expected, word_t desired) {
+  timing_mem(addr, true);
+  return paddr_cmpxchg(addr, len, expected, desired);
+}
+
+// the timing model sees the first and the last bytes of a block
+bool vaddr_read_block(vaddr_t addr, void *buf, int len) {
+  if (!paddr_read_block(addr, buf, len)) return false;
+  timing_mem(addr, false);
+  timing_mem(addr + len - 1, false);
+  return true;
+}
+
+bool vaddr_write_block(vaddr_t addr, const void *buf, int len) {
+  if (!paddr_write_block(addr, buf, len)) return false;
+  timing_mem(addr, true);
+  timing_mem(addr + len - 1, true);
+  return true;
+}
@@ -0,0 +1,243 @@
+/***************************************************************************************
+* Copyright (c) 2014-2022 Zihao Yu, Nanjing University
+*
+* NEMU is licensed under Mulan PSL v2.
+* You can use this software according to the terms and conditions of the Mulan PSL v2.
+* You may obtain a copy of Mulan PSL v2 at:
+*          http://license.coscl.org.cn/MulanPSL2
+*
+* THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+* EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+* MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+*
+* See the Mulan PSL v2 for more details.
+***************************************************************************************/
+
+#include <machine.h>
+#include <cpu/cpu.h>
+#include <memory/paddr.h>
+#include <memory/memhash.h>
+#include <difftest-def.h>
+#include <libnemu.h>
+
+#ifdef CONFIG_LIBNEMU
+#include <elf.h>
+
+#define IO_SPACE_USED(m) ((m)->p_space - (m)->io_space)
+
+struct nemu_snapshot {
+  Hart harts[NR_HART];
+  NEMUState state;
+  DeviceState dev;
+  uint8_t *pmem;
+  long io_size;
+  uint8_t io[];
+};
+
+static bool in_pmem_range(uint64_t paddr, size_t len) {
+  return paddr >= PMEM_LEFT && len <= CONFIG_MSIZE && paddr - PMEM_LEFT <= CONFIG_MSIZE - len;
+}
+
+// the hashes are of the machine of this thread, which may not be `m'
+static void invalidate_memhash(nemu_t *m) {
+  Machine *old = machine_switch(m);
+  memhash_invalidate();
+  machine_switch(old);
+}
+
+__EXPORT nemu_t* nemu_create() {
+  return machine_new();
+}
+
+__EXPORT void nemu_destroy(nemu_t *m) {
+  machine_free(m);
+}
+
+static long read_file(const char *file, uint8_t **buf) {
+  FILE *fp = fopen(file, "rb");
+  if (fp == NULL) return -1;
+  fseek(fp, 0, SEEK_END);
+  long size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  *buf = malloc(size);
+  assert(*buf);
+  long ret = fread(*buf, 1, size, fp);
+  fclose(fp);
+  if (ret != size) { free(*buf); return -1; }
+  return size;
+}
+
+__EXPORT long nemu_load_image(nemu_t *m, const char *file) {
+  uint8_t *buf;
+  long size = read_file(file, &buf);
+  if (size < 0) return -1;
+  int ret = nemu_mem_write(m, RESET_VECTOR, buf, size);
+  free(buf);
+  return (ret == 0 ? size : -1);
+}
+
+#define Elf_Ehdr MUXDEF(CONFIG_ISA64, Elf64_Ehdr, Elf32_Ehdr)
+#define Elf_Phdr MUXDEF(CONFIG_ISA64, Elf64_Phdr, Elf32_Phdr)
+
+static long load_elf(nemu_t *m, uint8_t *buf, long size) {
+  Elf_Ehdr *eh = (Elf_Ehdr *)buf;
+  if (size < sizeof(*eh) || memcmp(eh->e_ident, ELFMAG, SELFMAG) != 0 ||
+      eh->e_ident[EI_CLASS] != MUXDEF(CONFIG_ISA64, ELFCLASS64, ELFCLASS32) ||
+      eh->e_phentsize != sizeof(Elf_Phdr) ||
+      eh->e_phoff + (uint64_t)eh->e_phnum * sizeof(Elf_Phdr) > size) {
+    return -1;
+  }
+
+  long loaded = 0;
+  Elf_Phdr *ph = (Elf_Phdr *)(buf + eh->e_phoff);
+  for (int i = 0; i < eh->e_phnum; i ++) {
+    if (ph[i].p_type != PT_LOAD) continue;
+    if (ph[i].p_filesz > ph[i].p_memsz || ph[i].p_offset + ph[i].p_filesz > size ||
+        !in_pmem_range(ph[i].p_paddr, ph[i].p_memsz)) {
+      return -1;
+    }
+    uint8_t *p = m->pmem + ph[i].p_paddr - CONFIG_MBASE;
+    memcpy(p, buf + ph[i].p_offset, ph[i].p_filesz);
+    memset(p + ph[i].p_filesz, 0, ph[i].p_memsz - ph[i].p_filesz);
+    loaded += ph[i].p_memsz;
+  }
+  for (int i = 0; i < NR_HART; i ++) m->harts[i].state.pc = eh->e_entry;
+  invalidate_memhash(m);
+  return loaded;
+}
+
+__EXPORT long nemu_load_elf(nemu_t *m, const char *file) {
+  uint8_t *buf;
+  long size = read_file(file, &buf);
+  if (size < 0) return -1;
+  long ret = load_elf(m, buf, size);
+  free(buf);
+  return ret;
+}
+
+__EXPORT int nemu_run(nemu_t *m, uint64_t n) {
+  switch (m->state.state) {
+    case NEMU_END: case NEMU_QUIT: return NEMU_EVENT_END;
+    case NEMU_ABORT: return NEMU_EVENT_ABORT;
+  }
+  if (n == 0) return NEMU_EVENT_BUDGET;
+
+  Machine *old = machine_switch(m);
+  uint64_t start = g_nr_guest_inst;
+  cpu_exec(n);
+  uint64_t executed = g_nr_guest_inst - start;
+  machine_switch(old);
+
+  switch (m->state.state) {
+    case NEMU_END: case NEMU_QUIT: return NEMU_EVENT_END;
+    case NEMU_ABORT: return NEMU_EVENT_ABORT;
+    default: return (executed < n ? NEMU_EVENT_STOP : NEMU_EVENT_BUDGET);
+  }
+}
+
+// the harts only look at the state when they reach their deadlines
+__EXPORT void nemu_stop(nemu_t *m) {
+  if (m->state.state == NEMU_RUNNING) {
+    m->state.state = NEMU_STOP;
+    machine_kick(m);
+  }
+}
+
+__EXPORT int nemu_exit_code(nemu_t *m) {
+  return m->state.halt_ret;
+}
+
+__EXPORT uint64_t nemu_inst_count(nemu_t *m) {
+  return machine_inst_count(m);
+}
+
+__EXPORT int nemu_reg_index(const char *name) {
+  if (strcmp(name, "pc") == 0) return NEMU_REG_PC;
+  int idx = isa_reg_str2idx(name);
+  return (idx == -1 ? -2 : idx);
+}
+
+__EXPORT uint64_t nemu_reg_read(nemu_t *m, int idx) {
+  CPU_state *c = &m->harts[0].state;
+  if (idx == NEMU_REG_PC) return c->pc;
+  assert(idx >= 0 && idx < ARRLEN(c->gpr));
+  return c->gpr[idx];
+}
+
+__EXPORT void nemu_reg_write(nemu_t *m, int idx, uint64_t val) {
+  CPU_state *c = &m->harts[0].state;
+  if (idx == NEMU_REG_PC) { c->pc = val; return; }
+  assert(idx >= 0 && idx < ARRLEN(c->gpr));
+  if (idx != 0) c->gpr[idx] = val;
+}
+
+__EXPORT int nemu_mem_read(nemu_t *m, uint64_t paddr, void *buf, size_t len) {
+  if (!in_pmem_range(paddr, len)) return -1;
+  memcpy(buf, m->pmem + paddr - CONFIG_MBASE, len);
+  return 0;
+}
+
+__EXPORT int nemu_mem_write(nemu_t *m, uint64_t paddr, const void *buf, size_t len) {
+  if (!in_pmem_range(paddr, len)) return -1;
+  memcpy(m->pmem + paddr - CONFIG_MBASE, buf, len);
+  invalidate_memhash(m);
+  return 0;
+}
+
+__EXPORT int nemu_add_mmio(nemu_t *m, const char *name, uint64_t paddr, uint32_t len,
+    nemu_mmio_callback_t callback, void *opaque) {
+  if (m->nr_mmio_map >= NR_MAP || len == 0) return -1;
+  Machine *old = machine_switch(m);
+  add_mmio_map_ext(name, paddr, len, callback, opaque);
+  machine_switch(old);
+  return 0;
+}
+
+// the pointers in the device state are to the spaces and files of its own
+// machine, they are kept when the state of another machine is restored
+static void restore_device(DeviceState *dst, const DeviceState *src) {
+  DeviceState d = *src;
+  d.serial_base = dst->serial_base;
+  d.rtc_port_base = dst->rtc_port_base;
+  d.vmem = dst->vmem;
+  d.vgactl_port_base = dst->vgactl_port_base;
+  d.i8042_data_port_base = dst->i8042_data_port_base;
+  d.sbuf = dst->sbuf;
+  d.audio_base = dst->audio_base;
+  d.clint.base = dst->clint.base;
+  d.sdcard.fp = dst->sdcard.fp;
+  d.sdcard.base = dst->sdcard.base;
+  *dst = d;
+}
+
+__EXPORT nemu_snapshot_t* nemu_snapshot(nemu_t *m) {
+  long io_size = IO_SPACE_USED(m);
+  nemu_snapshot_t *s = malloc(sizeof(*s) + io_size);
+  assert(s);
+  memcpy(s->harts, m->harts, sizeof(s->harts));
+  s->state = m->state;
+  s->dev = m->dev;
+  s->pmem = malloc(CONFIG_MSIZE);
+  assert(s->pmem);
+  memcpy(s->pmem, m->pmem, CONFIG_MSIZE);
+  s->io_size = io_size;
+  memcpy(s->io, m->io_space, io_size);
+  return s;
+}
+
+__EXPORT void nemu_restore(nemu_t *m, const nemu_snapshot_t *s) {
+  memcpy(m->harts, s->harts, sizeof(m->harts));
+  m->state = s->state;
+  restore_device(&m->dev, &s->dev);
+  memcpy(m->pmem, s->pmem, CONFIG_MSIZE);
+  assert(s->io_size == IO_SPACE_USED(m));
+  memcpy(m->io_space, s->io, s->io_size);
+  invalidate_memhash(m);
+}
+
+__EXPORT void nemu_snapshot_free(nemu_snapshot_t *s) {
+  free(s->pmem);
+  free(s);
+}
+
+#endif
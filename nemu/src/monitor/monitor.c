@@ -40,11 +40,15 @@ static void welcome() {
 #include <getopt.h>
 
 void sdb_set_batch_mode();
+void set_image_list(const char *list, int jobs, const char *json);
 
 static char *log_file = NULL;
 static char *diff_so_file = NULL;
 static char *img_file = NULL;
 static int difftest_port = 1234;
+static char *list_file = NULL;
+static char *json_file = NULL;
+static int nr_job = 1;
 
 static long load_img() {
   if (img_file == NULL) {
@@ -74,16 +78,22 @@ static int parse_args(int argc, char *argv[]) {
     {"log"      , required_argument, NULL, 'l'},
     {"diff"     , required_argument, NULL, 'd'},
     {"port"     , required_argument, NULL, 'p'},
+    {"list"     , required_argument, NULL, 'L'},
+    {"jobs"     , required_argument, NULL, 'j'},
+    {"json"     , required_argument, NULL, 'J'},
     {"help"     , no_argument      , NULL, 'h'},
     {0          , 0                , NULL,  0 },
   };
   int o;
-  while ( (o = getopt_long(argc, argv, "-bhl:d:p:", table, NULL)) != -1) {
+  while ( (o = getopt_long(argc, argv, "-bhl:d:p:L:j:J:", table, NULL)) != -1) {
     switch (o) {
       case 'b': sdb_set_batch_mode(); break;
       case 'p': sscanf(optarg, "%d", &difftest_port); break;
       case 'l': log_file = optarg; break;
       case 'd': diff_so_file = optarg; break;
+      case 'L': list_file = optarg; break;
+      case 'j': sscanf(optarg, "%d", &nr_job); break;
+      case 'J': json_file = optarg; break;
       case 1: img_file = optarg; return 0;
       default:
         printf("Usage: %s [OPTION...] IMAGE [args]\n\n", argv[0]);
@@ -91,6 +101,9 @@ static int parse_args(int argc, char *argv[]) {
         printf("\t-l,--log=FILE           output log to FILE\n");
         printf("\t-d,--diff=REF_SO        run DiffTest with reference REF_SO\n");
         printf("\t-p,--port=PORT          run DiffTest with port PORT\n");
+        printf("\t-L,--list=FILE          run the images listed in FILE, one per line\n");
+        printf("\t-j,--jobs=N             run the listed images with N threads, 0 for all cores\n");
+        printf("\t-J,--json=FILE          write the report of the listed images to FILE\n");
         printf("\n");
         exit(0);
     }
@@ -104,6 +117,12 @@ void init_monitor(int argc, char *argv[]) {
   /* Parse arguments. */
   parse_args(argc, argv);
 
+  /* Run the images in the list file instead of a single image. */
+  if (list_file != NULL) {
+    Assert(!ISDEF(CONFIG_DIFFTEST), "--list does not work with DiffTest");
+    set_image_list(list_file, nr_job, json_file);
+  }
+
   /* Set random seed. */
   init_rand();
 
@@ -0,0 +1,186 @@
+/***************************************************************************************
+* Copyright (c) 2014-2022 Zihao Yu, Nanjing University
+*
+* NEMU is licensed under Mulan PSL v2.
+* You can use this software according to the terms and conditions of the Mulan PSL v2.
+* You may obtain a copy of Mulan PSL v2 at:
+*          http://license.coscl.org.cn/MulanPSL2
+*
+* THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+* EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+* MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+*
+* See the Mulan PSL v2 for more details.
+***************************************************************************************/
+
+#include <machine.h>
+#include <cpu/cpu.h>
+#include <memory/paddr.h>
+#include <cpu/bpred.h>
+#include <cpu/timing.h>
+
+#ifndef CONFIG_TARGET_AM
+#include <pthread.h>
+#include <unistd.h>
+
+/* Run the images in a list file back to back in this process, which is
+ * much cheaper than starting NEMU for every image. Every host thread
+ * takes images from the list and runs them on its own machine, which is
+ * reset between images. The performance models are shared by all machines,
+ * so with them the images run one by one, and the models are reset too. At the end the images which do not pass are
+ * logged, and a report in JSON is written to the file given by --json,
+ * so that it is never mixed with the log.
+ */
+
+typedef struct {
+  char *image;
+  const char *result;
+  int exit_code;
+  uint64_t nr_inst;
+  uint64_t time; // unit: us
+} Result;
+
+#define MODELS (ISDEF(CONFIG_BPRED) || ISDEF(CONFIG_TIMING))
+
+static const char *list_file = NULL;
+static const char *json_file = NULL;
+static int nr_job = 1;
+static Result *results = NULL;
+static int nr_image = 0;
+static int next_image = 0;
+
+void set_image_list(const char *list, int jobs, const char *json) {
+  list_file = list;
+  json_file = json;
+  nr_job = (jobs > 0 ? jobs : MODELS ? 1 : sysconf(_SC_NPROCESSORS_ONLN));
+}
+
+static void read_list() {
+  FILE *fp = fopen(list_file, "r");
+  Assert(fp, "Can not open '%s'", list_file);
+  char line[4096];
+  int size = 0;
+  while (fgets(line, sizeof(line), fp)) {
+    char *p = line + strspn(line, " \t");
+    char *q = p + strlen(p);
+    while (q > p && strchr(" \t\r\n", q[-1])) q --;
+    *q = '\0';
+    if (*p == '\0' || *p == '#') continue;
+    if (nr_image == size) {
+      size = (size == 0 ? 64 : size * 2);
+      results = realloc(results, sizeof(Result) * size);
+      assert(results);
+    }
+    results[nr_image ++] = (Result){ .image = strdup(p), .result = "error" };
+  }
+  fclose(fp);
+}
+
+static long load_image(const char *file) {
+  FILE *fp = fopen(file, "rb");
+  if (fp == NULL) return -1;
+  fseek(fp, 0, SEEK_END);
+  long size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  int ret = 0;
+  if (size <= CONFIG_MSIZE - CONFIG_PC_RESET_OFFSET) {
+    ret = fread(guest_to_host(RESET_VECTOR), size, 1, fp);
+    pmem_set_dirty(RESET_VECTOR, size);
+  }
+  fclose(fp);
+  return (ret == 1 ? size : -1);
+}
+
+static void run_image(Result *r) {
+  machine_reset();
+  bpred_reset();
+  IFDEF(CONFIG_TIMING, timing_reset());
+  if (load_image(r->image) < 0) return;
+
+  cpu_exec(-1);
+
+  r->nr_inst = machine_inst_count(machine);
+  r->time = machine->timer;
+  switch (nemu_state.state) {
+    case NEMU_END:
+      r->exit_code = nemu_state.halt_ret;
+      r->result = (r->exit_code == 0 ? "pass" : "fail");
+      break;
+    case NEMU_ABORT: r->result = "abort"; break;
+  }
+}
+
+static void* worker(void *arg) {
+  Machine *m = machine_new();
+  machine_switch(m);
+  int i;
+  while ((i = __atomic_fetch_add(&next_image, 1, __ATOMIC_RELAXED)) < nr_image) {
+    run_image(&results[i]);
+  }
+  machine_switch(&default_machine);
+  machine_free(m);
+  return NULL;
+}
+
+static void json_str(FILE *fp, const char *s) {
+  fputc('"', fp);
+  for (; *s; s ++) {
+    if (*s == '"' || *s == '\\') fprintf(fp, "\\%c", *s);
+    else if ((unsigned char)*s < 0x20) fprintf(fp, "\\u%04x", *s);
+    else fputc(*s, fp);
+  }
+  fputc('"', fp);
+}
+
+static void write_json(uint64_t time, int nr_pass) {
+  FILE *fp = fopen(json_file, "w");
+  Assert(fp, "Can not open '%s'", json_file);
+  fprintf(fp, "{\n  \"jobs\": %d,\n  \"time_us\": %" PRIu64 ",\n", nr_job, time);
+  fprintf(fp, "  \"passed\": %d,\n  \"failed\": %d,\n  \"images\": [", nr_pass, nr_image - nr_pass);
+  for (int i = 0; i < nr_image; i ++) {
+    Result *r = &results[i];
+    fprintf(fp, "%s\n    {\"image\": ", (i == 0 ? "" : ","));
+    json_str(fp, r->image);
+    fprintf(fp, ", \"result\": \"%s\", \"exit_code\": %d, \"insts\": %" PRIu64
+        ", \"time_us\": %" PRIu64 ", \"mips\": %.2f}", r->result, r->exit_code,
+        r->nr_inst, r->time, (r->time == 0 ? 0.0 : (double)r->nr_inst / r->time));
+  }
+  fprintf(fp, "\n  ]\n}\n");
+  fclose(fp);
+}
+
+static int report(uint64_t time) {
+  int nr_pass = 0;
+  for (int i = 0; i < nr_image; i ++) {
+    Result *r = &results[i];
+    if (strcmp(r->result, "pass") == 0) nr_pass ++;
+    else Log("%s: %s", r->image, r->result);
+  }
+  Log("%d of %d images passed in %" PRIu64 " us", nr_pass, nr_image, time);
+  if (json_file != NULL) write_json(time, nr_pass);
+  return nr_image - nr_pass;
+}
+
+// return false if no list is given
+bool run_image_list() {
+  if (list_file == NULL) return false;
+  Assert(nr_job == 1 || !MODELS, "--jobs=%d is not supported with the branch predictor or the timing model", nr_job);
+  read_list();
+  if (nr_job > nr_image) nr_job = (nr_image > 0 ? nr_image : 1);
+  Log("Run %d images with %d jobs", nr_image, nr_job);
+
+  uint64_t start = get_time();
+  pthread_t *tid = malloc(sizeof(pthread_t) * nr_job);
+  assert(tid);
+  for (int i = 0; i < nr_job; i ++) {
+    int ret = pthread_create(&tid[i], NULL, worker, NULL);
+    assert(ret == 0);
+  }
+  for (int i = 0; i < nr_job; i ++) pthread_join(tid[i], NULL);
+  free(tid);
+
+  int nr_fail = report(get_time() - start);
+  set_nemu_state(NEMU_END, cpu.pc, nr_fail != 0);
+  return true;
+}
+#endif
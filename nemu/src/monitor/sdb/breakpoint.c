@@ -0,0 +1,130 @@
+/***************************************************************************************
+* Copyright (c) 2014-2022 Zihao Yu, Nanjing University
+*
+* NEMU is licensed under Mulan PSL v2.
+* You can use this software according to the terms and conditions of the Mulan PSL v2.
+* You may obtain a copy of Mulan PSL v2 at:
+*          http://license.coscl.org.cn/MulanPSL2
+*
+* THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+* EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+* MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+*
+* See the Mulan PSL v2 for more details.
+***************************************************************************************/
+
+#include <isa.h>
+#include <cpu/breakpoint.h>
+#include "sdb.h"
+
+#define NR_BP 32
+#define HASH_BITS 6       // the hash set has at least twice of NR_BP entries
+#define HASH_SIZE (1 << HASH_BITS)
+#define FILTER_BITS 4096  // power of 2
+
+typedef struct {
+  bool used;
+  vaddr_t pc;
+  char *cond;     // NULL for unconditional breakpoints
+  ExprCode code;
+  uint64_t hit;
+} BP;
+
+static BP bp_pool[NR_BP] = {};
+int nr_bp = 0;
+
+/* The PCs of breakpoints are kept in an open addressing hash set. A bitmap
+ * indexed by the low bits of PC filters out most of the instructions before
+ * looking up the hash set.
+ */
+static BP *hash[HASH_SIZE] = {};
+static uint64_t filter[FILTER_BITS / 64] = {};
+
+static inline uint32_t hash_idx(vaddr_t pc) {
+  return ((uint32_t)pc * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static inline uint32_t filter_idx(vaddr_t pc) {
+  return (pc >> 1) & (FILTER_BITS - 1);
+}
+
+static void rebuild() {
+  memset(hash, 0, sizeof(hash));
+  memset(filter, 0, sizeof(filter));
+  nr_bp = 0;
+  for (int i = 0; i < NR_BP; i ++) {
+    BP *bp = &bp_pool[i];
+    if (!bp->used) continue;
+    uint32_t h = hash_idx(bp->pc);
+    while (hash[h] != NULL) h = (h + 1) & (HASH_SIZE - 1);
+    hash[h] = bp;
+    filter[filter_idx(bp->pc) / 64] |= 1ull << (filter_idx(bp->pc) % 64);
+    nr_bp ++;
+  }
+}
+
+static BP* lookup(vaddr_t pc) {
+  uint32_t f = filter_idx(pc);
+  if (!(filter[f / 64] & (1ull << (f % 64)))) return NULL;
+  for (uint32_t h = hash_idx(pc); hash[h] != NULL; h = (h + 1) & (HASH_SIZE - 1)) {
+    if (hash[h]->pc == pc) return hash[h];
+  }
+  return NULL;
+}
+
+void bp_check(vaddr_t pc) {
+  BP *bp = lookup(pc);
+  if (bp == NULL) return;
+  if (bp->cond != NULL) {
+    bool success;
+    word_t val = expr_run(&bp->code, &success, NULL);
+    if (success && val == 0) return;
+    if (!success) printf("Can not evaluate the condition of breakpoint %d: %s\n", (int)(bp - bp_pool), bp->cond);
+  }
+  bp->hit ++;
+  printf("\nBreakpoint %d at pc = " FMT_WORD "\n", (int)(bp - bp_pool), pc);
+  if (nemu_state.state == NEMU_RUNNING) nemu_state.state = NEMU_STOP;
+}
+
+int bp_new(vaddr_t pc, const char *cond) {
+  if (lookup(pc) != NULL) {
+    printf("Breakpoint already exists at " FMT_WORD "\n", pc);
+    return -1;
+  }
+  ExprCode code = {};
+  if (cond != NULL && !expr_compile(cond, &code)) {
+    printf("Invalid expression: %s\n", cond);
+    return -1;
+  }
+  for (int i = 0; i < NR_BP; i ++) {
+    BP *bp = &bp_pool[i];
+    if (bp->used) continue;
+    *bp = (BP) { .used = true, .pc = pc, .cond = (cond ? strdup(cond) : NULL), .code = code };
+    rebuild();
+    return i;
+  }
+  printf("Too many breakpoints\n");
+  return -1;
+}
+
+bool bp_delete(int NO) {
+  if (NO < 0 || NO >= NR_BP || !bp_pool[NO].used) return false;
+  free(bp_pool[NO].cond);
+  bp_pool[NO].cond = NULL;
+  bp_pool[NO].used = false;
+  rebuild();
+  return true;
+}
+
+void bp_display() {
+  if (nr_bp == 0) {
+    printf("No breakpoints.\n");
+    return;
+  }
+  printf("Num\tAddress\t\tHits\tCondition\n");
+  for (int i = 0; i < NR_BP; i ++) {
+    BP *bp = &bp_pool[i];
+    if (!bp->used) continue;
+    printf("%d\t" FMT_WORD "\t%" PRIu64 "\t%s\n", i, bp->pc, bp->hit, (bp->cond ? bp->cond : ""));
+  }
+}
@@ -14,6 +14,9 @@
 ***************************************************************************************/
 
 #include <isa.h>
+#include <memory/host.h>
+#include <memory/paddr.h>
+#include "sdb.h"
 
 /* We use the POSIX regex functions to process regular expressions.
  * Type 'man regex' for more information about POSIX regex functions.
@@ -164,52 +167,6 @@ static bool make_token(const char *e) {
   return true;
 }
 
-word_t eval(int p, int q, bool *success, int *position);
-
-word_t expr(const char *e, bool *success) {
-  if (!make_token(e)) {
-    *success = false;
-    return 0;
-  }
-
-  *success = true;
-  int position = 0;
-  int ans = eval(0, nr_token - 1, success, &position);
-  if (!*success){
-    printf("some problem happens at position %d\n%s\n%*.s^\n", position, e, position, "");
-  }
-  return ans;
-}
-
-#define STACK_SIZE 1024
-bool check_parentheses(int p, int q, int *position){
-  //char *stack = calloc(STACK_SIZE, sizeof(char));
-  char stack[STACK_SIZE];
-  *position = -1;
-  int top = -1, index = p;
-  bool is_parentheses = tokens[p].type == '(';
-  while (index <= q){
-    if (tokens[index].type == '('){
-      stack[++top] = '(';
-    }else if (tokens[index].type == ')'){
-      if (top < 0 || stack[top] != '('){
-        *position = p;
-        return false;
-      }else {
-        top--;
-      }
-    }
-    if (index < q)
-      is_parentheses = (top >= 0) && is_parentheses; // 永远都该有一个前括号
-    index++;
-  }
-  if (top != -1){ //栈空
-    *position = p;
-    return false;
-  }
-  return is_parentheses;
-}
-
 #define PRIOROTY_BASE 16
 
 int prio(char type){
@@ -237,99 +194,139 @@ int prio(char type){
   }
 }
 
-uint32_t eval(int p, int q, bool *success, int *position) {
-  if (p > q) {
-    *success = false;
-    return 0;
-  } else if (p == q) {
-    /* Single token.
-     * For now this token should be a number.
-     * Return the value of the number.
-     */
-    uint32_t buffer = 0;
-    switch (tokens[p].type){
-    case TK_HEX:
-      sscanf(tokens[p].str, "%x", &buffer);
-      break;
-    
-    case NUM:
-      sscanf(tokens[p].str, "%u", &buffer);
-      break;
-
-    case REG:
-      if (strcmp(tokens[p].str, "$pc") == 0){
-        buffer = cpu.pc;
-        *success = true;
-      }else {
-        buffer = isa_reg_str2val(tokens[p].str, success);
-      }
-
-      if (!*success){
-        *position = p;
-        return 0;
-      }
-      break;
+/* 表达式只编译一次，得到栈式机器的后缀字节码，之后可以运行任意多次。编译时
+ * 把寄存器解析为 `cpu.gpr' 的下标，并且计算出常量之间的运算。
+ */
+static bool calc(int op, word_t a, word_t b, word_t *res) {
+  switch (op) {
+    case OP_ADD: *res = a + b; break;
+    case OP_SUB: *res = a - b; break;
+    case OP_MUL: *res = a * b; break;
+    case OP_DIV: if (b == 0) return false; *res = a / b; break;
+    case OP_EQ: *res = (a == b); break;
+    case OP_NE: *res = (a != b); break;
+    case OP_LAND: *res = (a && b); break;
+    case OP_LOR: *res = (a || b); break;
+    default: assert(0);
+  }
+  return true;
+}
 
-    default:
-      assert(0);
-    }
-    // IFDEF(CONFIG_DEBUG, Log("读取数据 %d %s %x", buffer, tokens[p].str, tokens[p].type));
-    return buffer;
-  }else if (q - p == 1 || check_parentheses(p + 1, q, position) == true){//长度为2的子表达式呈型于 -[NUM] *[NUM]
-    switch (tokens[p].type) {
-    case TK_DEREF:
-      return *((uint32_t *)guest_to_host(eval(p + 1, q, success, position)));
-      break;
-    
-    case TK_MINUS://取负
-      return -eval(p + 1, q, success, position);
-    default:
-      assert(0);
+static bool emit(ExprCode *c, int op, word_t val) {
+  typeof(c->code[0]) *last = (c->nr > 0 ? &c->code[c->nr - 1] : NULL);
+  if (op == OP_NEG && last && last->op == OP_IMM) {
+    last->val = -last->val;
+    return true;
+  }
+  if (op >= OP_ADD && c->nr >= 2 && last->op == OP_IMM && last[-1].op == OP_IMM) {
+    word_t res;
+    // 除以零留到运行时再报告
+    if (calc(op, last[-1].val, last->val, &res)) {
+      last[-1].val = res;
+      c->nr --;
+      return true;
     }
-  } else if (check_parentheses(p, q, position) == true) {
-    /* The expression is surrounded by a matched pair of parentheses.
-     * If that is the case, just throw away the parentheses.
-     */
-    // IFDEF(CONFIG_DEBUG, Log("解括号"));
-    return eval(p + 1, q - 1, success, position);
-  } else {
-    // IFDEF(CONFIG_DEBUG, Log("计算"));
-    if (*position != -1){
-      *success = false;
-      return 0;
+  }
+  if (c->nr >= EXPR_CODE_MAX) return false;
+  c->code[c->nr].op = op;
+  c->code[c->nr].val = val;
+  c->nr ++;
+  return true;
+}
+
+static int binary_op(int type) {
+  switch (type) {
+    case '+': return OP_ADD;
+    case '-': return OP_SUB;
+    case '*': return OP_MUL;
+    case '/': return OP_DIV;
+    case TK_EQ: return OP_EQ;
+    case TK_UEQ: return OP_NE;
+    case '&': return OP_LAND;
+    case '|': return OP_LOR;
+    default: assert(0);
+  }
+}
+
+static bool gen(ExprCode *c, int p, int q) {
+  if (p > q) return false;
+
+  int op = -1, level = 0;
+  for (int i = p; i <= q; i ++) {
+    int type = tokens[i].type;
+    if (type == '(') level ++;
+    else if (type == ')') { if (-- level < 0) return false; }
+    else if (level == 0 && prio(type) >= 0 && (op == -1 || prio(type) <= prio(tokens[op].type))) op = i;
+  }
+  if (level != 0) return false;
+  if (op != -1) {
+    return gen(c, p, op - 1) && gen(c, op + 1, q) && emit(c, binary_op(tokens[op].type), 0);
+  }
+
+  switch (tokens[p].type) {
+    case TK_DEREF: c->nr_deref ++; return gen(c, p + 1, q) && emit(c, OP_DEREF, 0);
+    case TK_MINUS: return gen(c, p + 1, q) && emit(c, OP_NEG, 0);
+    case '(': return tokens[q].type == ')' && gen(c, p + 1, q - 1);
+  }
+  if (p != q) return false;
+
+  const char *str = tokens[p].str;
+  switch (tokens[p].type) {
+    case NUM: return emit(c, OP_IMM, strtoul(str, NULL, 10));
+    case TK_HEX: return emit(c, OP_IMM, strtoul(str, NULL, 16));
+    case REG: {
+      if (strcmp(str, "$pc") == 0) { c->use_pc = true; return emit(c, OP_PC, 0); }
+      // "$0" 和 "$sp" 两种写法都可以
+      int idx = isa_reg_str2idx(str);
+      if (idx < 0) idx = isa_reg_str2idx(str + 1);
+      if (idx < 0) return false;
+      c->reg_mask |= 1u << idx;
+      return emit(c, OP_REG, idx);
     }
-    int op = -1, level = -1;
-    for (int i = p; i <= q; ++i){
-      if (tokens[i].type == '('){
-        level++;
-      } else if (tokens[i].type == ')'){
-        level--;// 不再检查合法性，一定合法
-      } else if (level == -1 && prio(tokens[i].type) >= 0){//说明层次不在括号里且是运算符
-        if (op == -1 || prio(tokens[i].type) <= prio(tokens[op].type)){// 寻找主运算符
-          op = i;
-        }
-      }
+    default: return false;
+  }
+}
+
+bool expr_compile(const char *e, ExprCode *c) {
+  memset(c, 0, sizeof(*c));
+  return make_token(e) && gen(c, 0, nr_token - 1);
+}
+
+word_t expr_run(const ExprCode *c, bool *success, paddr_t *loads) {
+  word_t stack[EXPR_CODE_MAX];
+  int top = 0, nr_load = 0;
+  *success = true;
+  for (int i = 0; i < c->nr; i ++) {
+    word_t val = c->code[i].val;
+    if (c->code[i].op <= OP_PC) {
+      stack[top ++] = (c->code[i].op == OP_IMM ? val : c->code[i].op == OP_REG ? cpu.gpr[val] : cpu.pc);
+      continue;
     }
-    if (op == -1){
-      *success = false;
-      *position = 0;
-      return 0;
+    word_t *a = &stack[top - 1];
+    switch (c->code[i].op) {
+      case OP_DEREF:
+        // 只有物理内存可以无副作用地访问
+        if (!in_pmem(*a) || !in_pmem(*a + sizeof(word_t) - 1)) { *success = false; return 0; }
+        if (loads) loads[nr_load ++] = *a;
+        *a = host_read(guest_to_host(*a), sizeof(word_t));
+        continue;
+      case OP_NEG: *a = -*a; continue;
     }
+    word_t b = stack[-- top];
+    a = &stack[top - 1];
+    if (!calc(c->code[i].op, *a, b, a)) { *success = false; return 0; }
+  }
+  return stack[0];
+}
 
-    // IFDEF(CONFIG_DEBUG, Log("主运算符 %c", tokens[op].type));
-    uint32_t val1 = eval(p, op - 1, success, position);
-    uint32_t val2 = eval(op + 1, q, success, position);
-    switch (tokens[op].type) {
-      case '+': return val1 + val2;
-      case '-': return val1 - val2;
-      case '*': return val1 * val2;
-      case '/': return val1 / val2;
-      case TK_EQ: return val1 == val2;
-      case TK_UEQ: return val1 != val2;
-      case '|': return val1 || val2;
-      case '&': return val1 && val2;
-      default: assert(0);
-    }
+word_t expr(const char *e, bool *success) {
+  ExprCode c;
+  if (!expr_compile(e, &c)) {
+    printf("invalid expression: %s\n", e);
+    *success = false;
+    return 0;
   }
-  return 0;
+  word_t val = expr_run(&c, success, NULL);
+  if (!*success) printf("can not evaluate expression: %s\n", e);
+  return val;
 }
@@ -46,7 +46,9 @@ static int cmd_info(char *args){
   }else if (strcmp(args, "r") == 0){
     isa_reg_display();
   }else if (strcmp(args, "w") == 0){
-    //watchpoint_display();
+    wp_display();
+  }else if (strcmp(args, "b") == 0){
+    bp_display();
   }else {
     printf("unknown command[%s] \n", args);
   }
@@ -93,12 +95,54 @@ static int cmd_p(char *args){
 }
 
 static int cmd_w(char *args){
-  
+#ifdef CONFIG_WATCHPOINT
+  if (args == NULL) {
+    printf("w lack argvs\n");
+    return 0;
+  }
+  int NO = wp_new(args);
+  if (NO >= 0) printf("Watchpoint %d: %s\n", NO, args);
+#else
+  printf("Watchpoints are not enabled in this build\n");
+#endif
   return 0;
 }
 
-static int cmd_d(char *args){
+static int cmd_b(char *args){
+#ifdef CONFIG_BREAKPOINT
+  if (args == NULL) {
+    printf("b lack argvs\n");
+    return 0;
+  }
+  char *cond = strstr(args, " if ");
+  if (cond != NULL) {
+    *cond = '\0';
+    cond += 4;
+  }
+  bool success;
+  vaddr_t pc = expr(args, &success);
+  if (!success) return 0;
+  int NO = bp_new(pc, cond);
+  if (NO >= 0) {
+    printf("Breakpoint %d at " FMT_WORD, NO, pc);
+    if (cond != NULL) printf(" if %s", cond);
+    printf("\n");
+  }
+#else
+  printf("Breakpoints are not enabled in this build\n");
+#endif
+  return 0;
+}
 
+static int cmd_d(char *args){
+  int NO = -1;
+  if (args != NULL && sscanf(args, "b %d", &NO) == 1) {
+    if (!bp_delete(NO)) printf("No breakpoint number %d\n", NO);
+  } else if (args == NULL || sscanf(args, "%d", &NO) != 1) {
+    printf("d lack argvs\n");
+  } else if (!wp_delete(NO)) {
+    printf("No watchpoint number %d\n", NO);
+  }
   return 0;
 }
 
@@ -125,11 +169,12 @@ static struct {
   { "c", "Continue the execution of the program", cmd_c },
   { "q", "Exit NEMU", cmd_q },
   { "si", "si [N] Continue the execution in N steps", cmd_si},
-  { "info", "info r r", cmd_info},
+  { "info", "info r|w|b Print registers, watchpoints or breakpoints", cmd_info},
   { "x", "x N Scan the memory from EXPR by N bytes", cmd_x},
   { "p", "p EXPR find expr", cmd_p},
-  { "w", "w EXPR stop ", cmd_w},
-  { "d", "d N deplete Nth wp", cmd_d},
+  { "w", "w EXPR Stop when the value of EXPR changes", cmd_w},
+  { "b", "b ADDR [if EXPR] Stop before executing the instruction at ADDR", cmd_b},
+  { "d", "d [b] N Delete the Nth watchpoint or breakpoint", cmd_d},
  
 };
 
@@ -18,6 +18,36 @@
 
 #include <common.h>
 
-word_t expr(char *e, bool *success);
+word_t expr(const char *e, bool *success);
+
+/* An expression compiled into bytecode for a stack machine, so that it can
+ * be evaluated repeatedly without tokenizing and parsing it again.
+ */
+#define EXPR_CODE_MAX 64
+
+enum {
+  OP_IMM, OP_REG, OP_PC, OP_DEREF, OP_NEG,
+  OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_EQ, OP_NE, OP_LAND, OP_LOR,
+};
+
+typedef struct {
+  struct { int op; word_t val; } code[EXPR_CODE_MAX];
+  int nr;
+  uint32_t reg_mask; // general purpose registers read by the expression
+  bool use_pc;
+  int nr_deref;
+} ExprCode;
+
+bool expr_compile(const char *e, ExprCode *c);
+// if `loads' is not NULL, the addresses dereferenced are recorded into it
+word_t expr_run(const ExprCode *c, bool *success, paddr_t *loads);
+
+void wp_display();
+int wp_new(const char *e);
+bool wp_delete(int NO);
+
+void bp_display();
+int bp_new(vaddr_t pc, const char *cond);
+bool bp_delete(int NO);
 
 #endif
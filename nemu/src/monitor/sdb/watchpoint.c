@@ -13,20 +13,38 @@
 * See the Mulan PSL v2 for more details.
 ***************************************************************************************/
 
+#include <isa.h>
+#include <cpu/watchpoint.h>
 #include "sdb.h"
+
 #define NR_WP 32
+#define NR_WP_LOAD 8
 
 typedef struct watchpoint {
   int NO;
   struct watchpoint *next;
 
-  /* TODO: Add more members if necessary */
-
+  char *expr;
+  ExprCode code;
+  word_t val;
+  bool valid;               // whether the last evaluation succeeded
+  paddr_t load[NR_WP_LOAD]; // memory locations read by the last evaluation
+  bool hit;                 // a store hits one of `load' since the last evaluation
 } WP;
 
 static WP wp_pool[NR_WP] = {};
 static WP *head = NULL, *free_ = NULL;
 
+/* Summary of all watchpoints in use, to filter out the instructions
+ * which can not change the value of any watchpoint.
+ */
+bool wp_active = false;
+static uint32_t reg_mask = 0;
+static bool use_pc = false;
+static word_t reg_shadow[ARRLEN(cpu.gpr)] = {};
+static paddr_t load_lo = 0, load_hi = 0;
+static bool store_hit = false;
+
 void init_wp_pool() {
   int i;
   for (i = 0; i < NR_WP; i ++) {
@@ -38,12 +56,139 @@ void init_wp_pool() {
   free_ = wp_pool;
 }
 
-/* TODO: Implement the functionality of watchpoint */
+static void wp_eval(WP *wp) {
+  memset(wp->load, 0, sizeof(wp->load));
+  wp->val = expr_run(&wp->code, &wp->valid, wp->load);
+}
+
+static void update_loads() {
+  load_lo = (paddr_t)-1;
+  load_hi = 0;
+  for (WP *wp = head; wp != NULL; wp = wp->next) {
+    for (int i = 0; i < wp->code.nr_deref; i ++) {
+      if (wp->load[i] < load_lo) load_lo = wp->load[i];
+      if (wp->load[i] > load_hi) load_hi = wp->load[i];
+    }
+  }
+  load_hi += sizeof(word_t);
+}
 
+static void update_summary() {
+  reg_mask = 0;
+  use_pc = false;
+  for (WP *wp = head; wp != NULL; wp = wp->next) {
+    reg_mask |= wp->code.reg_mask;
+    use_pc |= wp->code.use_pc;
+  }
+  memcpy(reg_shadow, cpu.gpr, sizeof(reg_shadow));
+  update_loads();
+  store_hit = false;
+  wp_active = (head != NULL);
+}
 
+void wp_check_store(paddr_t addr, int len) {
+  if (addr >= load_hi || addr + len <= load_lo) return;
+  for (WP *wp = head; wp != NULL; wp = wp->next) {
+    for (int i = 0; i < wp->code.nr_deref; i ++) {
+      if (addr < wp->load[i] + sizeof(word_t) && wp->load[i] < addr + len) {
+        wp->hit = store_hit = true;
+        break;
+      }
+    }
+  }
+}
 
+static void print_val(const char *msg, bool valid, word_t val) {
+  if (valid) printf("%s = " FMT_WORD "\n", msg, val);
+  else printf("%s = <invalid>\n", msg);
+}
 
+void wp_check(vaddr_t pc) {
+  uint32_t dirty = 0;
+  for (uint32_t m = reg_mask; m != 0; m &= m - 1) {
+    int i = __builtin_ctz(m);
+    if (cpu.gpr[i] != reg_shadow[i]) {
+      reg_shadow[i] = cpu.gpr[i];
+      dirty |= 1u << i;
+    }
+  }
+  if (dirty == 0 && !store_hit && !use_pc) return;
+  store_hit = false;
+
+  bool reload = false;
+  for (WP *wp = head; wp != NULL; wp = wp->next) {
+    if (!wp->hit && (wp->code.reg_mask & dirty) == 0 && !wp->code.use_pc) continue;
+    wp->hit = false;
+    word_t old = wp->val;
+    bool old_valid = wp->valid;
+    wp_eval(wp);
+    reload |= (wp->code.nr_deref > 0);
+    if (wp->valid != old_valid || (wp->valid && wp->val != old)) {
+      printf("\nWatchpoint %d: %s at pc = " FMT_WORD "\n\n", wp->NO, wp->expr, pc);
+      print_val("Old value", old_valid, old);
+      print_val("New value", wp->valid, wp->val);
+      if (nemu_state.state == NEMU_RUNNING) nemu_state.state = NEMU_STOP;
+    }
+  }
+  if (reload) update_loads();
+}
 
+int wp_new(const char *e) {
+  ExprCode code;
+  if (!expr_compile(e, &code)) {
+    printf("Invalid expression: %s\n", e);
+    return -1;
+  }
+  if (code.nr_deref > NR_WP_LOAD) {
+    printf("Too many memory accesses in a watchpoint, at most %d are supported\n", NR_WP_LOAD);
+    return -1;
+  }
+  if (free_ == NULL) {
+    printf("Too many watchpoints\n");
+    return -1;
+  }
 
+  WP *wp = free_;
+  free_ = wp->next;
+  wp->next = NULL;
+  wp->expr = strdup(e);
+  wp->code = code;
+  wp->hit = false;
+  wp_eval(wp);
+
+  // keep the list sorted by the creation order
+  WP **p = &head;
+  while (*p != NULL) p = &(*p)->next;
+  *p = wp;
+
+  update_summary();
+  return wp->NO;
+}
 
+bool wp_delete(int NO) {
+  for (WP **p = &head; *p != NULL; p = &(*p)->next) {
+    WP *wp = *p;
+    if (wp->NO == NO) {
+      *p = wp->next;
+      free(wp->expr);
+      wp->expr = NULL;
+      wp->next = free_;
+      free_ = wp;
+      update_summary();
+      return true;
+    }
+  }
+  return false;
+}
 
+void wp_display() {
+  if (head == NULL) {
+    printf("No watchpoints.\n");
+    return;
+  }
+  printf("Num\tValue\t\tWhat\n");
+  for (WP *wp = head; wp != NULL; wp = wp->next) {
+    if (wp->valid) printf("%d\t" FMT_WORD "\t%s\n", wp->NO, wp->val, wp->expr);
+    else printf("%d\t<invalid>\t%s\n", wp->NO, wp->expr);
+  }
+}
@@ -31,6 +31,7 @@
 #include "llvm/Support/TargetRegistry.h"
 #endif
 #include "llvm/Support/TargetSelect.h"
+#include <mutex>
 
 #if defined(__GNUC__) && !defined(__clang__)
 #pragma GCC diagnostic pop
@@ -45,6 +46,7 @@ using namespace llvm;
 static llvm::MCDisassembler *gDisassembler = nullptr;
 static llvm::MCSubtargetInfo *gSTI = nullptr;
 static llvm::MCInstPrinter *gIP = nullptr;
+static std::mutex gLock; // machines on different threads share the disassembler
 
 extern "C" void init_disasm(const char *triple) {
   llvm::InitializeAllTargetInfos();
@@ -93,10 +95,15 @@ extern "C" void init_disasm(const char *triple) {
 }
 
 extern "C" void disassemble(char *str, int size, uint64_t pc, uint8_t *code, int nbyte) {
+  std::lock_guard<std::mutex> guard(gLock);
   MCInst inst;
   llvm::ArrayRef<uint8_t> arr(code, nbyte);
   uint64_t dummy_size = 0;
-  gDisassembler->getInstruction(inst, dummy_size, arr, pc, llvm::nulls());
+  // an encoding rejected by LLVM, e.g. a reserved rounding mode, leaves `inst' half built
+  if (gDisassembler->getInstruction(inst, dummy_size, arr, pc, llvm::nulls()) != MCDisassembler::Success) {
+    snprintf(str, size, "(bad)");
+    return;
+  }
 
   std::string s;
   raw_string_ostream os(s);
@@ -0,0 +1,63 @@
+/***************************************************************************************
+* Copyright (c) 2014-2022 Zihao Yu, Nanjing University
+*
+* NEMU is licensed under Mulan PSL v2.
+* You can use this software according to the terms and conditions of the Mulan PSL v2.
+* You may obtain a copy of Mulan PSL v2 at:
+*          http://license.coscl.org.cn/MulanPSL2
+*
+* THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+* EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+* MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+*
+* See the Mulan PSL v2 for more details.
+***************************************************************************************/
+
+#include <machine.h>
+#include <memory/paddr.h>
+
+void init_mem();
+void init_machine_device();
+
+Machine default_machine = { .state = { .state = NEMU_STOP } };
+MACHINE_TLS Machine *machine = &default_machine;
+MACHINE_TLS Hart *hart = &default_machine.harts[0];
+
+Machine* machine_new() {
+  Machine *m = calloc(1, sizeof(*m));
+  assert(m);
+  m->state.state = NEMU_STOP;
+
+  Machine *old = machine_switch(m);
+  init_mem();
+  init_isa();
+  IFDEF(CONFIG_DEVICE, init_machine_device());
+  machine_switch(old);
+  return m;
+}
+
+static void free_device(Machine *m) {
+  IFDEF(CONFIG_HAS_SDCARD, if (m->dev.sdcard.fp) fclose(m->dev.sdcard.fp));
+  free(m->io_space);
+}
+
+void machine_free(Machine *m) {
+  assert(m != &default_machine && m != machine);
+  free_device(m);
+  free(m->pmem_alloc);
+  free(m);
+}
+
+void machine_reset() {
+  pmem_reset();
+  memset(machine->harts, 0, sizeof(machine->harts));
+  nemu_state = (NEMUState){ .state = NEMU_STOP };
+  machine->timer = 0;
+#ifdef CONFIG_DEVICE
+  free_device(machine);
+  machine->nr_mmio_map = machine->nr_pio_map = 0;
+  memset(&machine->dev, 0, sizeof(machine->dev));
+  init_machine_device();
+#endif
+  init_isa();
+}
@@ -0,0 +1,60 @@
+# lr.w, sc.w and AMOs, the misaligned ones raise the address-misaligned
+# exceptions (4 for lr.w, 6 for sc.w and AMOs) with the address in mtval
+require CONFIG_ISA_riscv
+conflict CONFIG_RV64 CONFIG_RVE
+
+image atomic <<END
+00000297  # 80000000: auipc     t0, 0
+0b028293  # 80000004: addi      t0, t0, 0xb0
+30529073  # 80000008: csrw      mtvec, t0
+80100437  # 8000000c: lui       s0, 0x80100
+00500313  # 80000010: li        t1, 5
+00642023  # 80000014: sw        t1, 0(s0)
+00300313  # 80000018: li        t1, 3
+006423af  # 8000001c: amoadd.w  t2, t1, (s0)      <- t2 = 5, mem = 8
+00500e13  # 80000020: li        t3, 5
+09c39263  # 80000024: bne       t2, t3, 800000a8
+100423af  # 80000028: lr.w      t2, (s0)          <- t2 = 8
+00138393  # 8000002c: addi      t2, t2, 1
+18742eaf  # 80000030: sc.w      t4, t2, (s0)      <- mem = 9, t4 = 0
+060e9a63  # 80000034: bnez      t4, 800000a8
+00042383  # 80000038: lw        t2, 0(s0)
+00900e13  # 8000003c: li        t3, 9
+07c39463  # 80000040: bne       t2, t3, 800000a8
+# misaligned accesses trap without touching the memory or rd
+00000493  # 80000044: li        s1, 0
+00240593  # 80000048: addi      a1, s0, 2
+00700613  # 8000004c: li        a2, 7
+05500393  # 80000050: li        t2, 85
+08c5a3af  # 80000054: amoswap.w t2, a2, (a1)      <- cause 6, t2 is kept
+05500e13  # 80000058: li        t3, 85
+05c39663  # 8000005c: bne       t2, t3, 800000a8
+00600e13  # 80000060: li        t3, 6
+05c91263  # 80000064: bne       s2, t3, 800000a8
+04b99063  # 80000068: bne       s3, a1, 800000a8
+00140593  # 8000006c: addi      a1, s0, 1
+1005a3af  # 80000070: lr.w      t2, (a1)          <- cause 4
+00400e13  # 80000074: li        t3, 4
+03c91863  # 80000078: bne       s2, t3, 800000a8
+02b99663  # 8000007c: bne       s3, a1, 800000a8
+18c5a3af  # 80000080: sc.w      t2, a2, (a1)      <- cause 6
+00600e13  # 80000084: li        t3, 6
+03c91063  # 80000088: bne       s2, t3, 800000a8
+00300e13  # 8000008c: li        t3, 3
+01c49c63  # 80000090: bne       s1, t3, 800000a8
+00042383  # 80000094: lw        t2, 0(s0)
+00900e13  # 80000098: li        t3, 9
+01c39663  # 8000009c: bne       t2, t3, 800000a8
+00000513  # 800000a0: li        a0, 0
+00100073  # 800000a4: ebreak
+00100513  # 800000a8: li        a0, 1             <- bad
+00100073  # 800000ac: ebreak
+34202973  # 800000b0: csrr      s2, mcause        <- trap handler: s2 = mcause, s3 = mtval, s1 = nr_trap
+343029f3  # 800000b4: csrr      s3, mtval
+00148493  # 800000b8: addi      s1, s1, 1
+34102f73  # 800000bc: csrr      t5, mepc
+004f0f13  # 800000c0: addi      t5, t5, 4
+341f1073  # 800000c4: csrw      mepc, t5
+30200073  # 800000c8: mret
+END
+pass atomic
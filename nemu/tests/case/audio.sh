@@ -0,0 +1,37 @@
+# the stream buffer is drained on guest time, one period of 100 frames
+# at 8000 Hz every 100 * CONFIG_AUDIO_INST_PER_SEC / 8000 instructions
+require CONFIG_HAS_AUDIO
+[ "$CONFIG_AUDIO_CTL_MMIO" = 0xa0000200 ] && [ "$CONFIG_SB_ADDR" = 0xa1200000 ] || exit 77
+
+image audio <<END
+a12002b7  # 80000000: lui   t0, 0xa1200       <- the stream buffer
+00000313  # 80000004: li    t1, 0
+3e800393  # 80000008: li    t2, 1000
+00628e33  # 8000000c: add   t3, t0, t1
+006e0023  # 80000010: sb    t1, 0(t3)
+00130313  # 80000014: addi  t1, t1, 1
+fe731ae3  # 80000018: bne   t1, t2, 8000000c
+a0000eb7  # 8000001c: lui   t4, 0xa0000
+200e8e93  # 80000020: addi  t4, t4, 512       <- the audio controller
+00002f37  # 80000024: lui   t5, 0x2
+f40f0f13  # 80000028: addi  t5, t5, -192
+01eea023  # 8000002c: sw    t5, 0(t4)         <- freq = 8000
+00100f13  # 80000030: li    t5, 1
+01eea223  # 80000034: sw    t5, 4(t4)         <- channels = 1
+06400f13  # 80000038: li    t5, 100
+01eea423  # 8000003c: sw    t5, 8(t4)         <- samples = 100
+00100f13  # 80000040: li    t5, 1
+01eea823  # 80000044: sw    t5, 16(t4)        <- init
+007eaa23  # 80000048: sw    t2, 20(t4)        <- count = 1000, 5 periods of 200 bytes
+014eaf03  # 8000004c: lw    t5, 20(t4)
+fe0f1ee3  # 80000050: bnez  t5, 8000004c
+00000513  # 80000054: li    a0, 0
+00100073  # 80000058: ebreak
+END
+pass audio
+# the total counts the instructions of all harts
+[ "${CONFIG_NR_HART:-1}" -gt 1 ] && exit 0
+n=$(sed -n 's/.*total guest instructions = \([0-9]*\).*/\1/p' audio.log)
+period=$((100 * CONFIG_AUDIO_INST_PER_SEC / 8000))
+[ "$n" -ge $((5 * period)) ] && [ "$n" -lt $((6 * period)) ] ||
+  fail "the buffer is drained after $n instructions, a period is $period"
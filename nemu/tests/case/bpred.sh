@@ -0,0 +1,23 @@
+# every branch and jump is fed into the predictor: the call is resolved at
+# decode, the return is predicted by the RAS, and the loop branch is listed
+# among the most mispredicted PCs
+require CONFIG_BPRED
+conflict CONFIG_RV64
+
+image bpred <<END
+018000ef  # 80000000: jal   ra, 80000018
+00a00593  # 80000004: li    a1, 10
+fff58593  # 80000008: addi  a1, a1, -1
+fe059ee3  # 8000000c: bnez  a1, 80000008
+00000513  # 80000010: li    a0, 0
+00100073  # 80000014: ebreak
+00008067  # 80000018: ret
+END
+pass bpred
+for r in "branch  : 10 executed" "call    : 1 executed, 0 mispredicted" \
+         "return  : 1 executed, 0 mispredicted" "overall : 12 executed"; do
+  grep -q "$r" bpred.log || fail "no \"$r\": $(grep -a bpred_report bpred.log | sort -u)"
+done
+# the first taken branch can not be predicted by a counter in the power-on state
+grep -q "pc = 0x8000000c branch  : 10 executed, [1-9][0-9]* mispredicted" bpred.log ||
+  fail "the loop branch is not reported: $(grep 'pc = ' bpred.log)"
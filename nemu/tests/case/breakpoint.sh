@@ -0,0 +1,43 @@
+# a breakpoint stops before the instruction at its address only when its
+# condition holds, the execution continues from it without stopping again,
+# and no instruction is executed twice or skipped because of the stops
+require CONFIG_BREAKPOINT CONFIG_ISA_riscv
+conflict CONFIG_RV64
+
+image bp <<END
+00500593  # 80000000: li    a1, 5
+fff58593  # 80000004: addi  a1, a1, -1   <- breakpoint 0 if a1 == 2
+fe059ee3  # 80000008: bnez  a1, 80000004
+00000513  # 8000000c: li    a0, 0        <- breakpoint 1
+00100073  # 80000010: ebreak
+END
+sdb bp <<END
+b 0x80000004 if \$a1 == 2
+b 0x8000000c
+b 0x8000000c
+c
+p \$a1
+c
+p \$a1
+info b
+d b 0
+c
+q
+END
+# the output of the commands
+grep -a "^Breakpoint\|^\\\$\|^Num\|^[0-9]"$'\t' bp.log | sed 's/[ \t]*$//' > result.txt
+cat > expected.txt <<END
+Breakpoint 0 at 0x80000004 if \$a1 == 2
+Breakpoint 1 at 0x8000000c
+Breakpoint already exists at 0x8000000c
+Breakpoint 0 at pc = 0x80000004
+\$a1 = 2
+Breakpoint 1 at pc = 0x8000000c
+\$a1 = 0
+Num	Address		Hits	Condition
+0	0x80000004	1	\$a1 == 2
+1	0x8000000c	1
+END
+diff -u expected.txt result.txt > result.diff || fail "wrong stops: $(cat result.diff)"
+grep -q "HIT GOOD TRAP" bp.log || fail "bp does not hit the good trap: $(tail -3 bp.log)"
+grep -q "total guest instructions = 13" bp.log || fail "wrong count: $(grep 'guest instructions' bp.log | head -1)"
@@ -0,0 +1,51 @@
+# MTIP of the CLINT is pending once mtime reaches mtimecmp, but the timer
+# interrupt is only taken after MTIE is set in mie, and it is cleared by
+# writing mtimecmp
+require CONFIG_HAS_CLINT CONFIG_ISA_riscv
+conflict CONFIG_RV64
+
+image clint <<END
+00000297  # 80000000: auipc t0, 0
+09028293  # 80000004: addi  t0, t0, 144
+30529073  # 80000008: csrw  mtvec, t0
+00000493  # 8000000c: li    s1, 0
+00000417  # 80000010: auipc s0, 0
+09440413  # 80000014: addi  s0, s0, 148
+00042403  # 80000018: lw    s0, 0(s0)
+00004337  # 8000001c: lui   t1, 0x4
+006409b3  # 80000020: add   s3, s0, t1
+0000c337  # 80000024: lui   t1, 0xc
+ff830313  # 80000028: addi  t1, t1, -8
+00640a33  # 8000002c: add   s4, s0, t1
+000a2283  # 80000030: lw    t0, 0(s4)   <- mtime
+01428293  # 80000034: addi  t0, t0, 20
+0009a223  # 80000038: sw    zero, 4(s3)
+0059a023  # 8000003c: sw    t0, 0(s3)   <- mtimecmp = mtime + 20
+30046073  # 80000040: csrsi mstatus, 8
+34402373  # 80000044: csrr  t1, mip     <- MTIP is pending but MTIE is off
+08037313  # 80000048: andi  t1, t1, 0x80
+fe030ce3  # 8000004c: beqz  t1, 80000044
+02049c63  # 80000050: bnez  s1, 80000088
+08000313  # 80000054: li    t1, 128
+30432073  # 80000058: csrs  mie, t1     <- the interrupt is taken here
+00000013  # 8000005c: nop
+00100393  # 80000060: li    t2, 1
+02749263  # 80000064: bne   s1, t2, 80000088
+800003b7  # 80000068: lui   t2, 0x80000
+00738393  # 8000006c: addi  t2, t2, 7
+00791c63  # 80000070: bne   s2, t2, 80000088
+34402373  # 80000074: csrr  t1, mip     <- MTIP is cleared by the handler
+08037313  # 80000078: andi  t1, t1, 0x80
+00031663  # 8000007c: bnez  t1, 80000088
+00000513  # 80000080: li    a0, 0
+00100073  # 80000084: ebreak
+00100513  # 80000088: li    a0, 1       <- bad
+00100073  # 8000008c: ebreak
+34202973  # 80000090: csrr  s2, mcause  <- trap handler: s2 = mcause, s1 = nr_trap, mtimecmp = -1
+00148493  # 80000094: addi  s1, s1, 1
+fff00313  # 80000098: li    t1, -1
+0069a223  # 8000009c: sw    t1, 4(s3)
+30200073  # 800000a0: mret
+$(printf %08x $CONFIG_CLINT_MMIO)  # 800000a4: the address of the CLINT
+END
+pass clint
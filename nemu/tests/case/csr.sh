@@ -0,0 +1,36 @@
+# misa claims neither B nor V for their subsets, only the fields of mstatus
+# of the configured extensions are writable, SD follows them when they are
+# Dirty and MPP is always M, the counters read after mip, which REF skips, are taken from DUT
+require CONFIG_ISA_riscv
+conflict CONFIG_RV64
+
+mask=0x1888
+[ "$CONFIG_RVFD" = y ] && mask=$((mask | 0x80006000))
+[ "$CONFIG_RVV" = y ] && mask=$((mask | 0x80000600))
+image csr <<END
+344022f3  # 80000000: csrr  t0, mip
+b0202573  # 80000004: csrr  a0, minstret
+b00025f3  # 80000008: csrr  a1, mcycle
+301022f3  # 8000000c: csrr  t0, misa
+00200337  # 80000010: lui   t1, 0x200
+00230313  # 80000014: addi  t1, t1, 2
+0062f333  # 80000018: and   t1, t0, t1      <- V and B
+02031c63  # 8000001c: bnez  t1, 80000054
+fff00293  # 80000020: li    t0, -1
+30029073  # 80000024: csrw  mstatus, t0
+300022f3  # 80000028: csrr  t0, mstatus
+00000317  # 8000002c: auipc t1, 0
+03032303  # 80000030: lw    t1, 48(t1)
+02629063  # 80000034: bne   t0, t1, 80000054
+30001073  # 80000038: csrw  mstatus, zero
+300022f3  # 8000003c: csrr  t0, mstatus
+00002337  # 80000040: lui   t1, 0x2
+80030313  # 80000044: addi  t1, t1, -2048   <- MPP = M
+00629663  # 80000048: bne   t0, t1, 80000054
+00000513  # 8000004c: li    a0, 0
+00100073  # 80000050: ebreak
+00100513  # 80000054: li    a0, 1
+00100073  # 80000058: ebreak
+$(printf %08x $mask)  # 8000005c: the writable fields of mstatus, SD and MPP
+END
+pass csr
@@ -0,0 +1,24 @@
+# a mismatch in a batch is found by bisection, even if the batch
+# starts with an instruction writing a CSR which REF can not roll back
+require CONFIG_DIFFTEST CONFIG_ISA_riscv
+conflict CONFIG_RV64 CONFIG_RVE
+[ ${CONFIG_DIFFTEST_BATCH:-1} -gt 1 ] || exit 77
+
+cc -shared -fPIC -o ref.so $NEMU_HOME/tests/difftest-ref.c -ldl || fail "can not build the reference design"
+
+image bisect <<END
+00500313  # 80000000: li    t1, 5
+340312f3  # 80000004: csrrw t0, mscratch, t1
+00000513  # 80000008: li    a0, 0
+00100593  # 8000000c: li    a1, 1
+00050513  # 80000010: mv    a0, a0   <- REF flips a0 here
+00158593  # 80000014: addi  a1, a1, 1
+00158593  # 80000018: addi  a1, a1, 1
+00100073  # 8000001c: ebreak
+END
+DIFF_BAD_PC=0x80000010 run bisect --diff=$PWD/ref.so && fail "the mismatch is not found"
+grep -q "found by bisection" bisect.log || fail "no bisection: $(tail -5 bisect.log)"
+grep -q "ABORT.*at pc = 0x80000010" bisect.log || fail "wrong instruction: $(grep ABORT bisect.log)"
+
+# no mismatch without the bad instruction
+DIFF_BAD_PC=0 pass bisect --diff=$PWD/ref.so
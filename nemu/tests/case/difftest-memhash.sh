@@ -0,0 +1,23 @@
+# the memory of REF is compared by the hashes, starting from the same content
+require CONFIG_DIFFTEST CONFIG_ISA_riscv CONFIG_MEMHASH
+conflict CONFIG_RV64 CONFIG_RVE
+[ ${CONFIG_DIFFTEST_MEMHASH_INTERVAL:-0} -gt 0 ] || exit 77
+
+cc -shared -fPIC -o ref.so $NEMU_HOME/tests/difftest-ref.c -ldl || fail "can not build the reference design"
+
+image memhash <<END
+801002b7  # 80000000: lui   t0, 0x80100
+7d000313  # 80000004: li    t1, 2000
+0062a023  # 80000008: sw    t1, 0(t0)
+00428293  # 8000000c: addi  t0, t0, 4
+fff30313  # 80000010: addi  t1, t1, -1
+fe031ae3  # 80000014: bnez  t1, 80000008
+00000513  # 80000018: li    a0, 0
+00100073  # 8000001c: ebreak
+END
+pass memhash
+pass memhash --diff=$PWD/ref.so
+
+# a word written only to REF is found
+DIFF_BAD_MEM=0x80200010 run memhash --diff=$PWD/ref.so && fail "the different memory is not found"
+grep -q "memory is different at 0x80200010" memhash.log || fail "wrong address: $(grep different memhash.log)"
@@ -0,0 +1,21 @@
+# REF on its own thread finds the mismatching instruction, and an
+# instruction skipped by REF only copies the registers of DUT to it
+require CONFIG_DIFFTEST_THREAD CONFIG_ISA_riscv
+conflict CONFIG_RV64 CONFIG_RVE
+
+cc -shared -fPIC -o ref.so $NEMU_HOME/tests/difftest-ref.c -ldl || fail "can not build the reference design"
+
+image thread <<END
+b00022f3  # 80000000: csrr  t0, mcycle  <- skipped by REF
+00000513  # 80000004: li    a0, 0
+00100593  # 80000008: li    a1, 1
+00158593  # 8000000c: addi  a1, a1, 1
+00050513  # 80000010: mv    a0, a0      <- REF flips a0 here
+00158593  # 80000014: addi  a1, a1, 1
+00100073  # 80000018: ebreak
+END
+DIFF_BAD_PC=0x80000010 run thread --diff=$PWD/ref.so && fail "the mismatch is not found"
+grep -q "ABORT.*at pc = 0x80000010" thread.log || fail "wrong instruction: $(grep ABORT thread.log)"
+
+# no mismatch without the bad instruction
+DIFF_BAD_PC=0 pass thread --diff=$PWD/ref.so
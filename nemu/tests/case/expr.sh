@@ -0,0 +1,54 @@
+# sdb expressions keep the precedence and associativity of C, read the
+# registers and the memory, and a division by zero or a dereference outside
+# the memory fails at evaluation rather than at compilation
+require CONFIG_ISA_riscv
+conflict CONFIG_RV64
+
+image expr <<END
+01500593  # 80000000: li    a1, 21
+00000513  # 80000004: li    a0, 0
+00100073  # 80000008: ebreak
+END
+sdb expr <<END
+si 1
+p 1 + 2 * 3
+p (1 + 2) * 3
+p 10 - 2 - 3
+p 100 / 7
+p 2 * -(1 + 2) + 10
+p 0x10 == 16 && 2 != 3
+p 0 || 5 == 5
+p \$pc
+p \$a1 * 2
+p *0x80000000
+p *\$pc
+p 1 / 0
+p 8 / (4 - 2 * 2)
+p *0x10
+p \$xyz
+p 1 +
+c
+q
+END
+# the results, without the log lines in color
+grep -a " = [0-9]* *$\|expression: " expr.log | grep -av $'^\e' | sed 's/ *$//' > result.txt
+cat > expected.txt <<END
+1 + 2 * 3 = 7
+(1 + 2) * 3 = 9
+10 - 2 - 3 = 5
+100 / 7 = 14
+2 * -(1 + 2) + 10 = 4
+0x10 == 16 && 2 != 3 = 1
+0 || 5 == 5 = 1
+\$pc = 2147483652
+\$a1 * 2 = 42
+*0x80000000 = 22021523
+*\$pc = 1299
+can not evaluate expression: 1 / 0
+can not evaluate expression: 8 / (4 - 2 * 2)
+can not evaluate expression: *0x10
+invalid expression: \$xyz
+invalid expression: 1 +
+END
+diff -u expected.txt result.txt > result.diff || fail "wrong values: $(cat result.diff)"
+grep -q "HIT GOOD TRAP" expr.log || fail "expr does not hit the good trap: $(tail -3 expr.log)"
@@ -0,0 +1,46 @@
+# a reserved rounding mode, in the instruction or in frm for the dynamic one,
+# raises the illegal-instruction exception (2) with the instruction in mtval,
+# FP instructions which are executed make mstatus.FS Dirty and set SD
+require CONFIG_ISA_riscv CONFIG_RVFD
+conflict CONFIG_RV64
+
+image fp <<END
+00000297  # 80000000: auipc   t0, 0
+07828293  # 80000004: addi    t0, t0, 0x78
+30529073  # 80000008: csrw    mtvec, t0
+00000493  # 8000000c: li      s1, 0
+30001073  # 80000010: csrw    mstatus, zero
+000050d3  # 80000014: fadd.s  f1, f0, f0, rm = 5 <- cause 2
+00200e13  # 80000018: li      t3, 2
+05c91a63  # 8000001c: bne     s2, t3, 80000070
+00005e37  # 80000020: lui     t3, 0x5
+0d3e0e13  # 80000024: addi    t3, t3, 0xd3
+05c99463  # 80000028: bne     s3, t3, 80000070
+300022f3  # 8000002c: csrr    t0, mstatus       <- FS is still Off
+00006337  # 80000030: lui     t1, 0x6
+0062f2b3  # 80000034: and     t0, t0, t1
+02029c63  # 80000038: bnez    t0, 80000070
+000000d3  # 8000003c: fadd.s  f1, f0, f0, rne
+300022f3  # 80000040: csrr    t0, mstatus       <- SD and FS = Dirty
+0202d663  # 80000044: bgez    t0, 80000070
+0062f2b3  # 80000048: and     t0, t0, t1
+02629263  # 8000004c: bne     t0, t1, 80000070
+00235073  # 80000050: csrwi   frm, 6
+000070d3  # 80000054: fadd.s  f1, f0, f0, dyn  <- cause 2
+0020d073  # 80000058: csrwi   frm, 1
+000070d3  # 8000005c: fadd.s  f1, f0, f0, dyn
+00200e13  # 80000060: li      t3, 2
+01c49663  # 80000064: bne     s1, t3, 80000070
+00000513  # 80000068: li      a0, 0
+00100073  # 8000006c: ebreak
+00100513  # 80000070: li      a0, 1             <- bad
+00100073  # 80000074: ebreak
+34202973  # 80000078: csrr    s2, mcause        <- trap handler: s2 = mcause, s3 = mtval, s1 = nr_trap
+343029f3  # 8000007c: csrr    s3, mtval
+00148493  # 80000080: addi    s1, s1, 1
+34102f73  # 80000084: csrr    t5, mepc
+004f0f13  # 80000088: addi    t5, t5, 4
+341f1073  # 8000008c: csrw    mepc, t5
+30200073  # 80000090: mret
+END
+pass fp
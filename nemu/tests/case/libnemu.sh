@@ -0,0 +1,22 @@
+# machines of libnemu are created, run, reset by restoring a snapshot,
+# and freed over and over in one process
+require CONFIG_LIBNEMU CONFIG_ISA_riscv
+conflict CONFIG_RV64
+
+cc -I$NEMU_HOME/include -o cycle $NEMU_HOME/tests/libnemu-cycle.c $NEMU ||
+  fail "can not build the harness"
+
+image count <<END
+06400593  # 80000000: li    a1, 100
+fff58593  # 80000004: addi  a1, a1, -1
+fe059ee3  # 80000008: bnez  a1, 80000004
+00000513  # 8000000c: li    a0, 0
+00100073  # 80000010: ebreak
+END
+parallel=$([ "${CONFIG_NR_HART:-1}" -gt 1 ] && [ "$CONFIG_SMP_QUANTUM" = 0 ] && echo -p)
+./cycle count.bin $parallel > cycle.log 2>&1 || fail "$(tail -3 cycle.log)"
+
+# MMIO callbacks, nemu_stop() from a callback and ELF files
+cc -I$NEMU_HOME/include -o api $NEMU_HOME/tests/libnemu-api.c $NEMU ||
+  fail "can not build the harness"
+./api > api.log 2>&1 || fail "$(tail -3 api.log)"
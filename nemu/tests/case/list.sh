@@ -0,0 +1,68 @@
+# --list runs the images on machines reset between the images,
+# and counts the images which fail in the report given by --json
+conflict CONFIG_TARGET_SHARE CONFIG_DIFFTEST
+
+image good <<END
+00000513  # li a0, 0
+00100073  # ebreak
+END
+image bad <<END
+00100513  # li a0, 1
+00100073  # ebreak
+END
+printf "good.bin\nbad.bin\n# comment\ngood.bin\n" > list.txt
+
+# the performance models are shared by the machines, so the images run one by one
+models=$([ "$CONFIG_BPRED" = y ] || [ "$CONFIG_TIMING" = y ] && echo y)
+for jobs in 1 $([ -z "$models" ] && echo 2); do
+  $NEMU -b --list=list.txt --jobs=$jobs --json=report.json > list.log 2>&1
+  [ $? -eq 1 ] || fail "--jobs=$jobs: exit code is not 1: $(tail -3 list.log)"
+  grep -q '"passed": 2' report.json && grep -q '"failed": 1' report.json ||
+    fail "--jobs=$jobs: wrong report: $(cat report.json)"
+  [ $(grep -c '"result": "pass"' report.json) -eq 2 ] || fail "--jobs=$jobs: wrong results"
+done
+
+# without --json the images which do not pass are only logged
+rm -f report.json
+$NEMU -b --list=list.txt > list.log 2>&1
+grep -q "bad.bin: fail" list.log && grep -q "2 of 3 images passed" list.log || fail "wrong log: $(tail -3 list.log)"
+grep -q '"images"' list.log && fail "the report is mixed with the log"
+[ ! -e report.json ] || fail "report.json is written without --json"
+
+
+# the pages written by an image are restored for the next one
+image dirty <<END
+801002b7  # lui   t0, 0x80100
+0052a023  # sw    t0, 0(t0)
+00000513  # li    a0, 0
+00100073  # ebreak
+END
+image clean <<END
+801002b7  # lui   t0, 0x80100
+0002a303  # lw    t1, 0(t0)
+802002b7  # lui   t0, 0x80200
+0002a383  # lw    t2, 0(t0)    <- a page never written
+40730533  # sub   a0, t1, t2
+00100073  # ebreak
+END
+printf "dirty.bin\nclean.bin\n" > mem.txt
+$NEMU -b --list=mem.txt > mem.log 2>&1 || fail "the memory is not restored: $(grep 'clean.bin' mem.log)"
+
+[ -n "$models" ] || exit 0
+$NEMU -b --list=list.txt --jobs=2 > jobs.log 2>&1
+grep -q "is not supported" jobs.log || fail "--jobs=2 is accepted with the performance models: $(tail -3 jobs.log)"
+# the models are reset for every image, so both runs of the loop are reported the same
+image loop <<END
+00a00593  # li    a1, 10
+fff58593  # addi  a1, a1, -1
+fe059ee3  # bnez  a1, -4
+00000513  # li    a0, 0
+00100073  # ebreak
+END
+printf "loop.bin\nloop.bin\n" > loop.txt
+$NEMU -b --list=loop.txt > models.log 2>&1 || fail "the loop does not pass: $(tail -3 models.log)"
+for r in "estimated cycles" "overall :"; do
+  grep "$r" models.log | sed 's/.*\] //' > report.txt
+  [ -s report.txt ] || continue
+  [ "$(head -1 report.txt)" = "$(tail -1 report.txt)" ] || fail "the models are not reset: $(cat report.txt)"
+done
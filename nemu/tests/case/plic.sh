@@ -0,0 +1,43 @@
+# the registers of the PLIC keep only their legal bits: source 0 has no
+# priority, priorities and thresholds are 0 to 7, and source 0 can not be
+# enabled; nothing is claimed and MEIP is clear while no source is pending
+require CONFIG_HAS_PLIC CONFIG_ISA_riscv
+conflict CONFIG_RV64
+
+image plic <<END
+00000417  # 80000000: auipc s0, 0
+08442403  # 80000004: lw    s0, 132(s0)
+fff00313  # 80000008: li    t1, -1
+00642023  # 8000000c: sw    t1, 0(s0)   <- priority of source 0
+00042283  # 80000010: lw    t0, 0(s0)
+06029463  # 80000014: bnez  t0, 8000007c
+00642223  # 80000018: sw    t1, 4(s0)   <- priority of source 1
+00442283  # 8000001c: lw    t0, 4(s0)
+00700393  # 80000020: li    t2, 7
+04729c63  # 80000024: bne   t0, t2, 8000007c
+000023b7  # 80000028: lui   t2, 0x2
+007403b3  # 8000002c: add   t2, s0, t2
+0063a023  # 80000030: sw    t1, 0(t2)   <- enable of context 0
+0003a283  # 80000034: lw    t0, 0(t2)
+ffe00393  # 80000038: li    t2, -2
+04729063  # 8000003c: bne   t0, t2, 8000007c
+002003b7  # 80000040: lui   t2, 0x200
+007403b3  # 80000044: add   t2, s0, t2
+0063a023  # 80000048: sw    t1, 0(t2)   <- threshold of context 0
+0003a283  # 8000004c: lw    t0, 0(t2)
+00700e13  # 80000050: li    t3, 7
+03c29463  # 80000054: bne   t0, t3, 8000007c
+0043a283  # 80000058: lw    t0, 4(t2)   <- claim
+02029063  # 8000005c: bnez  t0, 8000007c
+344022f3  # 80000060: csrr  t0, mip
+00001e37  # 80000064: lui   t3, 0x1
+800e0e13  # 80000068: addi  t3, t3, -2048
+01c2f2b3  # 8000006c: and   t0, t0, t3
+00029663  # 80000070: bnez  t0, 8000007c
+00000513  # 80000074: li    a0, 0
+00100073  # 80000078: ebreak
+00100513  # 8000007c: li    a0, 1       <- bad
+00100073  # 80000080: ebreak
+$(printf %08x $CONFIG_PLIC_MMIO)  # 80000084: the address of the PLIC
+END
+pass plic
@@ -0,0 +1,72 @@
+# the compressed instructions of RV32C without the floating-point ones,
+# mixed with 32-bit instructions at halfword boundaries
+require CONFIG_ISA_riscv CONFIG_RVC
+conflict CONFIG_RV64 CONFIG_RVE
+
+image rvc <<END
+80010137  # 80000000: lui        sp, 0x80010
+0080      # 80000004: c.addi4spn s0, sp, 64        <- s0 = 0x80010040
+12345537  # 80000006: lui        a0, 0x12345
+67850513  # 8000000a: addi       a0, a0, 1656
+c008      # 8000000e: c.sw       a0, 0(s0)
+400c      # 80000010: c.lw       a1, 0(s0)
+15e5      # 80000012: c.addi     a1, -7            <- a1 = 0x12345671
+563d      # 80000014: c.li       a2, -17
+7139      # 80000016: c.addi16sp sp, -64
+6121      # 80000018: c.addi16sp sp, 64
+7685      # 8000001a: c.lui      a3, 0xfffe1
+828d      # 8000001c: c.srli     a3, 3             <- a3 = 0x1fffc200
+8609      # 8000001e: c.srai     a2, 2             <- a2 = -5
+473d      # 80000020: c.li       a4, 15
+9b75      # 80000022: c.andi     a4, -3
+8d0d      # 80000024: c.sub      a0, a1            <- a0 = 7
+8db1      # 80000026: c.xor      a1, a2            <- a1 = 0xedcba98a
+8e55      # 80000028: c.or       a2, a3
+8ee9      # 8000002a: c.and      a3, a0            <- a3 = 0
+0716      # 8000002c: c.slli     a4, 5
+c63a      # 8000002e: c.swsp     a4, 12(sp)
+47b2      # 80000030: c.lwsp     a5, 12(sp)        <- a5 = 416
+82be      # 80000032: c.mv       t0, a5
+92aa      # 80000034: c.add      t0, a0            <- t0 = 423
+0001      # 80000036: c.nop
+4495      # 80000038: c.li       s1, 5
+4301      # 8000003a: c.li       t1, 0
+030d      # 8000003c: c.addi     t1, 3
+14fd      # 8000003e: c.addi     s1, -1
+fcf5      # 80000040: c.bnez     s1, 8000003c
+c091      # 80000042: c.beqz     s1, 80000046
+437d      # 80000044: c.li       t1, 31
+a011      # 80000046: c.j        8000004a
+4379      # 80000048: c.li       t1, 30
+2899      # 8000004a: c.jal      800000a0          <- t1 = 16
+800003b7  # 8000004c: lui        t2, 0x80000
+0a038393  # 80000050: addi       t2, t2, 160
+9382      # 80000054: c.jalr     t2                <- t1 = 17
+# check the results
+80010e37  # 80000056: lui        t3, 0x80010
+040e0e13  # 8000005a: addi       t3, t3, 64
+03c41d63  # 8000005e: bne        s0, t3, 80000098
+edcbbe37  # 80000062: lui        t3, 0xedcbb
+98ae0e13  # 80000066: addi       t3, t3, -1654
+03c59763  # 8000006a: bne        a1, t3, 80000098
+5e6d      # 8000006e: c.li       t3, -5
+03c61463  # 80000070: bne        a2, t3, 80000098
+e295      # 80000074: c.bnez     a3, 80000098
+1a000e13  # 80000076: li         t3, 416
+01c79f63  # 8000007a: bne        a5, t3, 80000098
+1a700e13  # 8000007e: li         t3, 423
+01c29b63  # 80000082: bne        t0, t3, 80000098
+4e45      # 80000086: c.li       t3, 17
+01c31863  # 80000088: bne        t1, t3, 80000098
+80010e37  # 8000008c: lui        t3, 0x80010
+01c11463  # 80000090: bne        sp, t3, 80000098
+4501      # 80000094: c.li       a0, 0
+9002      # 80000096: c.ebreak
+4505      # 80000098: c.li       a0, 1             <- bad
+9002      # 8000009a: c.ebreak
+0000      # 8000009c: padding
+0000      # 8000009e: padding
+0305      # 800000a0: c.addi     t1, 1             <- f
+8082      # 800000a2: c.jr       ra
+END
+pass rvc
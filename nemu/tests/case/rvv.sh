@@ -0,0 +1,64 @@
+# a strip-mined loop of vid, vmul, unit-stride loads and stores and vadd
+# writes a[i] = i, b[i] = 3 * i and c = a + b for 10 elements, then the sum
+# of c is reduced, and every second element of c is read by a strided load
+# with LMUL = 2, the results are the same for any VLEN
+require CONFIG_RVV
+conflict CONFIG_RV64
+
+image rvv <<END
+80100437  # 80000000: lui        s0, 0x80100
+10040493  # 80000004: addi       s1, s0, 256
+20040913  # 80000008: addi       s2, s0, 512
+00a00613  # 8000000c: li         a2, 10
+00040313  # 80000010: mv         t1, s0
+00048393  # 80000014: mv         t2, s1
+00000e13  # 80000018: li         t3, 0
+00060693  # 8000001c: mv         a3, a2
+00300e93  # 80000020: li         t4, 3
+0d06f2d7  # 80000024: vsetvli    t0, a3, e32, m1, ta, ma    <- strip-mined by VLMAX
+5208a0d7  # 80000028: vid.v      v1
+021e40d7  # 8000002c: vadd.vx    v1, v1, t3
+020360a7  # 80000030: vse32.v    v1, (t1)
+961ee157  # 80000034: vmul.vx    v2, v1, t4
+0203e127  # 80000038: vse32.v    v2, (t2)
+005e0e33  # 8000003c: add        t3, t3, t0
+00229f13  # 80000040: slli       t5, t0, 2
+01e30333  # 80000044: add        t1, t1, t5
+01e383b3  # 80000048: add        t2, t2, t5
+405686b3  # 8000004c: sub        a3, a3, t0
+fc069ae3  # 80000050: bnez       a3, 80000024
+00040313  # 80000054: mv         t1, s0
+00048393  # 80000058: mv         t2, s1
+00090713  # 8000005c: mv         a4, s2
+00060693  # 80000060: mv         a3, a2
+cd00f057  # 80000064: vsetivli   zero, 1, e32, m1, ta, ma
+42006457  # 80000068: vmv.s.x    v8, zero
+0d06f2d7  # 8000006c: vsetvli    t0, a3, e32, m1, ta, ma
+02036087  # 80000070: vle32.v    v1, (t1)
+0203e107  # 80000074: vle32.v    v2, (t2)
+021101d7  # 80000078: vadd.vv    v3, v1, v2
+020761a7  # 8000007c: vse32.v    v3, (a4)
+02342457  # 80000080: vredsum.vs v8, v3, v8                 <- sum of c
+00229f13  # 80000084: slli       t5, t0, 2
+01e30333  # 80000088: add        t1, t1, t5
+01e383b3  # 8000008c: add        t2, t2, t5
+01e70733  # 80000090: add        a4, a4, t5
+405686b3  # 80000094: sub        a3, a3, t0
+fc069ae3  # 80000098: bnez       a3, 8000006c
+428027d7  # 8000009c: vmv.x.s    a5, v8
+02492803  # 800000a0: lw         a6, 36(s2)
+00500293  # 800000a4: li         t0, 5
+0d12f2d7  # 800000a8: vsetvli    t0, t0, e32, m2, ta, ma
+00800f93  # 800000ac: li         t6, 8
+0bf96207  # 800000b0: vlse32.v   v4, (s2), t6               <- c[0], c[2], .., c[8]
+42006557  # 800000b4: vmv.s.x    v10, zero
+02452557  # 800000b8: vredsum.vs v10, v4, v10
+42a028d7  # 800000bc: vmv.x.s    a7, v10
+f4c78793  # 800000c0: addi       a5, a5, -180
+fdc80813  # 800000c4: addi       a6, a6, -36
+fb088893  # 800000c8: addi       a7, a7, -80
+0107e533  # 800000cc: or         a0, a5, a6
+01156533  # 800000d0: or         a0, a0, a7
+00100073  # 800000d4: ebreak
+END
+pass rvv
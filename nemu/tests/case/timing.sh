@@ -0,0 +1,22 @@
+# mcycle reads the cycles estimated by the timing model: the first fetch
+# misses in the icache, the load misses in the dcache and the next
+# instruction waits for its result
+require CONFIG_TIMING
+conflict CONFIG_RV64
+[ ${CONFIG_TIMING_CACHE_LINE_BITS} -ge 4 ] || exit 77
+
+cycles=$((2 * CONFIG_TIMING_LAT_ALU + CONFIG_TIMING_LAT_LOAD + 2 * CONFIG_TIMING_MISS_PENALTY + CONFIG_TIMING_LOAD_USE))
+image timing <<END
+801002b7  # 80000000: lui   t0, 0x80100
+0002a303  # 80000004: lw    t1, 0(t0)
+00130313  # 80000008: addi  t1, t1, 1    <- load-use
+b00025f3  # 8000000c: csrr  a1, mcycle   <- the cycles of the 3 instructions above
+00000297  # 80000010: auipc t0, 0
+0102a283  # 80000014: lw    t0, 16(t0)
+40558533  # 80000018: sub   a0, a1, t0
+00100073  # 8000001c: ebreak
+$(printf %08x $cycles)  # 80000020: the expected cycles
+END
+pass timing
+grep -q "stall cycles: load-use = $((2 * CONFIG_TIMING_LOAD_USE)), redirect = 0," timing.log ||
+  fail "wrong stalls: $(grep 'stall cycles' timing.log | head -1)"
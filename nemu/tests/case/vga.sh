@@ -0,0 +1,55 @@
+# the frame buffer keeps the bytes written by stores of any width, and the
+# sync register is cleared by the next poll of the screen, both when the
+# frame is dirty and when nothing is written since the last sync
+require CONFIG_HAS_VGA CONFIG_ISA_riscv
+conflict CONFIG_RV64 CONFIG_HAS_PORT_IO
+
+if [ "$CONFIG_VGA_SIZE_800x600" = y ]; then size=$((800 << 16 | 600)); else size=$((400 << 16 | 300)); fi
+
+image vga <<END
+00000417  # 80000000: auipc s0, 0
+0a442483  # 80000004: lw    s1, 164(s0)
+0a842903  # 80000008: lw    s2, 168(s0)
+0ac42983  # 8000000c: lw    s3, 172(s0)
+0a042403  # 80000010: lw    s0, 160(s0)
+0004a283  # 80000014: lw    t0, 0(s1)   <- the screen size
+09229063  # 80000018: bne   t0, s2, 80000098
+01100313  # 8000001c: li    t1, 0x11
+00640023  # 80000020: sb    t1, 0(s0)
+00002337  # 80000024: lui   t1, 0x2
+23330313  # 80000028: addi  t1, t1, 0x233
+00641123  # 8000002c: sh    t1, 2(s0)
+00042283  # 80000030: lw    t0, 0(s0)
+22330337  # 80000034: lui   t1, 0x22330
+01130313  # 80000038: addi  t1, t1, 0x11
+04629e63  # 8000003c: bne   t0, t1, 80000098
+01095293  # 80000040: srli  t0, s2, 16
+01091313  # 80000044: slli  t1, s2, 16
+01035313  # 80000048: srli  t1, t1, 16
+026282b3  # 8000004c: mul   t0, t0, t1
+00229293  # 80000050: slli  t0, t0, 2
+005402b3  # 80000054: add   t0, s0, t0
+fff00313  # 80000058: li    t1, -1
+fe62ae23  # 8000005c: sw    t1, -4(t0)  <- the last pixel
+ffc2a383  # 80000060: lw    t2, -4(t0)
+02639a63  # 80000064: bne   t2, t1, 80000098
+00200a13  # 80000068: li    s4, 2       <- sync twice, nothing is written before the second one
+00100313  # 8000006c: li    t1, 1
+0064a223  # 80000070: sw    t1, 4(s1)
+00098393  # 80000074: mv    t2, s3
+fff38393  # 80000078: addi  t2, t2, -1  <- wait for a poll
+fe039ee3  # 8000007c: bnez  t2, 80000078
+0044a283  # 80000080: lw    t0, 4(s1)
+00029a63  # 80000084: bnez  t0, 80000098
+fffa0a13  # 80000088: addi  s4, s4, -1
+fe0a10e3  # 8000008c: bnez  s4, 8000006c
+00000513  # 80000090: li    a0, 0
+00100073  # 80000094: ebreak
+00100513  # 80000098: li    a0, 1       <- bad
+00100073  # 8000009c: ebreak
+$(printf %08x $CONFIG_FB_ADDR)  # 800000a0: the frame buffer
+$(printf %08x $CONFIG_VGA_CTL_MMIO)  # 800000a4: the VGA controller
+$(printf %08x $size)  # 800000a8: width << 16 | height
+$(printf %08x $CONFIG_DEVICE_POLL_INST)  # 800000ac: instructions between two polls
+END
+pass vga
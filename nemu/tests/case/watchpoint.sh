@@ -0,0 +1,41 @@
+# a watchpoint on the memory stops right after a store which changes a word
+# it reads, even partly, but not after one which keeps or misses the word,
+# and a watchpoint on a register stops when the register changes it
+require CONFIG_WATCHPOINT CONFIG_ISA_riscv
+conflict CONFIG_RV64
+
+image wp <<END
+801002b7  # 80000000: lui   t0, 0x80100
+00100313  # 80000004: li    t1, 1
+0062a023  # 80000008: sw    t1, 0(t0)   <- watchpoint 0
+0062a223  # 8000000c: sw    t1, 4(t0)
+0062a023  # 80000010: sw    t1, 0(t0)
+00300593  # 80000014: li    a1, 3       <- watchpoint 1
+00200313  # 80000018: li    t1, 2
+00629123  # 8000001c: sh    t1, 2(t0)   <- watchpoint 0
+00000513  # 80000020: li    a0, 0
+00100073  # 80000024: ebreak
+END
+sdb wp <<END
+w *0x80100000
+w \$a1 == 3
+c
+c
+d 1
+c
+info w
+c
+q
+END
+grep "^Watchpoint [0-9]*: .* at\|^New value" wp.log > hits.txt
+cat > expected.txt <<END
+Watchpoint 0: *0x80100000 at pc = 0x80000008
+New value = 0x00000001
+Watchpoint 1: \$a1 == 3 at pc = 0x80000014
+New value = 0x00000001
+Watchpoint 0: *0x80100000 at pc = 0x8000001c
+New value = 0x00020001
+END
+diff -u expected.txt hits.txt > hits.diff || fail "wrong stops: $(cat hits.diff)"
+grep -q "^0	0x00020001	\*0x80100000" wp.log || fail "wrong watchpoint list: $(grep -A3 '^Num' wp.log)"
+grep -q "HIT GOOD TRAP" wp.log || fail "wp does not hit the good trap: $(tail -3 wp.log)"
@@ -0,0 +1,34 @@
+# with one hart, wfi moves mtime to mtimecmp when no interrupt is pending,
+# so the timer is pending right after it instead of after 2^30 ticks
+require CONFIG_HAS_CLINT CONFIG_ISA_riscv
+conflict CONFIG_RV64
+[ "${CONFIG_NR_HART:-1}" -gt 1 ] && exit 77
+
+image wfi <<END
+00000417  # 80000000: auipc s0, 0
+06042403  # 80000004: lw    s0, 96(s0)
+00004337  # 80000008: lui   t1, 0x4
+006409b3  # 8000000c: add   s3, s0, t1
+0000c337  # 80000010: lui   t1, 0xc
+ff830313  # 80000014: addi  t1, t1, -8
+00640a33  # 80000018: add   s4, s0, t1
+000a2283  # 8000001c: lw    t0, 0(s4)   <- mtime
+40000337  # 80000020: lui   t1, 0x40000
+006282b3  # 80000024: add   t0, t0, t1
+fff00313  # 80000028: li    t1, -1
+0069a223  # 8000002c: sw    t1, 4(s3)
+0059a023  # 80000030: sw    t0, 0(s3)
+0009a223  # 80000034: sw    zero, 4(s3) <- mtimecmp = mtime + 2^30
+08000313  # 80000038: li    t1, 128
+30432073  # 8000003c: csrs  mie, t1     <- MTIE, but mstatus.MIE is off
+10500073  # 80000040: wfi
+34402373  # 80000044: csrr  t1, mip
+08037313  # 80000048: andi  t1, t1, 0x80
+00030663  # 8000004c: beqz  t1, 80000058
+00000513  # 80000050: li    a0, 0
+00100073  # 80000054: ebreak
+00100513  # 80000058: li    a0, 1       <- bad
+00100073  # 8000005c: ebreak
+$(printf %08x $CONFIG_CLINT_MMIO)  # 80000060: the address of the CLINT
+END
+pass wfi
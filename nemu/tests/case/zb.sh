@@ -0,0 +1,122 @@
+# the instructions of Zba, Zbb and Zbs, every result in a2 is compared
+# with the expected value loaded into t3
+require CONFIG_ISA_riscv CONFIG_RVB
+conflict CONFIG_RV64 CONFIG_RVE
+
+image zb <<END
+80f01537  # 80000000: lui        a0, 0x80f01
+23450513  # 80000004: addi       a0, a0, 564
+01300593  # 80000008: li         a1, 19
+20b52633  # 8000000c: sh1add     a2, a0, a1        <- 0x01e0247b
+01e02e37  # 80000010: lui        t3, 0x1e02
+47be0e13  # 80000014: addi       t3, t3, 1147
+1bc61263  # 80000018: bne        a2, t3, 800001bc
+20b54633  # 8000001c: sh2add     a2, a0, a1        <- 0x03c048e3
+03c05e37  # 80000020: lui        t3, 0x3c05
+8e3e0e13  # 80000024: addi       t3, t3, -1821
+19c61a63  # 80000028: bne        a2, t3, 800001bc
+20b56633  # 8000002c: sh3add     a2, a0, a1        <- 0x078091b3
+07809e37  # 80000030: lui        t3, 0x7809
+1b3e0e13  # 80000034: addi       t3, t3, 435
+19c61263  # 80000038: bne        a2, t3, 800001bc
+40b57633  # 8000003c: andn       a2, a0, a1        <- 0x80f01224
+80f01e37  # 80000040: lui        t3, 0x80f01
+224e0e13  # 80000044: addi       t3, t3, 548
+17c61a63  # 80000048: bne        a2, t3, 800001bc
+40b56633  # 8000004c: orn        a2, a0, a1        <- 0xfffffffc
+ffc00e13  # 80000050: li         t3, -4
+17c61463  # 80000054: bne        a2, t3, 800001bc
+40b54633  # 80000058: xnor       a2, a0, a1        <- 0x7f0fedd8
+7f0ffe37  # 8000005c: lui        t3, 0x7f0ff
+dd8e0e13  # 80000060: addi       t3, t3, -552
+15c61c63  # 80000064: bne        a2, t3, 800001bc
+60059613  # 80000068: clz        a2, a1            <- 0x0000001b
+01b00e13  # 8000006c: li         t3, 27
+15c61663  # 80000070: bne        a2, t3, 800001bc
+60151613  # 80000074: ctz        a2, a0            <- 0x00000002
+00200e13  # 80000078: li         t3, 2
+15c61063  # 8000007c: bne        a2, t3, 800001bc
+60251613  # 80000080: cpop       a2, a0            <- 0x0000000a
+00a00e13  # 80000084: li         t3, 10
+13c61a63  # 80000088: bne        a2, t3, 800001bc
+0ab54633  # 8000008c: min        a2, a0, a1        <- 0x80f01234
+80f01e37  # 80000090: lui        t3, 0x80f01
+234e0e13  # 80000094: addi       t3, t3, 564
+13c61263  # 80000098: bne        a2, t3, 800001bc
+0ab56633  # 8000009c: max        a2, a0, a1        <- 0x00000013
+01300e13  # 800000a0: li         t3, 19
+11c61c63  # 800000a4: bne        a2, t3, 800001bc
+0ab55633  # 800000a8: minu       a2, a0, a1        <- 0x00000013
+01300e13  # 800000ac: li         t3, 19
+11c61663  # 800000b0: bne        a2, t3, 800001bc
+0ab57633  # 800000b4: maxu       a2, a0, a1        <- 0x80f01234
+80f01e37  # 800000b8: lui        t3, 0x80f01
+234e0e13  # 800000bc: addi       t3, t3, 564
+0fc61e63  # 800000c0: bne        a2, t3, 800001bc
+60451613  # 800000c4: sext.b     a2, a0            <- 0x00000034
+03400e13  # 800000c8: li         t3, 52
+0fc61863  # 800000cc: bne        a2, t3, 800001bc
+60551613  # 800000d0: sext.h     a2, a0            <- 0x00001234
+00001e37  # 800000d4: lui        t3, 0x1
+234e0e13  # 800000d8: addi       t3, t3, 564
+0fc61063  # 800000dc: bne        a2, t3, 800001bc
+08054633  # 800000e0: zext.h     a2, a0            <- 0x00001234
+00001e37  # 800000e4: lui        t3, 0x1
+234e0e13  # 800000e8: addi       t3, t3, 564
+0dc61863  # 800000ec: bne        a2, t3, 800001bc
+60b51633  # 800000f0: rol        a2, a0, a1        <- 0x91a40780
+91a40e37  # 800000f4: lui        t3, 0x91a40
+780e0e13  # 800000f8: addi       t3, t3, 1920
+0dc61063  # 800000fc: bne        a2, t3, 800001bc
+60b55633  # 80000100: ror        a2, a0, a1        <- 0x0246901e
+02469e37  # 80000104: lui        t3, 0x2469
+01ee0e13  # 80000108: addi       t3, t3, 30
+0bc61863  # 8000010c: bne        a2, t3, 800001bc
+60755613  # 80000110: rori       a2, a0, 7         <- 0x6901e024
+6901ee37  # 80000114: lui        t3, 0x6901e
+024e0e13  # 80000118: addi       t3, t3, 36
+0bc61063  # 8000011c: bne        a2, t3, 800001bc
+28755613  # 80000120: orc.b      a2, a0            <- 0xffffffff
+fff00e13  # 80000124: li         t3, -1
+09c61a63  # 80000128: bne        a2, t3, 800001bc
+69855613  # 8000012c: rev8       a2, a0            <- 0x3412f080
+3412fe37  # 80000130: lui        t3, 0x3412f
+080e0e13  # 80000134: addi       t3, t3, 128
+09c61263  # 80000138: bne        a2, t3, 800001bc
+48b51633  # 8000013c: bclr       a2, a0, a1        <- 0x80f01234
+80f01e37  # 80000140: lui        t3, 0x80f01
+234e0e13  # 80000144: addi       t3, t3, 564
+07c61a63  # 80000148: bne        a2, t3, 800001bc
+49f51613  # 8000014c: bclri      a2, a0, 31        <- 0x00f01234
+00f01e37  # 80000150: lui        t3, 0xf01
+234e0e13  # 80000154: addi       t3, t3, 564
+07c61263  # 80000158: bne        a2, t3, 800001bc
+48b55633  # 8000015c: bext       a2, a0, a1        <- 0x00000000
+00000e13  # 80000160: li         t3, 0
+05c61c63  # 80000164: bne        a2, t3, 800001bc
+49f55613  # 80000168: bexti      a2, a0, 31        <- 0x00000001
+00100e13  # 8000016c: li         t3, 1
+05c61663  # 80000170: bne        a2, t3, 800001bc
+68b51633  # 80000174: binv       a2, a0, a1        <- 0x80f81234
+80f81e37  # 80000178: lui        t3, 0x80f81
+234e0e13  # 8000017c: addi       t3, t3, 564
+03c61e63  # 80000180: bne        a2, t3, 800001bc
+68451613  # 80000184: binvi      a2, a0, 4         <- 0x80f01224
+80f01e37  # 80000188: lui        t3, 0x80f01
+224e0e13  # 8000018c: addi       t3, t3, 548
+03c61663  # 80000190: bne        a2, t3, 800001bc
+28b51633  # 80000194: bset       a2, a0, a1        <- 0x80f81234
+80f81e37  # 80000198: lui        t3, 0x80f81
+234e0e13  # 8000019c: addi       t3, t3, 564
+01c61e63  # 800001a0: bne        a2, t3, 800001bc
+28051613  # 800001a4: bseti      a2, a0, 0         <- 0x80f01235
+80f01e37  # 800001a8: lui        t3, 0x80f01
+235e0e13  # 800001ac: addi       t3, t3, 565
+01c61663  # 800001b0: bne        a2, t3, 800001bc
+00000513  # 800001b4: li         a0, 0
+00100073  # 800001b8: ebreak
+# bad
+00100513  # 800001bc: li         a0, 1
+00100073  # 800001c0: ebreak
+END
+pass zb
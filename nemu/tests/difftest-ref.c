@@ -0,0 +1,87 @@
+/***************************************************************************************
+* Copyright (c) 2014-2022 Zihao Yu, Nanjing University
+*
+* NEMU is licensed under Mulan PSL v2.
+* You can use this software according to the terms and conditions of the Mulan PSL v2.
+* You may obtain a copy of Mulan PSL v2 at:
+*          http://license.coscl.org.cn/MulanPSL2
+*
+* THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+* EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+* MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+*
+* See the Mulan PSL v2 for more details.
+***************************************************************************************/
+
+/* A reference design of riscv32 for the cases of DiffTest. It forwards to
+ * the one in $DIFF_REF, but flips a0 after executing the instruction at
+ * $DIFF_BAD_PC, so that DUT sees a mismatch there however REF is rolled back,
+ * and it writes a word to $DIFF_BAD_MEM in the memory of REF at the beginning.
+ */
+
+#include <assert.h>
+#include <dlfcn.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+enum { DIFFTEST_TO_DUT, DIFFTEST_TO_REF };
+
+static void (*ref_memcpy)(uint32_t addr, void *buf, size_t n, bool direction);
+static void (*ref_regcpy)(void *dut, bool direction);
+static void (*ref_exec)(uint64_t n);
+static void (*ref_raise_intr)(uint32_t NO);
+static uint64_t (*ref_memhash)(int page);
+static uint32_t bad_pc;
+static uint32_t regs[4096]; // gpr[0..31] and pc, larger than any CPU_state
+
+void difftest_memcpy(uint32_t addr, void *buf, size_t n, bool direction) {
+  ref_memcpy(addr, buf, n, direction);
+}
+
+void difftest_regcpy(void *dut, bool direction) {
+  ref_regcpy(dut, direction);
+}
+
+void difftest_exec(uint64_t n) {
+  while (n -- > 0) {
+    ref_regcpy(regs, DIFFTEST_TO_DUT);
+    uint32_t pc = regs[32];
+    ref_exec(1);
+    if (pc == bad_pc) {
+      ref_regcpy(regs, DIFFTEST_TO_DUT);
+      regs[10] ^= 1;
+      ref_regcpy(regs, DIFFTEST_TO_REF);
+    }
+  }
+}
+
+void difftest_raise_intr(uint32_t NO) {
+  ref_raise_intr(NO);
+}
+
+uint64_t difftest_memhash(int page) {
+  return ref_memhash(page);
+}
+
+void difftest_init(int port) {
+  void *handle = dlopen(getenv("DIFF_REF"), RTLD_LAZY);
+  assert(handle);
+  ref_memcpy = dlsym(handle, "difftest_memcpy");
+  ref_regcpy = dlsym(handle, "difftest_regcpy");
+  ref_exec = dlsym(handle, "difftest_exec");
+  ref_raise_intr = dlsym(handle, "difftest_raise_intr");
+  ref_memhash = dlsym(handle, "difftest_memhash");
+  assert(ref_memcpy && ref_regcpy && ref_exec && ref_raise_intr);
+  char *pc = getenv("DIFF_BAD_PC");
+  bad_pc = (pc == NULL ? 0 : strtoul(pc, NULL, 0));
+  void (*ref_init)(int) = dlsym(handle, "difftest_init");
+  assert(ref_init);
+  ref_init(port);
+  char *bad_mem = getenv("DIFF_BAD_MEM");
+  if (bad_mem != NULL) {
+    uint32_t word = 0xdeadbeef;
+    ref_memcpy(strtoul(bad_mem, NULL, 0), &word, sizeof(word), DIFFTEST_TO_REF);
+  }
+}
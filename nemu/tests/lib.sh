@@ -0,0 +1,70 @@
+#***************************************************************************************
+# Copyright (c) 2014-2022 Zihao Yu, Nanjing University
+#
+# NEMU is licensed under Mulan PSL v2.
+# You can use this software according to the terms and conditions of the Mulan PSL v2.
+# You may obtain a copy of Mulan PSL v2 at:
+#          http://license.coscl.org.cn/MulanPSL2
+#
+# THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+# EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+# MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+#
+# See the Mulan PSL v2 for more details.
+#**************************************************************************************/
+
+# Helpers for the cases, which run in their own scratch directories.
+# $NEMU is the binary under test, and $DIFF_REF is the reference design
+# of DiffTest if it is enabled.
+
+source $NEMU_HOME/include/config/auto.conf
+
+fail() { echo "$*"; exit 1; }
+
+# skip the case unless all of the given options are set
+require() {
+  for c in "$@"; do [ "${!c}" = y ] || exit 77; done
+}
+
+# skip the case if any of the given options is set
+conflict() {
+  for c in "$@"; do [ "${!c}" = y ] && exit 77; done
+  return 0
+}
+
+# write the image `$1.bin' from the hex numbers in the standard input, which
+# are 32-bit words or 16-bit halfwords by their digits, `#' starts a comment
+image() {
+  sed 's/#.*//' | tr -s ' \t' '\n' | grep . | while read w; do
+    case ${#w} in
+      8) printf "\\x${w:6:2}\\x${w:4:2}\\x${w:2:2}\\x${w:0:2}" ;;
+      4) printf "\\x${w:2:2}\\x${w:0:2}" ;;
+      *) fail "bad word $w" ;;
+    esac
+  done > $1.bin
+}
+
+# run `$1.bin' in batch mode with the remaining arguments, the output is in `$1.log',
+# with DiffTest the reference design is $DIFF_REF unless --diff is given,
+# the case is skipped if $NEMU is a shared object which can not run an image
+run() {
+  [ "$CONFIG_TARGET_SHARE" = y ] && exit 77
+  local img=$1; shift
+  local diff=
+  [ "$CONFIG_DIFFTEST" = y ] && [[ "$*" != *--diff=* ]] && diff=--diff=$DIFF_REF
+  $NEMU -b $diff "$@" $img.bin > $img.log 2>&1
+}
+
+# run `$1.bin' and check that it hits the good trap
+pass() {
+  run "$@" && grep -q "HIT GOOD TRAP" $1.log || fail "$1 does not hit the good trap: $(tail -3 $1.log)"
+}
+
+# run `$1.bin' in sdb with the commands in the standard input
+sdb() {
+  [ "$CONFIG_TARGET_SHARE" = y ] && exit 77
+  local img=$1; shift
+  local diff=
+  [ "$CONFIG_DIFFTEST" = y ] && diff=--diff=$DIFF_REF
+  $NEMU $diff "$@" $img.bin > $img.log 2>&1
+}
@@ -0,0 +1,218 @@
+/***************************************************************************************
+* Copyright (c) 2014-2022 Zihao Yu, Nanjing University
+*
+* NEMU is licensed under Mulan PSL v2.
+* You can use this software according to the terms and conditions of the Mulan PSL v2.
+* You may obtain a copy of Mulan PSL v2 at:
+*          http://license.coscl.org.cn/MulanPSL2
+*
+* THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+* EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+* MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+*
+* See the Mulan PSL v2 for more details.
+***************************************************************************************/
+
+/* A harness linked with the libnemu shared object, which checks the MMIO
+ * callbacks, nemu_stop() called by one of them, loading ELF files, and
+ * restoring the state of the CLINT if it is built in.
+ * The programs are riscv32 and written to the memory directly, the ELF
+ * file is also written here, so no cross toolchain is needed. The other
+ * harts spin at the beginning of the programs.
+ */
+
+#include <elf.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libnemu.h>
+#include <generated/autoconf.h>
+
+#define MMIO_BASE 0xa0000000u
+#define ELF_BASE  0x80001000u
+
+#define check(cond, ...) do { \
+    if (!(cond)) { printf("%s: ", test); printf(__VA_ARGS__); printf("\n"); exit(1); } \
+  } while (0)
+
+static const char *test;
+
+static const uint32_t mmio_prog[] = {
+  0xf1402373, // csrr   t1, mhartid
+  0x00031063, // 1: bnez t1, 1b, only hart 0 runs the program
+  0xa00002b7, // lui    t0, 0xa0000
+  0x0002a583, // lw     a1, 0(t0)
+  0x00b2a223, // sw     a1, 4(t0)
+  0x00000513, // li     a0, 0
+  0x00100073, // ebreak
+};
+
+static const uint32_t stop_prog[] = {
+  0xf1402373, // csrr   t1, mhartid
+  0x00031063, // 1: bnez t1, 1b, only hart 0 runs the program
+  0xa00002b7, // lui    t0, 0xa0000
+  0x0002a023, // 1: sw  zero, 0(t0)
+  0xffdff06f, // j      1b
+};
+
+static const uint32_t count_prog[] = {
+  0xf1402373, // csrr   t1, mhartid
+  0x00031063, // 1: bnez t1, 1b, only hart 0 runs the program
+  0x06400593, // li     a1, 100
+  0xfff58593, // 1: addi a1, a1, -1
+  0xfe059ee3, // bnez   a1, 1b
+  0x00000513, // li     a0, 0
+  0x00100073, // ebreak
+};
+
+static const uint32_t clint_prog[] = {
+  0xf1402373, // csrr   t1, mhartid
+  0x00031063, // 1: bnez t1, 1b, only hart 0 runs the program
+  0x00000297, // auipc  t0, 0
+  0x0282a283, // lw     t0, 40(t0), the address of mtimecmp of hart 0
+  0x06400313, // li     t1, 100
+  0x0062a023, // sw     t1, 0(t0)
+  0x0002a223, // sw     zero, 4(t0)
+  0x34402573, // 1: csrr a0, mip
+  0x08057513, // andi   a0, a0, 0x80
+  0xfe050ce3, // beqz   a0, 1b, until MTIP is raised
+  0x00000513, // li     a0, 0
+  0x00100073, // ebreak
+  0,          // the address of mtimecmp
+};
+
+typedef struct {
+  nemu_t *m;
+  int nr_read, nr_write;
+  uint64_t last_offset, last_data;
+  int stop_at; // nemu_stop() is called by this write
+} Dev;
+
+static uint64_t dev_access(void *opaque, uint64_t offset, int len, bool is_write, uint64_t data) {
+  Dev *d = opaque;
+  if (!is_write) { d->nr_read ++; return 0x1234; }
+  d->nr_write ++;
+  d->last_offset = offset;
+  d->last_data = data;
+  if (d->nr_write == d->stop_at) nemu_stop(d->m);
+  return 0;
+}
+
+static nemu_t* new_machine(const uint32_t *prog, size_t size, Dev *d) {
+  nemu_t *m = nemu_create();
+  check(m != NULL, "no machine");
+  check(nemu_mem_write(m, nemu_reg_read(m, NEMU_REG_PC), prog, size) == 0, "can not write the program");
+  memset(d, 0, sizeof(*d));
+  d->m = m;
+  check(nemu_add_mmio(m, "dev", MMIO_BASE, 8, dev_access, d) == 0, "can not add the MMIO region");
+  return m;
+}
+
+static void test_mmio() {
+  test = "mmio";
+  Dev d;
+  nemu_t *m = new_machine(mmio_prog, sizeof(mmio_prog), &d);
+  check(nemu_run(m, 100) == NEMU_EVENT_END && nemu_exit_code(m) == 0, "the good trap is not hit");
+  check(d.nr_read == 1 && d.nr_write == 1, "%d reads and %d writes", d.nr_read, d.nr_write);
+  check(nemu_reg_read(m, nemu_reg_index("a1")) == 0x1234, "the read does not come from the callback");
+  check(d.last_offset == 4 && d.last_data == 0x1234, "write of %#lx at offset %lu",
+      (unsigned long)d.last_data, (unsigned long)d.last_offset);
+  nemu_destroy(m);
+}
+
+static void test_stop() {
+  test = "stop";
+  Dev d;
+  nemu_t *m = new_machine(stop_prog, sizeof(stop_prog), &d);
+  d.stop_at = 10;
+  // the run stops right after the instruction which calls nemu_stop()
+  check(nemu_run(m, 1000000) == NEMU_EVENT_STOP, "the stop is not seen");
+  check(d.nr_write == 10, "%d writes before the stop", d.nr_write);
+  // the machine can be run again after a stop
+  check(nemu_run(m, 100) == NEMU_EVENT_BUDGET, "the run is not resumed");
+  check(d.nr_write > 10, "no writes after the resumption");
+  nemu_destroy(m);
+}
+
+// write an ELF file with the program in a segment at ELF_BASE, followed by `bss' zero bytes
+static void write_elf(const char *file, int bss) {
+  struct {
+    Elf32_Ehdr eh;
+    Elf32_Phdr ph;
+    uint32_t prog[sizeof(count_prog) / sizeof(count_prog[0])];
+  } elf = {
+    .eh = {
+      .e_ident = { ELFMAG0, ELFMAG1, ELFMAG2, ELFMAG3, ELFCLASS32, ELFDATA2LSB, EV_CURRENT },
+      .e_type = ET_EXEC, .e_machine = EM_RISCV, .e_version = EV_CURRENT,
+      .e_entry = ELF_BASE, .e_phoff = sizeof(Elf32_Ehdr),
+      .e_ehsize = sizeof(Elf32_Ehdr), .e_phentsize = sizeof(Elf32_Phdr), .e_phnum = 1,
+    },
+    .ph = {
+      .p_type = PT_LOAD, .p_offset = offsetof(typeof(elf), prog),
+      .p_vaddr = ELF_BASE, .p_paddr = ELF_BASE,
+      .p_filesz = sizeof(count_prog), .p_memsz = sizeof(count_prog) + bss,
+      .p_flags = PF_R | PF_X,
+    },
+  };
+  memcpy(elf.prog, count_prog, sizeof(count_prog));
+  FILE *fp = fopen(file, "wb");
+  check(fp != NULL && fwrite(&elf, sizeof(elf), 1, fp) == 1, "can not write %s", file);
+  fclose(fp);
+}
+
+static void test_elf() {
+  test = "elf";
+  nemu_t *m = nemu_create();
+  // the bytes after the segment in the file are cleared by the loader
+  uint32_t garbage[4] = { 1, 2, 3, 4 }, bss[4];
+  nemu_mem_write(m, ELF_BASE + sizeof(count_prog), garbage, sizeof(garbage));
+  write_elf("prog.elf", sizeof(bss));
+  check(nemu_load_elf(m, "prog.elf") == sizeof(count_prog) + sizeof(bss), "the segment is not loaded");
+  check(nemu_reg_read(m, NEMU_REG_PC) == ELF_BASE, "the PC is not the entry");
+  nemu_mem_read(m, ELF_BASE + sizeof(count_prog), bss, sizeof(bss));
+  for (int i = 0; i < 4; i ++) check(bss[i] == 0, "the bss is not cleared");
+  check(nemu_run(m, 1000) == NEMU_EVENT_END && nemu_exit_code(m) == 0, "the good trap is not hit");
+  // the PC is after the ebreak at the end of the program
+  check(nemu_reg_read(m, NEMU_REG_PC) == ELF_BASE + sizeof(count_prog), "the trap is at pc = %#lx",
+      (unsigned long)nemu_reg_read(m, NEMU_REG_PC));
+
+  // a segment beyond the memory and a file which is not ELF are rejected
+  write_elf("big.elf", 0x10000000);
+  check(nemu_load_elf(m, "big.elf") == -1, "a segment out of the memory is loaded");
+  check(nemu_load_elf(m, "/dev/null") == -1, "an empty file is loaded");
+  nemu_destroy(m);
+}
+
+#ifdef CONFIG_HAS_CLINT
+static void test_clint() {
+  test = "clint";
+  uint32_t prog[sizeof(clint_prog) / sizeof(clint_prog[0])];
+  memcpy(prog, clint_prog, sizeof(prog));
+  prog[12] = CONFIG_CLINT_MMIO + 0x4000;
+  nemu_t *m = nemu_create();
+  nemu_mem_write(m, nemu_reg_read(m, NEMU_REG_PC), prog, sizeof(prog));
+  // the timer is pending after mtimecmp is written
+  check(nemu_run(m, 10) == NEMU_EVENT_BUDGET, "the program ends early");
+  nemu_snapshot_t *s = nemu_snapshot(m);
+  check(nemu_run(m, 10000000) == NEMU_EVENT_END, "MTIP is not raised");
+
+  // a new machine has no timer pending until the snapshot is restored to it
+  nemu_t *m2 = nemu_create();
+  nemu_restore(m2, s);
+  check(nemu_run(m2, 10000000) == NEMU_EVENT_END, "MTIP is not raised after the restore");
+  nemu_snapshot_free(s);
+  nemu_destroy(m2);
+  nemu_destroy(m);
+}
+#endif
+
+int main() {
+  test_mmio();
+  test_stop();
+  test_elf();
+#ifdef CONFIG_HAS_CLINT
+  test_clint();
+#endif
+  printf("passed\n");
+  return 0;
+}
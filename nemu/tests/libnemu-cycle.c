@@ -0,0 +1,84 @@
+/***************************************************************************************
+* Copyright (c) 2014-2022 Zihao Yu, Nanjing University
+*
+* NEMU is licensed under Mulan PSL v2.
+* You can use this software according to the terms and conditions of the Mulan PSL v2.
+* You may obtain a copy of Mulan PSL v2 at:
+*          http://license.coscl.org.cn/MulanPSL2
+*
+* THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+* EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+* MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+*
+* See the Mulan PSL v2 for more details.
+***************************************************************************************/
+
+/* A harness linked with the libnemu shared object. It creates machines,
+ * runs the image given in argv[1] on them, resets them with a snapshot
+ * taken at the beginning and frees them, over and over. Two machines are
+ * alive at a time, so that a state leaking from one to another is found.
+ * The image counts a1 down from 100 and hits the good trap, every run of it
+ * executes the same number of instructions as the first one, unless `-p'
+ * is given because the harts run in parallel.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libnemu.h>
+
+#define NR_CYCLE 64
+
+#define check(cond, ...) do { \
+    if (!(cond)) { printf("cycle %d: ", cycle); printf(__VA_ARGS__); printf("\n"); exit(1); } \
+  } while (0)
+
+static int cycle;
+static uint64_t nr_inst = 0;
+static bool parallel = false;
+
+static void run_to_end(nemu_t *m) {
+  int a1 = nemu_reg_index("a1"), a0 = nemu_reg_index("a0");
+  check(nemu_run(m, 10) == NEMU_EVENT_BUDGET, "the budget is not respected");
+  check(nemu_reg_read(m, a1) == 95, "a1 = %lu after 10 instructions",
+      (unsigned long)nemu_reg_read(m, a1));
+  nemu_reg_write(m, a0, 1);
+  check(nemu_run(m, 1000) == NEMU_EVENT_END, "the good trap is not hit");
+  check(nemu_exit_code(m) == 0, "exit code %d", nemu_exit_code(m));
+  if (nr_inst == 0) nr_inst = nemu_inst_count(m);
+  // the other harts retire a varying number of instructions before hart 0 stops them
+  if (parallel) return;
+  check(nemu_inst_count(m) == nr_inst, "%lu instructions are executed, but %lu at first",
+      (unsigned long)nemu_inst_count(m), (unsigned long)nr_inst);
+}
+
+int main(int argc, char *argv[]) {
+  nemu_t *old = NULL;
+  uint64_t pc = 0;
+  parallel = (argc > 2 && strcmp(argv[2], "-p") == 0);
+  for (cycle = 0; cycle < NR_CYCLE; cycle ++) {
+    nemu_t *m = nemu_create();
+    check(m != NULL && m != old, "no new machine");
+    check(nemu_load_image(m, argv[1]) > 0, "can not load %s", argv[1]);
+    if (cycle == 0) pc = nemu_reg_read(m, NEMU_REG_PC);
+    check(nemu_reg_read(m, NEMU_REG_PC) == pc, "the machine is not reset");
+
+    nemu_snapshot_t *s = nemu_snapshot(m);
+    run_to_end(m);
+    // a second run after the reset behaves the same as the first one
+    nemu_restore(m, s);
+    check(nemu_reg_read(m, NEMU_REG_PC) == pc && nemu_inst_count(m) == 0, "the restore does not reset");
+    run_to_end(m);
+    nemu_snapshot_free(s);
+
+    // the other machine is untouched by this one
+    if (old != NULL) {
+      check(parallel || nemu_inst_count(old) == nr_inst, "the previous machine is changed");
+      nemu_destroy(old);
+    }
+    old = m;
+  }
+  nemu_destroy(old);
+  printf("%d cycles passed\n", NR_CYCLE);
+  return 0;
+}
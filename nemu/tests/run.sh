@@ -0,0 +1,39 @@
+#!/bin/bash
+#***************************************************************************************
+# Copyright (c) 2014-2022 Zihao Yu, Nanjing University
+#
+# NEMU is licensed under Mulan PSL v2.
+# You can use this software according to the terms and conditions of the Mulan PSL v2.
+# You may obtain a copy of Mulan PSL v2 at:
+#          http://license.coscl.org.cn/MulanPSL2
+#
+# THIS SOFTWARE IS PROVIDED ON AN "AS IS" BASIS, WITHOUT WARRANTIES OF ANY KIND,
+# EITHER EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO NON-INFRINGEMENT,
+# MERCHANTABILITY OR FIT FOR A PARTICULAR PURPOSE.
+#
+# See the Mulan PSL v2 for more details.
+#**************************************************************************************/
+
+# Run the cases in tests/case against the NEMU built with the current
+# configuration. A case exits with 0 if it passes and with 77 if it does
+# not apply to the configuration.
+# usage: run.sh BINARY [DIFF_REF_SO]
+
+[ -n "$NEMU_HOME" ] || { echo "NEMU_HOME is not set"; exit 1; }
+export NEMU=$(realpath $1)
+export DIFF_REF=$([ -n "$2" ] && realpath $2)
+export TMP=$(mktemp -d)
+trap "rm -rf $TMP" EXIT
+
+nr_fail=0
+for t in $NEMU_HOME/tests/case/*.sh; do
+  name=$(basename $t .sh)
+  mkdir -p $TMP/$name
+  out=$(cd $TMP/$name && bash -c "source $NEMU_HOME/tests/lib.sh; source $t" 2>&1 < /dev/null)
+  case $? in
+    0)  echo "PASS $name" ;;
+    77) echo "SKIP $name" ;;
+    *)  echo "FAIL $name"; echo "$out" | sed 's/^/    /'; nr_fail=$((nr_fail + 1)) ;;
+  esac
+done
+exit $((nr_fail != 0))
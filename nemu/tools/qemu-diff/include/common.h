@@ -24,6 +24,8 @@
 #include <unistd.h>
 #include <stdlib.h>
 
+#include <generated/autoconf.h>
+
 typedef uint32_t paddr_t;
 
 #include "isa.h"
@@ -23,6 +23,8 @@
 #elif defined(CONFIG_ISA_riscv) && !defined(CONFIG_RV64)
 #define ISA_QEMU_BIN "qemu-system-riscv32"
 #define ISA_QEMU_ARGS "-bios", "none",
+// the RAM of the machine starts from CONFIG_MBASE and can be backed by shared memory
+#define ISA_QEMU_SHM 1
 #elif defined(CONFIG_ISA_riscv) && defined(CONFIG_RV64)
 #define ISA_QEMU_BIN "qemu-system-riscv64"
 #define ISA_QEMU_ARGS 
@@ -34,4 +34,8 @@ void gdb_send(struct gdb_conn *conn, const uint8_t *command, size_t size);
 
 uint8_t *gdb_recv(struct gdb_conn *conn, size_t *size);
 
+void gdb_send_async(struct gdb_conn *conn, const uint8_t *command, size_t size);
+
+void gdb_flush(struct gdb_conn *conn);
+
 const char * gdb_start_noack(struct gdb_conn *conn);
@@ -16,6 +16,8 @@
 #include "common.h"
 #include <difftest-def.h>
 #include <sys/prctl.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <signal.h>
 
 bool gdb_connect_qemu(int);
@@ -23,21 +25,67 @@ bool gdb_memcpy_to_qemu(uint32_t, void *, int);
 bool gdb_getregs(union isa_gdb_regs *);
 bool gdb_setregs(union isa_gdb_regs *);
 bool gdb_si();
+bool gdb_si_n(uint64_t n, union isa_gdb_regs *r);
 void gdb_exit();
 
 void init_isa();
 
+// The registers of QEMU are read together with the steps in difftest_exec(),
+// since the caller almost always reads them right after the execution.
+static union isa_gdb_regs qemu_r;
+static bool qemu_r_valid = false;
+
+#ifdef ISA_QEMU_SHM
+/* The RAM of QEMU is backed by a file in /dev/shm which is also mapped
+ * here, so that the memory of DUT is copied to QEMU directly instead of
+ * hex-encoded gdb packets.
+ *
+ * Writing the file behind the back of QEMU does not invalidate the blocks
+ * it has already translated, so a later write to code would leave QEMU
+ * running the stale translation. Therefore the file is only written before
+ * QEMU executes anything, which covers loading the image. Later writes go
+ * through M packets, and the gdb stub of QEMU invalidates the translated
+ * blocks of the range it writes.
+ */
+static uint8_t *shm = NULL;
+static char shm_path[64];
+static bool qemu_started = false;
+
+static void init_shm() {
+  sprintf(shm_path, "/dev/shm/nemu-qemu-diff-%d", getpid());
+  int fd = open(shm_path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+  assert(fd >= 0);
+  int ret = ftruncate(fd, CONFIG_MSIZE);
+  assert(ret == 0);
+  shm = mmap(NULL, CONFIG_MSIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  assert(shm != MAP_FAILED);
+  close(fd);
+}
+
+static bool in_shm(paddr_t addr, size_t n) {
+  return addr - CONFIG_MBASE < CONFIG_MSIZE && n <= CONFIG_MBASE + CONFIG_MSIZE - addr;
+}
+#endif
+
 __EXPORT void difftest_memcpy(paddr_t addr, void *buf, size_t n, bool direction) {
   assert(direction == DIFFTEST_TO_REF);
   if (direction == DIFFTEST_TO_REF) {
+#ifdef ISA_QEMU_SHM
+    if (!qemu_started && in_shm(addr, n)) {
+      memcpy(shm + addr - CONFIG_MBASE, buf, n);
+      return;
+    }
+#endif
     bool ok = gdb_memcpy_to_qemu(addr, buf, n);
     assert(ok == 1);
   }
 }
 
 __EXPORT void difftest_regcpy(void *dut, bool direction) {
-  union isa_gdb_regs qemu_r;
-  gdb_getregs(&qemu_r);
+  if (!qemu_r_valid) {
+    gdb_getregs(&qemu_r);
+    qemu_r_valid = true;
+  }
   if (direction == DIFFTEST_TO_REF) {
     memcpy(&qemu_r, dut, DIFFTEST_REG_SIZE);
     gdb_setregs(&qemu_r);
@@ -47,12 +95,15 @@ __EXPORT void difftest_regcpy(void *dut, bool direction) {
 }
 
 __EXPORT void difftest_exec(uint64_t n) {
-  while (n --) gdb_si();
+  IFDEF(ISA_QEMU_SHM, qemu_started = true);
+  gdb_si_n(n, &qemu_r);
+  qemu_r_valid = true;
 }
 
 __EXPORT void difftest_init(int port) {
   char buf[32];
   sprintf(buf, "tcp::%d", port);
+  IFDEF(ISA_QEMU_SHM, init_shm());
 
   int ppid_before_fork = getpid();
   int pid = fork();
@@ -76,8 +127,17 @@ __EXPORT void difftest_init(int port) {
     }
 
     close(STDIN_FILENO);
+#ifdef ISA_QEMU_SHM
+    char mem_size[32], mem_backend[256];
+    sprintf(mem_size, "%dM", CONFIG_MSIZE >> 20);
+    sprintf(mem_backend, "memory-backend-file,id=nemu.ram,size=%s,mem-path=%s,share=on", mem_size, shm_path);
+    execlp(ISA_QEMU_BIN, ISA_QEMU_BIN, ISA_QEMU_ARGS "-m", mem_size, "-object", mem_backend,
+        "-machine", "memory-backend=nemu.ram", "-S", "-gdb", buf, "-nographic",
+        "-serial", "none", "-monitor", "none", NULL);
+#else
     execlp(ISA_QEMU_BIN, ISA_QEMU_BIN, ISA_QEMU_ARGS "-S", "-gdb", buf, "-nographic",
         "-serial", "none", "-monitor", "none", NULL);
+#endif
     perror("exec");
     assert(0);
   }
@@ -86,6 +146,8 @@ __EXPORT void difftest_init(int port) {
 
     gdb_connect_qemu(port);
     printf("Connect to QEMU with %s successfully\n", buf);
+    // QEMU has mapped the file by now
+    IFDEF(ISA_QEMU_SHM, unlink(shm_path));
 
     atexit(gdb_exit);
 
@@ -16,6 +16,11 @@
 #include "common.h"
 
 static struct gdb_conn *conn;
+// whether several packets can be in flight, see gdb_si_n()
+static bool pipelined = false;
+
+// number of packets in flight at most, the replies should fit in the socket buffers
+#define PIPELINE_DEPTH 256
 
 bool gdb_connect_qemu(int port) {
   // connect to gdbserver on localhost port 1234
@@ -23,6 +28,8 @@ bool gdb_connect_qemu(int port) {
     usleep(1);
   }
 
+  pipelined = !strcmp(gdb_start_noack(conn), "OK");
+
   return true;
 }
 
@@ -59,11 +66,7 @@ bool gdb_memcpy_to_qemu(uint32_t dest, void *src, int len) {
   return ok;
 }
 
-bool gdb_getregs(union isa_gdb_regs *r) {
-  gdb_send(conn, (const uint8_t *)"g", 1);
-  size_t size;
-  uint8_t *reply = gdb_recv(conn, &size);
-
+static void decode_regs(uint8_t *reply, union isa_gdb_regs *r) {
   int i;
   uint8_t *p = reply;
   uint8_t c;
@@ -74,7 +77,13 @@ bool gdb_getregs(union isa_gdb_regs *r) {
     p[8] = c;
     p += 8;
   }
+}
 
+bool gdb_getregs(union isa_gdb_regs *r) {
+  gdb_send(conn, (const uint8_t *)"g", 1);
+  size_t size;
+  uint8_t *reply = gdb_recv(conn, &size);
+  decode_regs(reply, r);
   free(reply);
 
   return true;
@@ -113,6 +122,40 @@ bool gdb_si() {
   return true;
 }
 
+// Step `n' instructions and then read the registers into `r' if it is not
+// NULL. In no-ack mode, the packets are pipelined so that only one round
+// trip is needed for up to PIPELINE_DEPTH packets.
+bool gdb_si_n(uint64_t n, union isa_gdb_regs *r) {
+  static const char step[] = "vCont;s:1";
+  size_t size;
+  if (!pipelined) {
+    while (n --) gdb_si();
+    return (r ? gdb_getregs(r) : true);
+  }
+
+  while (n > 0 || r != NULL) {
+    int nr_step = (n < PIPELINE_DEPTH ? n : PIPELINE_DEPTH);
+    bool getregs = (r != NULL && nr_step < PIPELINE_DEPTH);
+    for (int i = 0; i < nr_step; i ++) {
+      gdb_send_async(conn, (const uint8_t *)step, sizeof(step) - 1);
+    }
+    if (getregs) gdb_send_async(conn, (const uint8_t *)"g", 1);
+    gdb_flush(conn);
+
+    for (int i = 0; i < nr_step; i ++) {
+      free(gdb_recv(conn, &size));
+    }
+    if (getregs) {
+      uint8_t *reply = gdb_recv(conn, &size);
+      decode_regs(reply, r);
+      free(reply);
+      r = NULL;
+    }
+    n -= nr_step;
+  }
+  return true;
+}
+
 void gdb_exit() {
   gdb_end(conn);
 }
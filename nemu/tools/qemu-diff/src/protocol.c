@@ -135,7 +135,7 @@ void gdb_end(struct gdb_conn *conn) {
   free(conn);
 }
 
-static void send_packet(FILE *out, const uint8_t *command, size_t size) {
+static void write_packet(FILE *out, const uint8_t *command, size_t size) {
   // compute the checksum -- simple mod256 addition
   uint8_t sum = 0;
   size_t i;
@@ -149,6 +149,9 @@ static void send_packet(FILE *out, const uint8_t *command, size_t size) {
   fputc('$', out); // packet start
   fwrite(command, 1, size, out); // payload
   fprintf(out, "#%02X", sum); // packet end, checksum
+}
+
+static void flush_packets(FILE *out) {
   fflush(out);
 
   if (ferror(out))
@@ -157,6 +160,11 @@ static void send_packet(FILE *out, const uint8_t *command, size_t size) {
     errx(0, "send: Connection closed");
 }
 
+static void send_packet(FILE *out, const uint8_t *command, size_t size) {
+  write_packet(out, command, size);
+  flush_packets(out);
+}
+
 void gdb_send(struct gdb_conn *conn, const uint8_t *command, size_t size) {
   bool acked = false;
   do {
@@ -170,6 +178,19 @@ void gdb_send(struct gdb_conn *conn, const uint8_t *command, size_t size) {
   } while (!acked);
 }
 
+// Queue a packet without waiting for the acknowledgement or the reply,
+// so that several packets are in flight at once. This is only possible
+// in no-ack mode. The replies should be received with gdb_recv() in order
+// after the packets are sent by gdb_flush().
+void gdb_send_async(struct gdb_conn *conn, const uint8_t *command, size_t size) {
+  assert(!conn->ack);
+  write_packet(conn->out, command, size);
+}
+
+void gdb_flush(struct gdb_conn *conn) {
+  flush_packets(conn->out);
+}
+
 static uint8_t* recv_packet(FILE *in, size_t *ret_size, bool* ret_sum_ok) {
   size_t i = 0;
   size_t size = 4096;